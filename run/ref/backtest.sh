@@ -0,0 +1,25 @@
+#!/bin/bash
+
+SCRIPT_PATH=${0%/*}
+BIN_PATH=$SCRIPT_PATH/../../bin
+RUN_PATH=$SCRIPT_PATH/../../run
+
+ZIP_ROOT=$SCRIPT_PATH/../../..
+ZIP_DATA=$ZIP_ROOT/Data/$1.zip
+ZIP_DATAREF=$ZIP_ROOT/Data0/DataG/$1.zip
+
+TEMP_ROOT=/tmp/Sibyl
+TEMP_DATAREF_PATH=$TEMP_ROOT/DataRef/$1
+
+if [ -f $ZIP_DATA ] && [ -f $ZIP_DATAREF ]; then
+	rm -rf $TEMP_ROOT
+
+	mkdir -p $TEMP_DATAREF_PATH
+	unzip -qq -d $TEMP_DATAREF_PATH $ZIP_DATAREF
+	
+	printf '%s\t' $1
+
+	$BIN_PATH/backtest $RUN_PATH/KOSPI.config $ZIP_DATA $RUN_PATH/reward.config $TEMP_DATAREF_PATH
+
+	rm -rf $TEMP_ROOT
+fi
@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# Per-tick cost of simserv & refclnt on synthetic days (convert_data -g) of 250, 500, 1000 & 2000 items
+# or of the numbers of items given; 70% KOSPI (incl. 005930), the rest ELW (and 2 ETFs)
+# CPU time is user + sys of each process over the whole day; buildMsg p50 is from the latency table in sim.log
+
+SCRIPT_PATH=${0%/*}
+BIN_PATH=$SCRIPT_PATH/../../bin
+RUN_PATH=$SCRIPT_PATH/../../run
+
+TEMP_ROOT=/tmp/Sibyl/Scale
+
+TCP_PORT=50505
+
+TIMEFORMAT='%U %S'
+
+if [ $# -eq 0 ]; then
+	set -- 250 500 1000 2000
+fi
+
+printf 'items\tticks\tserver ms/tick\tclient ms/tick\tbuildMsg p50 (us)\n'
+
+for N in "$@"; do
+	rm -rf $TEMP_ROOT
+
+	N_KOSPI=$((N * 7 / 10 - 1))
+	N_ELW=$((N - N_KOSPI - 3))
+	DATA_PATH=$TEMP_ROOT/Data/20170101
+	REF_PATH=$TEMP_ROOT/DataRef/20170101
+
+	$BIN_PATH/convert_data -g $DATA_PATH $N_KOSPI $N_ELW > /dev/null || exit 1
+	$BIN_PATH/convert_data -r $DATA_PATH $REF_PATH      > /dev/null || exit 1
+
+	rm -f $BIN_PATH/log/sim.log
+
+	{ time $BIN_PATH/simserv $RUN_PATH/scale/scale.config $DATA_PATH $TCP_PORT > /dev/null 2>&1 ; } 2> $TEMP_ROOT/time_serv.txt &
+
+	# loading takes longer than usual on large days; simserv listens right after logging its load time
+	until grep -q '^\[Load\]' $BIN_PATH/log/sim.log 2> /dev/null; do
+		sleep 1
+	done
+	sleep 1
+
+	{ time $BIN_PATH/refclnt $RUN_PATH/reward.config $REF_PATH 127.0.0.1 $TCP_PORT > /dev/null 2>&1 ; } 2> $TEMP_ROOT/time_clnt.txt
+
+	wait
+
+	read TICKS P50 <<< $(awk '$1 == "[Latency]" && $2 == "buildMsg" { print $3, $5 }' $BIN_PATH/log/sim.log)
+	awk -v n=$N -v ticks=$TICKS -v p50=$P50 'FNR == 1 { ms[++i] = ($1 + $2) * 1000 / ticks }
+		END { printf "%d\t%d\t%.1f\t%.1f\t%s\n", n, ticks, ms[1], ms[2], p50 }' $TEMP_ROOT/time_serv.txt $TEMP_ROOT/time_clnt.txt
+
+	rm -rf $TEMP_ROOT
+done
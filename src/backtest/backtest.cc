@@ -0,0 +1,88 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <iomanip>
+
+#include <sibyl/server/Simulation/Simulation.h>
+#include <sibyl/client/Trader.h>
+#include <sibyl/DirectLink.h>
+#include <sibyl/util/OstreamRedirector.h>
+
+// simserv & refclnt in a single process, connected by DirectLink instead of TCP
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        std::cerr << "USAGE: backtest <config file> <data path> <reward config file> <ref path> [<next day> ...]\n"
+                     "   next day\tsimulate days in a row (data & ref at <path>/../<next day>; see simserv)" << std::endl;
+        exit(1);
+    }
+
+    std::string path(argv[0]);
+    path.resize(path.find_last_of('/'));
+
+    verify(system(std::string("mkdir -p " + path + "/log").c_str()) == 0);
+    verify(system(std::string("mkdir -p " + path + "/state").c_str()) == 0);
+
+    using namespace sibyl;
+
+    Simulation_dep simulation;
+    if (0 != simulation.LoadData(argv[1], argv[2]))
+        exit(1);
+    
+    std::vector<std::string> nextDays;
+    for (int iArg = 5; iArg < argc; iArg++)
+        nextDays.push_back(Simulation_dep::DayPath(argv[2], argv[iArg]));
+    simulation.SetNextDays(nextDays);
+
+    Trader trader;
+    trader.model.ReadConfig(argv[3]);
+    trader.model.SetRefPath(argv[4]);
+    trader.SetStateLogPaths(path + "/state", "");
+
+    DirectLink<OrderSim, ItemSim> link(&simulation, &trader);
+    link.SetVerbose(true);
+    {
+        OstreamRedirector redir(std::cout, path + "/log/sim.log");
+        simulation.GetLoadTime().Print(std::cout);
+        for (int ret; 0 <= (ret = link.RecvNextTick());)
+        {
+            if (ret > 0) // new day
+            {
+                trader.model.SetRefDay(trader.Day());
+                continue;
+            }
+            {
+                TickLatency::Scope scope(trader.latency, TickPhase::inference);
+                trader.model.GetRefData();
+            }
+            link.SendResponse();
+        }
+        simulation.latency.Print(std::cout, "server");
+        trader    .latency.Print(std::cout, "client");
+    }
+
+    std::cout << std::setprecision(6) << std::fixed;
+    if (nextDays.empty() == true)
+        std::cout << simulation.orderbook.GetProfitRate() << std::endl;
+    else
+    {
+        for (const auto &day_rate : simulation.GetDayRates())
+            std::cout << day_rate.first << '\t' << day_rate.second << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <iterator>
+#include <algorithm>
+
+#include <sibyl/server/OrderBook_data.h>
+
+using namespace sibyl;
+
+constexpr static std::size_t kOrdMax = 8;  // orders per item at most
+constexpr static int         kRange  = 12; // equal_range calls per item-second (ticks around the mid price)
+
+// Same item-second workload on either container (Security.ord used to be a std::multimap<INT, Order>):
+// mid price moves by a tick at times, an order is placed near it or a random one is filled or canceled,
+// then ord is read as OrderBook does (equal_range at the ticks around the mid price plus a full scan)
+template <class TMap>
+static INT64 Run(int nItems, int nSec, double &ms)
+{
+    std::vector<TMap> ords(nItems);
+    std::vector<INT>  mids(nItems, 1000);
+    std::mt19937 gen(1); // same sequence of operations for every container
+    std::uniform_int_distribution<int> pct(0, 99);
+    INT64 sum = 0;
+    
+    auto t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < nSec; s++)
+    {
+        for (int i = 0; i < nItems; i++)
+        {
+            auto &ord = ords[i];
+            INT  &mid = mids[i];
+            
+            int r = pct(gen);
+            if      (r < 10)                 mid++;
+            else if (r < 20 && mid > kRange) mid--;
+            
+            if (pct(gen) < 40 && ord.size() < kOrdMax)
+            {
+                Order o(mid - kRange / 2 + pct(gen) % kRange, 1 + pct(gen));
+                o.type = (o.p > mid ? OrdType::sell : OrdType::buy);
+                ord.insert(std::make_pair(o.p, o));
+            }
+            if (pct(gen) < 30 && ord.empty() == false)
+            {
+                auto it = std::begin(ord);
+                std::advance(it, pct(gen) % ord.size());
+                if (it->second.q > 10) it->second.q -= 10; // partially filled
+                else                   ord.erase(it);
+            }
+            
+            for (int k = 0; k < kRange; k++)
+            {
+                auto range = ord.equal_range(mid - kRange / 2 + k);
+                for (auto it = range.first; it != range.second; ++it) sum += it->second.q;
+            }
+            for (const auto &o : ord) sum += (INT64)o.first * o.second.q * (int)o.second.type;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+    
+    return sum;
+}
+
+// std::multimap vs OrderLadder as Security.ord, same workload, best of a few rounds
+int main(int argc, char *argv[])
+{
+    if (argc > 4)
+    {
+        std::cerr << "USAGE: bench_ladder [<# items> [<# seconds> [<# rounds>]]]\n"
+                     "   defaults\t2000 items, 2000 seconds, 5 rounds" << std::endl;
+        exit(1);
+    }
+    int nItems  = (argc > 1 ? std::stoi(argv[1]) : 2000);
+    int nSec    = (argc > 2 ? std::stoi(argv[2]) : 2000);
+    int nRounds = (argc > 3 ? std::stoi(argv[3]) : 5   );
+    verify(nItems > 0 && nSec > 0 && nRounds > 0);
+    
+    double msMap = 0.0, msLad = 0.0;
+    INT64 sumMap = 0, sumLad = 0;
+    for (int iR = 0; iR < nRounds; iR++) // alternate so that both see the same machine state
+    {
+        double ms;
+        sumMap = Run<std::multimap<INT, Order>>(nItems, nSec, ms);
+        msMap  = (iR == 0 ? ms : std::min(msMap, ms));
+        sumLad = Run<OrderLadder<Order>>       (nItems, nSec, ms);
+        msLad  = (iR == 0 ? ms : std::min(msLad, ms));
+    }
+    
+    std::cout << nItems << " items x " << nSec << " seconds, up to " << kOrdMax << " orders per item, "
+              << kRange << " equal_range calls + full scan per item-second (best of " << nRounds << ")\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "  std::multimap : " << std::setw(8) << msMap << " ms\n";
+    std::cout << "  OrderLadder   : " << std::setw(8) << msLad << " ms (x" << std::setprecision(2) << msMap / msLad << ")\n";
+    std::cout << "  checksum      : " << sumMap << (sumMap == sumLad ? " (match)" : " (MISMATCH)") << std::endl;
+    
+    return (sumMap == sumLad ? 0 : 1);
+}
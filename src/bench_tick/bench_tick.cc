@@ -0,0 +1,289 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+// Differential check & benchmark of Requantize and P2Tck against the find_if algorithms they replaced
+// (kept below as the reference), on the recorded tables of a day (<code>t.txt) and on random ladders
+
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <array>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <dirent.h>
+
+#include <sibyl/Security.h>
+
+using namespace sibyl;
+
+typedef std::array<PQ, idx::szTb> Tb;
+
+namespace reference
+{
+
+// RequantizeBy as of before the sorted merge: find_if of each out price in in
+template <class TRules>
+void RequantizeBy(Tb &in, INT trPs1, INT trPb1)
+{
+    if ((trPs1 <= 0) && (trPb1 <= 0)) { trPs1 = in[idx::ps1].p; trPb1 = in[idx::pb1].p; }
+    if ((trPs1 <= 0) && (trPb1 <= 0))                     return;
+    if ((trPs1 >  0) && (trPb1 >  0) && (trPs1 <= trPb1)) return;
+    Tb out;
+    out[idx::ps1].p = (trPb1 > 0 ? TRules::TckHi(trPb1) : trPs1);
+    out[idx::pb1].p = (trPs1 > 0 ? TRules::TckLo(trPs1) : trPb1);
+    for (auto iO = std::begin(out) + idx::ps1; iO > std::begin(out)  ; iO--) (iO - 1)->p = TRules::TckHi(iO->p);
+    for (auto iO = std::begin(out) + idx::pb1; iO < std::end(out) - 1; iO++) (iO + 1)->p = TRules::TckLo(iO->p);
+    for (auto &o : out) {
+        auto iI = std::find_if(std::begin(in), std::end(in), [&o](const PQ &i) { return i.p == o.p; });
+        o.q = (iI != std::end(in) ? iI->q : 0);
+    }
+    in = out;
+}
+
+// Security::P2Tck as of before the branch-free scan: find_if in each half
+template <class TOrder>
+int P2Tck(const Security<TOrder> &s, INT p, OrdType type)
+{
+    const auto &tbr = s.tbr;
+    int tck = (int)idx::tckN;
+    if (type == OrdType::sell) {
+        if (p == s.Ps0()) tck = -1;
+        else { // find_if [first, last)
+            auto first = std::begin(tbr);
+            auto last  = std::begin(tbr) + idx::ps1 + 1;
+            auto iT    = std::find_if(first, last, [&p](const PQ &tb) { return tb.p == p; });
+            if (iT != last) tck = (int)idx::ps1 - (int)(iT - first);
+        }
+    } else
+    if (type == OrdType::buy ) {
+        if (p == s.Pb0()) tck = -1;
+        else { // find_if [first, last)
+            auto first = std::begin(tbr) + idx::pb1;
+            auto last  = std::end(tbr);
+            auto iT    = std::find_if(first, last, [&p](const PQ &tb) { return tb.p == p; });
+            if (iT != last) tck = (int)(iT - first);
+        }
+    }
+    return tck;
+}
+
+}
+
+class ItemBench : public Security<PQ> {};
+
+struct Table
+{
+    Tb   tb;
+    bool isKOSPI; // KOSPI tick rules; 5-won rules otherwise (ELW, ETF)
+};
+
+// Tables of every <code>t.txt in path (ELW rows have a 3rd field per level, dropped as in TxtData)
+static int LoadTables(CSTR &path, bool isETF, std::vector<Table> &tables)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) return -1;
+    while (struct dirent *ent = readdir(dir))
+    {
+        STR name(ent->d_name);
+        if (name.size() <= 5 || name.compare(name.size() - 5, 5, "t.txt") != 0) continue;
+        FILE *pf = fopen((path + "/" + name).c_str(), "r");
+        if (pf == nullptr) continue;
+
+        constexpr static std::size_t szBuf = (1 << 12);
+        char bufLine[szBuf];
+        std::vector<long> vals;
+        while (fgets(bufLine, szBuf, pf) != NULL)
+        {
+            vals.clear();
+            char *pcEnd;
+            strtol(bufLine, &pcEnd, 10); // time
+            for (const char *pc = pcEnd; ; pc = pcEnd)
+            {
+                long v = strtol(pc, &pcEnd, 10);
+                if (pcEnd == pc) break;
+                vals.push_back(v);
+            }
+            std::size_t stride = (vals.size() >= 3 * (std::size_t)idx::szTb ? 3 : 2);
+            if (vals.size() < stride * (std::size_t)idx::szTb) break;
+            Table t;
+            for (std::size_t i = 0; i < (std::size_t)idx::szTb; i++) t.tb[i] = PQ((INT)vals[i * stride], (INT)vals[i * stride + 1]);
+            t.isKOSPI = (isETF == false && stride == 2);
+            tables.push_back(t);
+        }
+        fclose(pf);
+    }
+    closedir(dir);
+    return 0;
+}
+
+class Checker
+{
+public:
+    long nChecks, nSorted, nMismatches;
+    std::mt19937 gen; // random prices to P2Tck (also drawn from for the random ladders)
+
+    // Requantize of in (new vs reference), then P2Tck at every level, ps0/pb0 and a random price
+    void Check(const Tb &in, INT trPs1, INT trPb1, bool isKOSPI)
+    {
+        Tb x = in, y = in;
+        if (isKOSPI == true) { reference::RequantizeBy<KOSPIRules>(x, trPs1, trPb1); RequantizeBy<KOSPIRules>(y, trPs1, trPb1); }
+        else                 { reference::RequantizeBy<Tick5Rules>(x, trPs1, trPb1); RequantizeBy<Tick5Rules>(y, trPs1, trPb1); }
+        nChecks++;
+        nSorted     += std::is_sorted(std::begin(in), std::end(in), [](const PQ &a, const PQ &b) { return a.p > b.p; });
+        nMismatches += (x != y);
+
+        Security<PQ> &s = (isKOSPI == true ? (Security<PQ>&)kospi : (Security<PQ>&)elw);
+        s.tbr = y;
+        for (int j = 0; j < idx::szTb + 3; j++)
+        {
+            INT p = (j < idx::szTb ? y[j].p : (j == idx::szTb ? s.Ps0() : (j == idx::szTb + 1 ? s.Pb0() : (INT)(gen() % 1000) * 5)));
+            for (OrdType type : {OrdType::sell, OrdType::buy})
+                nMismatches += (reference::P2Tck(s, p, type) != s.P2Tck(p, type));
+        }
+    }
+
+    Checker() : nChecks(0), nSorted(0), nMismatches(0), gen(7) {}
+private:
+    KOSPI<ItemBench> kospi;
+    ELW  <ItemBench> elw;
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double NsPer(bench_clock::time_point t0, bench_clock::time_point t1, std::size_t n)
+{
+    return std::chrono::duration<double, std::nano>(t1 - t0).count() / (double)n;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        std::cerr << "USAGE: bench_tick <data path> [<# random ladders>]\n"
+                     "   data path\tday of text data; tables of <data path>/*t.txt & <data path>/ETF/*t.txt are used\n"
+                     "   defaults\t2000000 random ladders" << std::endl;
+        exit(1);
+    }
+    STR path(argv[1]);
+    if (path.back() == '/') path.pop_back();
+    long nRandom = (argc > 2 ? std::stol(argv[2]) : 2000000);
+
+    std::vector<Table> tables;
+    if (LoadTables(path, false, tables) != 0)
+    {
+        std::cerr << "bench_tick: " << path << " inaccessible" << std::endl;
+        exit(1);
+    }
+    LoadTables(path + "/ETF", true, tables); // optional
+    if (tables.empty() == true)
+    {
+        std::cerr << "bench_tick: no table in " << path << std::endl;
+        exit(1);
+    }
+
+    // Differential check: recorded tables with 4 trade price variants each, then random ladders
+    // (unsorted or sorted, with empty levels & duplicate prices) under either tick rules
+    Checker checker;
+    for (const auto &t : tables)
+    {
+        checker.Check(t.tb, 0                      , 0                      , t.isKOSPI);
+        checker.Check(t.tb, t.tb[idx::ps1].p       , 0                      , t.isKOSPI);
+        checker.Check(t.tb, 0                      , t.tb[idx::pb1].p       , t.isKOSPI);
+        checker.Check(t.tb, t.tb[idx::ps1 - 2].p   , t.tb[idx::pb1 + 1].p   , t.isKOSPI);
+    }
+    auto &gen = checker.gen;
+    for (long r = 0; r < nRandom; r++)
+    {
+        Tb tb;
+        bool isKOSPI = ((gen() & 1) != 0);
+        INT  base    = (isKOSPI == true ? 1 + (INT)(gen() % 600000) : 5 * (INT)(gen() % 400));
+        for (auto &x : tb)
+        {
+            x.p = (gen() % 4 == 0 ? 0 : base + (INT)(gen() % 40) * (isKOSPI == true ? 1 : 5) - 100);
+            x.q = (INT)(gen() % 100);
+        }
+        if ((gen() & 1) != 0) std::sort(std::begin(tb), std::end(tb), [](const PQ &a, const PQ &b) { return a.p > b.p; });
+        INT trPs1 = (gen() % 3 != 0 ? tb[gen() % idx::szTb].p : 0);
+        INT trPb1 = (gen() % 3 != 0 ? tb[gen() % idx::szTb].p : 0);
+        checker.Check(tb, trPs1, trPb1, isKOSPI);
+    }
+    std::cout << "Check:  " << tables.size() << " recorded tables + " << nRandom << " random ladders, "
+              << checker.nChecks << " Requantize calls (" << checker.nSorted << " sorted inputs), "
+              << checker.nMismatches << " mismatches" << std::endl;
+
+    // Benchmark on the recorded tables, best of 5; each is requantized as the server does on arrival,
+    // then P2Tck is called on the requantized table at every 3rd level for either side
+    KOSPI<ItemBench> kospi;
+    ELW  <ItemBench> elw;
+    std::vector<Tb> tbReq(tables.size());
+    const std::size_t nP2Tck = tables.size() * 14;
+    double nsReqOld = 1e30, nsReqNew = 1e30, nsTckOld = 1e30, nsTckNew = 1e30;
+    INT64 sumOld = 0, sumNew = 0;
+    for (int iR = 0; iR < 5; iR++)
+    {
+        sumOld = sumNew = 0;
+        auto t0 = bench_clock::now();
+        for (std::size_t i = 0; i < tables.size(); i++)
+        {
+            Tb tb = tables[i].tb;
+            if (tables[i].isKOSPI == true) reference::RequantizeBy<KOSPIRules>(tb, tb[idx::ps1].p, tb[idx::pb1].p);
+            else                           reference::RequantizeBy<Tick5Rules>(tb, tb[idx::ps1].p, tb[idx::pb1].p);
+            sumOld += tb[0].q;
+        }
+        auto t1 = bench_clock::now();
+        for (std::size_t i = 0; i < tables.size(); i++)
+        {
+            Security<PQ> &s = (tables[i].isKOSPI == true ? (Security<PQ>&)kospi : (Security<PQ>&)elw);
+            s.tbr = tables[i].tb;
+            s.Requantize();
+            tbReq[i] = s.tbr;
+            sumNew += s.tbr[0].q;
+        }
+        auto t2 = bench_clock::now();
+        for (std::size_t i = 0; i < tables.size(); i++)
+        {
+            Security<PQ> &s = (tables[i].isKOSPI == true ? (Security<PQ>&)kospi : (Security<PQ>&)elw);
+            s.tbr = tbReq[i];
+            for (int j = 0; j < idx::szTb; j += 3)
+                sumOld += reference::P2Tck(s, tables[i].tb[j].p, OrdType::sell) + reference::P2Tck(s, tables[i].tb[j].p, OrdType::buy);
+        }
+        auto t3 = bench_clock::now();
+        for (std::size_t i = 0; i < tables.size(); i++)
+        {
+            Security<PQ> &s = (tables[i].isKOSPI == true ? (Security<PQ>&)kospi : (Security<PQ>&)elw);
+            s.tbr = tbReq[i];
+            for (int j = 0; j < idx::szTb; j += 3)
+                sumNew += s.P2Tck(tables[i].tb[j].p, OrdType::sell) + s.P2Tck(tables[i].tb[j].p, OrdType::buy);
+        }
+        auto t4 = bench_clock::now();
+        nsReqOld = std::min(nsReqOld, NsPer(t0, t1, tables.size()));
+        nsReqNew = std::min(nsReqNew, NsPer(t1, t2, tables.size()));
+        nsTckOld = std::min(nsTckOld, NsPer(t2, t3, nP2Tck));
+        nsTckNew = std::min(nsTckNew, NsPer(t3, t4, nP2Tck));
+    }
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Bench:  " << tables.size() << " recorded tables (best of 5; reference -> current)\n"
+              << "  Requantize " << std::setw(8) << nsReqOld << " -> " << std::setw(8) << nsReqNew << " ns/table\n"
+              << "  P2Tck      " << std::setw(8) << nsTckOld << " -> " << std::setw(8) << nsTckNew << " ns/call\n"
+              << "  checksum   " << sumOld << (sumOld == sumNew ? " (match)" : " (MISMATCH)") << std::endl;
+
+    return (checker.nMismatches == 0 && sumOld == sumNew ? 0 : 1);
+}
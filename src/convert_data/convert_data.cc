@@ -0,0 +1,426 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Converts market data text files of a day (<data path>/*.txt, <data path>/ETF/*.txt)
+// to the binary columnar format read by TxtData (see server/Simulation/BinData.h)
+// Also generates synthetic days of any number of items (and random ref data for refclnt) for scaling measurements
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <random>
+#include <algorithm>
+#include <dirent.h>
+
+#include <sibyl/server/Simulation/BinData.h>
+#include <sibyl/server/Simulation/TxtData.h>
+#include <sibyl/Security.h>
+
+using namespace sibyl;
+
+// Returns number of rows written, -1 on failure
+static long ConvertFile(CSTR &filename, BinKind kind, BinElem elem)
+{
+    FILE *pf = fopen(filename.c_str(), "r");
+    if (pf == nullptr)
+    {
+        std::cerr << "convert_data: " << filename << " inaccessible" << std::endl;
+        return -1;
+    }
+
+    constexpr static std::size_t szBuf = (1 << 12);
+    char bufLine[szBuf];
+
+    std::vector<int32_t>             time;
+    std::vector<std::vector<double>> cols;
+    std::vector<double>              vals;
+    std::size_t nCols = 0;
+    int nFieldsTb = 0; // 41 for KOSPI/ETF, 61 for ELW (3rd field of each pair dropped)
+
+    while (fgets(bufLine, szBuf, pf) != NULL)
+    {
+        // parse as TxtData::AdvanceLine and each ReadLine would
+        int t;
+        if (1 != sscanf(bufLine, "%d", &t)) break;
+
+        vals.clear();
+        if (kind == BinKind::vec)
+        {
+            for (const char *pcWord = strchr(bufLine, '\t'); pcWord != NULL; pcWord = strchr(pcWord, '\t'))
+            {
+                while (*pcWord == '\t') pcWord++;
+                char *pcEnd;
+                double v = (elem == BinElem::f32 ? (double)strtof(pcWord, &pcEnd) : strtod(pcWord, &pcEnd));
+                if (pcEnd == pcWord) break;
+                vals.push_back(v);
+            }
+        }
+        else
+        {
+            const char *pc = bufLine;
+            char *pcEnd;
+            strtol(pc, &pcEnd, 10); // time
+            for (pc = pcEnd; ; pc = pcEnd)
+            {
+                long v = strtol(pc, &pcEnd, 10);
+                if (pcEnd == pc) break;
+                vals.push_back((double)v);
+            }
+        }
+
+        if (time.empty() == true) // first line determines number of columns
+        {
+            if (kind == BinKind::tr) nCols = 4;
+            if (kind == BinKind::tb)
+            {
+                nFieldsTb = (vals.size() + 1 >= 61 ? 61 : 41);
+                nCols = (std::size_t)idx::szTb * 2;
+            }
+            if (kind == BinKind::vec) nCols = vals.size();
+            if (nCols == 0) break;
+            cols.resize(nCols);
+        }
+
+        bool invalid = false;
+        if (kind == BinKind::tr)
+        {
+            if (vals.size() < 4) invalid = true;
+            else for (std::size_t c = 0; c < 4; c++) cols[c].push_back(vals[c]);
+        }
+        if (kind == BinKind::tb)
+        {
+            if (vals.size() + 1 < (std::size_t)nFieldsTb) invalid = true;
+            else
+            {
+                std::size_t stride = (nFieldsTb == 61 ? 3 : 2);
+                for (std::size_t i = 0; i < (std::size_t)idx::szTb; i++)
+                {
+                    cols[i            ].push_back(vals[i * stride + 0]);
+                    cols[i + idx::szTb].push_back(vals[i * stride + 1]);
+                }
+            }
+        }
+        if (kind == BinKind::vec)
+        {
+            if (vals.size() < nCols) invalid = true;
+            else for (std::size_t c = 0; c < nCols; c++) cols[c].push_back(vals[c]);
+        }
+        if (invalid == true)
+        {
+            std::cerr << "convert_data: invalid format in " << filename << ", truncated at\n" << bufLine << std::endl;
+            break;
+        }
+        time.push_back((int32_t)TxtData::Txt2Time(t));
+    }
+    fclose(pf);
+
+    if (time.empty() == true)
+    {
+        std::cerr << "convert_data: " << filename << " has no valid line" << std::endl;
+        return -1;
+    }
+
+    STR filenameBin = filename.substr(0, filename.size() - 4) + ".bin";
+    if (BinData::Write(filenameBin, kind, elem, time, cols) == false)
+    {
+        std::cerr << "convert_data: " << filenameBin << " write failed" << std::endl;
+        return -1;
+    }
+    return (long)time.size();
+}
+
+// Deduce format from file name; returns false for files not read by TxtData
+static bool FileKind(CSTR &name, BinKind &kind, BinElem &elem)
+{
+    if (name.size() <= 4 || name.compare(name.size() - 4, 4, ".txt") != 0) return false;
+    STR base = name.substr(0, name.size() - 4);
+    if (base == "KOSPI200") { kind = BinKind::vec; elem = BinElem::f32; return true; }
+
+    std::size_t nDigits = 0;
+    while (nDigits < base.size() && isdigit(base[nDigits]) != 0) nDigits++;
+    if (nDigits == 0) return false;
+    STR suffix = base.substr(nDigits);
+    if (suffix == "" ) { kind = BinKind::tr ; elem = BinElem::i32; return true; }
+    if (suffix == "t") { kind = BinKind::tb ; elem = BinElem::i32; return true; }
+    if (suffix == "g") { kind = BinKind::vec; elem = BinElem::f32; return true; } // TxtDataVec<FLOAT>
+    if (suffix == "n") { kind = BinKind::vec; elem = BinElem::f64; return true; } // TxtDataVec<double>
+    return false; // info files (<code>i.txt) etc.
+}
+
+static int ConvertDir(CSTR &path)
+{
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr)
+    {
+        std::cerr << "convert_data: " << path << " inaccessible" << std::endl;
+        return -1;
+    }
+    int nFail = 0, nFile = 0;
+    while (struct dirent *ent = readdir(dir))
+    {
+        STR name(ent->d_name);
+        BinKind kind;
+        BinElem elem;
+        if (FileKind(name, kind, elem) == false) continue;
+        if (ConvertFile(path + "/" + name, kind, elem) < 0) nFail++;
+        else                                                nFile++;
+    }
+    closedir(dir);
+    std::cout << path << ": " << nFile << " files converted" << (nFail > 0 ? ", " + std::to_string(nFail) + " failed" : "") << std::endl;
+    return nFail;
+}
+
+// Converts <data path> and its optional ETF subdirectory; returns number of directories failed
+static int ConvertDay(CSTR &path)
+{
+    int nFail = 0;
+    if (ConvertDir(path) != 0) nFail++;
+
+    DIR *dirETF = opendir((path + "/ETF").c_str()); // optional
+    if (dirETF != nullptr)
+    {
+        closedir(dirETF);
+        if (ConvertDir(path + "/ETF") != 0) nFail++;
+    }
+    return nFail;
+}
+
+// HHMMSS of t (seconds from 09:00:00), as in the data files
+static STR TimeTxt(int t)
+{
+    int s = t + 9 * 3600;
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%02d%02d%02d", s / 3600, (s / 60) % 60, s % 60);
+    return STR(buf);
+}
+
+// Writes text files of a synthetic item (<code>.txt, <code>t.txt, and <code>g.txt & <code>i.txt or <code>n.txt)
+// A table row in 35% of the seconds from 08:00:00 to 15:41:40, each moving the mid price a tick in 30% of the rows;
+// 1-3 trades at ps1/pb1 (or the next tick) in 70% of the rows from 08:50:00
+template <class TRules>
+static int GenerateItem(CSTR &path, CSTR &code, SecType type, INT p0, std::mt19937 &gen)
+{
+    STR nameVec = (type == SecType::ELW ? "g.txt" : (type == SecType::ETF ? "n.txt" : ""));
+    FILE *pfTr  = fopen((path + code + ".txt" ).c_str(), "w");
+    FILE *pfTb  = fopen((path + code + "t.txt").c_str(), "w");
+    FILE *pfVec = (nameVec.empty() == false ? fopen((path + code + nameVec).c_str(), "w") : nullptr);
+    if (pfTr == nullptr || pfTb == nullptr || (nameVec.empty() == false && pfVec == nullptr))
+    {
+        for (FILE *pf : {pfTr, pfTb, pfVec}) if (pf != nullptr) fclose(pf);
+        std::cerr << "convert_data: " << path << code << " not writable" << std::endl;
+        return -1;
+    }
+
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    auto U = [&]()             { return uni(gen);                                           };
+    auto I = [&](int a, int b) { return std::uniform_int_distribution<int>(a, b)(gen);      };
+    const INT mul = (type == SecType::ELW ? 10 : 1); // quantity unit
+
+    INT mid = p0;
+    for (int t = -3600; t < 24100; t++)
+    {
+        if (U() >= 0.35) continue;
+        if (U() < 0.3) mid = std::max((U() < 0.5 ? TRules::TckLo(mid) : TRules::TckHi(mid)), (INT)100);
+
+        INT ps[idx::szTb / 2], pb[idx::szTb / 2]; // ps[0]: ps1, pb[0]: pb1
+        ps[0] = TRules::TckHi(mid);
+        pb[0] = mid;
+        for (int k = 1; k < idx::szTb / 2; k++)
+        {
+            ps[k] = TRules::TckHi(ps[k - 1]);
+            pb[k] = TRules::TckLo(pb[k - 1]);
+        }
+
+        STR txt = TimeTxt(t);
+        const char *fmtPQ = (type == SecType::ELW ? " %d %d 0" : " %d %d");
+        fputs(txt.c_str(), pfTb);
+        for (int k = idx::szTb / 2 - 1; k >= 0; k--) fprintf(pfTb, fmtPQ, ps[k], I(1, 500) * mul);
+        for (int k = 0; k < idx::szTb / 2; k++)      fprintf(pfTb, fmtPQ, pb[k], I(1, 500) * mul);
+        fputc('\n', pfTb);
+
+        if (U() < 0.7 && t >= -600)
+        {
+            for (int n = I(1, 3); n > 0; n--)
+            {
+                bool isAsk = (I(0, 1) == 0);
+                INT p = (isAsk == true ? ps[0] : pb[0]);
+                if (U() < 0.2) p = (isAsk == true ? ps[1] : pb[1]);
+                INT q = I(1, 300) * mul;
+                fprintf(pfTr, "%s %d %d %d %d\n", txt.c_str(), (isAsk == true ? q : -q), p, ps[0], pb[0]);
+            }
+        }
+
+        if (type == SecType::ELW)
+        {
+            fprintf(pfVec, "%s\t1.0", txt.c_str());
+            for (int k = 0; k < 8; k++) fprintf(pfVec, "\t%.4f", U());
+            fputc('\n', pfVec);
+        }
+        if (type == SecType::ETF)
+            fprintf(pfVec, "%s\t%.2f\t%.2f\n", txt.c_str(), mid * 1.001, (double)mid);
+    }
+    for (FILE *pf : {pfTr, pfTb, pfVec}) if (pf != nullptr) fclose(pf);
+
+    if (type == SecType::ELW)
+    {
+        FILE *pf = fopen((path + code + "i.txt").c_str(), "w");
+        if (pf == nullptr)
+        {
+            std::cerr << "convert_data: " << path << code << "i.txt not writable" << std::endl;
+            return -1;
+        }
+        fprintf(pf, "TYPE=%c\nEXPIRY=%d\nNAME=XX KOSPI200 CALL\n", (I(0, 1) == 0 ? 'c' : 'p'), I(10, 100));
+        fclose(pf);
+    }
+    return 0;
+}
+
+// Synthetic day of nKOSPI KOSPI items (plus 005930), nELW ELWs and 2 ETFs, in text files at path
+static int GenerateDay(CSTR &path, int nKOSPI, int nELW, unsigned seed)
+{
+    if (0 != system(STR("mkdir -p " + path + "/ETF").c_str()))
+    {
+        std::cerr << "convert_data: " << path << " not writable" << std::endl;
+        return -1;
+    }
+    std::mt19937 gen(seed);
+    auto Pick = [&](std::initializer_list<INT> ps) { return *(std::begin(ps) + std::uniform_int_distribution<int>(0, (int)ps.size() - 1)(gen)); };
+    char code[8];
+
+    int nFail = 0;
+    for (int k = 0; k < nKOSPI; k++)
+    {
+        snprintf(code, sizeof(code), "%06d", 100000 + k * 7);
+        nFail += (GenerateItem<KOSPIRules>(path + "/", code, SecType::KOSPI, Pick({3000, 8000, 36000, 72000, 150000}), gen) != 0);
+    }
+    nFail += (GenerateItem<KOSPIRules>(path + "/", "005930", SecType::KOSPI, 1500000, gen) != 0);
+    for (int k = 0; k < nELW; k++)
+    {
+        snprintf(code, sizeof(code), "5%05d", k * 3 + 1);
+        nFail += (GenerateItem<Tick5Rules>(path + "/", code, SecType::ELW, Pick({300, 500, 1200}), gen) != 0);
+    }
+    for (int k = 0; k < 2; k++)
+    {
+        snprintf(code, sizeof(code), "0695%02d", k + 10);
+        nFail += (GenerateItem<Tick5Rules>(path + "/ETF/", code, SecType::ETF, 20000, gen) != 0);
+    }
+
+    FILE *pf = fopen((path + "/KOSPI200.txt").c_str(), "w");
+    if (pf == nullptr) nFail++;
+    else
+    {
+        std::uniform_real_distribution<double> uni(0.0, 1.0);
+        for (int t = -3600; t < 24100; t += 7) fprintf(pf, "%s\t%.2f\n", TimeTxt(t).c_str(), 250 + uni(gen));
+        fclose(pf);
+    }
+
+    std::cout << path << ": " << nKOSPI + 1 + nELW + 2 << " items generated" << (nFail > 0 ? ", " + std::to_string(nFail) + " failed" : "") << std::endl;
+    return nFail;
+}
+
+// Random ref data (<code>.ref, read by refclnt) for every item (<code>t.txt) in pathData & pathData/ETF
+// 42 floats per tick in [kTimeBounds::init, kTimeBounds::stop), each positive with 8% probability
+static int GenerateRef(CSTR &pathData, CSTR &pathRef, unsigned seed)
+{
+    if (0 != system(STR("mkdir -p " + pathRef).c_str()))
+    {
+        std::cerr << "convert_data: " << pathRef << " not writable" << std::endl;
+        return -1;
+    }
+    std::vector<STR> codes;
+    for (CSTR &path : {pathData, pathData + "/ETF"})
+    {
+        DIR *dir = opendir(path.c_str());
+        if (dir == nullptr) continue; // ETF is optional
+        while (struct dirent *ent = readdir(dir))
+        {
+            STR name(ent->d_name);
+            BinKind kind;
+            BinElem elem;
+            if (FileKind(name, kind, elem) == true && kind == BinKind::tb) codes.push_back(name.substr(0, name.size() - 5));
+        }
+        closedir(dir);
+    }
+    std::sort(std::begin(codes), std::end(codes)); // independent of directory order
+
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> uni(0.0, 1.0);
+    constexpr static int dimRef = 42;
+    int nFail = 0;
+    for (CSTR &code : codes)
+    {
+        FILE *pf = fopen((pathRef + "/" + code + ".ref").c_str(), "wb");
+        if (pf == nullptr)
+        {
+            nFail++;
+            continue;
+        }
+        float bufRef[dimRef];
+        for (int t = kTimeBounds::init; t < kTimeBounds::stop; t += kTimeRates::secPerTick)
+        {
+            for (auto &v : bufRef) v = (float)(uni(gen) < 0.08 ? 0.0001 + uni(gen) * (0.01 - 0.0001) : -uni(gen) * 0.01);
+            fwrite(bufRef, sizeof(float), dimRef, pf);
+        }
+        fclose(pf);
+    }
+    std::cout << pathRef << ": " << codes.size() - nFail << " ref files generated" << (nFail > 0 ? ", " + std::to_string(nFail) + " failed" : "") << std::endl;
+    return nFail;
+}
+
+int main(int argc, char *argv[])
+{
+    STR opt(argc > 1 ? argv[1] : "");
+    if ((argc < 2) ||
+        (opt == "-g" && (argc < 5 || argc > 6)) ||
+        (opt == "-r" && (argc < 4 || argc > 5)))
+    {
+        std::cerr << "USAGE: convert_data <data path> [<data path> ...]\n"
+                     "       convert_data -g <data path> <# KOSPI> <# ELW> [<seed>]\n"
+                     "       convert_data -r <data path> <ref path> [<seed>]\n"
+                     "   -g\tgenerate a synthetic day of <# KOSPI> + 1 KOSPI items, <# ELW> ELWs and 2 ETFs at <data path> & convert it\n"
+                     "   -r\tgenerate random ref data (for refclnt) of the items at <data path>" << std::endl;
+        exit(1);
+    }
+
+    if (opt == "-g")
+    {
+        STR path(argv[2]);
+        if (path.back() == '/') path.pop_back();
+        int nKOSPI = std::stoi(argv[3]), nELW = std::stoi(argv[4]);
+        verify(nKOSPI >= 0 && nELW >= 0);
+        if (GenerateDay(path, nKOSPI, nELW, (argc > 5 ? (unsigned)std::stoul(argv[5]) : 1)) != 0) return 1;
+        return (ConvertDay(path) == 0 ? 0 : 1);
+    }
+    if (opt == "-r")
+    {
+        STR pathData(argv[2]), pathRef(argv[3]);
+        if (pathData.back() == '/') pathData.pop_back();
+        if (pathRef .back() == '/') pathRef .pop_back();
+        return (GenerateRef(pathData, pathRef, (argc > 4 ? (unsigned)std::stoul(argv[4]) : 7)) == 0 ? 0 : 1);
+    }
+
+    int nFail = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        STR path(argv[i]);
+        if (path.back() == '/') path.pop_back();
+        nFail += ConvertDay(path);
+    }
+
+    return (nFail == 0 ? 0 : 1);
+}
@@ -15,7 +15,7 @@
 */
 
 #include "TradeDataSet.h"
-#include <sibyl/server/Simulation/Simulation_dep.h>
+#include <sibyl/server/Simulation/Simulation.h>
 
 #include <cstring>
 #include <fstream>
@@ -304,7 +304,7 @@ const unsigned long TradeDataSet::ReadRawFile(std::vector<fractal::FLOAT> &vec,
         fclose(f);
         isELW = true;
         
-        int te = sibyl::Simulation::ReadTypeExpiry(path, code);
+        int te = sibyl::SimulationBase::ReadTypeExpiry(path, code);
         verify(te != 0);
         
         state.isELW  = true;
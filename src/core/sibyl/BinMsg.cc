@@ -0,0 +1,270 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "BinMsg.h"
+
+#include <cstring>
+#include <cstddef>
+
+namespace sibyl
+{
+
+namespace
+{
+
+// Appends fixed size values to a frame; header is filled in by Finish
+class Writer
+{
+public:
+    Writer(std::vector<char> &buf_, uint32_t magic) : buf(buf_) {
+        buf.resize(sizeof(BinMsg::Header));
+        BinMsg::Header h;
+        h.magic = magic;
+        h.size  = 0;
+        memcpy(buf.data(), &h, sizeof(h));
+    }
+    template <class T>
+    void Put(T val) {
+        std::size_t pos = buf.size();
+        buf.resize(pos + sizeof(T));
+        memcpy(buf.data() + pos, &val, sizeof(T));
+    }
+    void PutVar(int64_t val) { // zigzag LEB128
+        uint64_t u = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+        while (u >= 0x80) {
+            buf.push_back((char)(u | 0x80));
+            u >>= 7;
+        }
+        buf.push_back((char)u);
+    }
+    void PutCode(CSTR &code) {
+        verify(code.size() <= BinMsg::szCode);
+        std::size_t pos = buf.size();
+        buf.resize(pos + BinMsg::szCode, '\0');
+        memcpy(buf.data() + pos, code.data(), code.size());
+    }
+    void PutStr(CSTR &str) { buf.insert(std::end(buf), std::begin(str), std::end(str)); }
+    void Finish() {
+        uint32_t size = (uint32_t)(buf.size() - sizeof(BinMsg::Header));
+        memcpy(buf.data() + offsetof(BinMsg::Header, size), &size, sizeof(size));
+    }
+private:
+    std::vector<char> &buf;
+};
+
+// Reads fixed size values from a payload; fail is set (and values are 0) on reading past the end
+class Reader
+{
+public:
+    Reader(const char *p_, std::size_t size) : p(p_), end(p_ + size), fail(false) {}
+    template <class T>
+    T Get() {
+        T val{};
+        if (Check(sizeof(T)) == true) { memcpy(&val, p, sizeof(T)); p += sizeof(T); }
+        return val;
+    }
+    int64_t GetVar() {
+        uint64_t u = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (Check(1) == false) return 0;
+            uint8_t byte = (uint8_t)*p++;
+            u |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+        }
+        fail = true;
+        return 0;
+    }
+    void GetCode(STR &code) {
+        if (Check(BinMsg::szCode) == false) { code.clear(); return; }
+        code.assign(p, strnlen(p, BinMsg::szCode));
+        p += BinMsg::szCode;
+    }
+    std::size_t Left() const { return (std::size_t)(end - p); }
+    bool Fail() const { return fail || p != end; } // call after reading everything
+private:
+    const char *p, *end;
+    bool fail;
+    bool Check(std::size_t len) {
+        if (fail == false && len <= Left()) return true;
+        fail = true;
+        return false;
+    }
+};
+
+}
+
+void BinMsg::EncodeState(const StateMsg &state, std::vector<char> &buf)
+{
+    Writer w(buf, kMagicState);
+    w.PutVar(state.time);
+    w.PutVar(state.bal);
+    w.PutVar(state.sum.buy);
+    w.PutVar(state.sum.sell);
+    w.PutVar(state.sum.feetax);
+    for (const auto &s : state.sum.tck_orig) {
+        w.PutVar(s.bal);
+        w.PutVar(s.q);
+        w.PutVar(s.evt);
+    }
+    w.Put<float>(state.kospi200);
+    w.PutVar((int64_t)state.items.size());
+    for (const auto &i : state.items)
+    {
+        w.PutCode(i.code);
+        w.Put<uint8_t>((uint8_t)i.type);
+        w.Put<float>(i.pr);
+        w.PutVar(i.qr);
+        w.PutVar(i.tbrMask);
+        INT pLast = 0;
+        for (std::size_t idx = 0; idx < idx::szTb; idx++) {
+            if ((i.tbrMask & (1u << idx)) == 0) continue;
+            w.PutVar(i.tbr[idx].p - pLast);
+            w.PutVar(i.tbr[idx].q);
+            pLast = i.tbr[idx].p;
+        }
+        if (i.type == SecType::ELW) {
+            w.PutVar(i.iCP);
+            w.PutVar(i.expiry);
+            for (const auto &th : i.thr) w.Put<float>(th);
+        }
+        if (i.type == SecType::ETF)
+            w.Put<float>(i.devNAV);
+        w.PutVar(i.cnt);
+        w.PutVar((int64_t)i.ord.size());
+        pLast = 0;
+        for (const auto &pq : i.ord) {
+            w.PutVar(pq.p - pLast);
+            w.PutVar(pq.q);
+            pLast = pq.p;
+        }
+    }
+    w.Finish();
+}
+
+void BinMsg::EncodeReqs(const std::vector<ReqMsg> &reqs, std::vector<char> &buf)
+{
+    Writer w(buf, kMagicReqs);
+    w.PutVar((int64_t)reqs.size());
+    for (const auto &r : reqs)
+    {
+        w.Put<uint8_t>((uint8_t)r.type);
+        w.PutCode(r.code);
+        w.PutVar(r.p);
+        w.PutVar(r.q);
+        w.PutVar(r.mp);
+    }
+    w.Finish();
+}
+
+void BinMsg::EncodeDay(CSTR &name, std::vector<char> &buf)
+{
+    Writer w(buf, kMagicDay);
+    w.PutStr(name);
+    w.Finish();
+}
+
+void BinMsg::EncodeText(CSTR &msg, std::vector<char> &buf)
+{
+    Writer w(buf, kMagicText);
+    w.PutStr(msg);
+    w.Finish();
+}
+
+int BinMsg::DecodeState(const char *payload, std::size_t size, StateMsg &state)
+{
+    Reader r(payload, size);
+    state.time       = (int)r.GetVar();
+    state.bal        = r.GetVar();
+    state.sum.buy    = r.GetVar();
+    state.sum.sell   = r.GetVar();
+    state.sum.feetax = r.GetVar();
+    for (auto &s : state.sum.tck_orig) {
+        s.bal = r.GetVar();
+        s.q   = r.GetVar();
+        s.evt = r.GetVar();
+    }
+    state.kospi200 = r.Get<float>();
+
+    auto nItems = (uint64_t)r.GetVar();
+    if (nItems > r.Left()) return -1; // each item takes more than a byte
+    state.items.resize((std::size_t)nItems);
+    for (auto &i : state.items)
+    {
+        r.GetCode(i.code);
+        uint8_t type = r.Get<uint8_t>();
+        if (type > (uint8_t)SecType::ETF) return -1;
+        i.type = (SecType)type;
+        i.pr   = r.Get<float>();
+        i.qr   = r.GetVar();
+        auto mask = (uint64_t)r.GetVar();
+        if (mask > ItemMsg::kTbrAll) return -1;
+        i.tbrMask = (uint32_t)mask;
+        INT pLast = 0;
+        for (std::size_t idx = 0; idx < idx::szTb; idx++) {
+            auto &pq = i.tbr[idx];
+            if ((i.tbrMask & (1u << idx)) == 0) { pq = PQ(); continue; }
+            pq.p  = pLast + (INT)r.GetVar();
+            pq.q  = (INT)r.GetVar();
+            pLast = pq.p;
+        }
+        if (i.type == SecType::ELW) {
+            i.iCP    = (int)r.GetVar();
+            i.expiry = (int)r.GetVar();
+            for (auto &th : i.thr) th = r.Get<float>();
+        }
+        if (i.type == SecType::ETF)
+            i.devNAV = r.Get<float>();
+        i.cnt = (INT)r.GetVar();
+
+        auto nOrd = (uint64_t)r.GetVar();
+        if (nOrd > r.Left()) return -1;
+        i.ord.resize((std::size_t)nOrd);
+        pLast = 0;
+        for (auto &pq : i.ord) {
+            pq.p  = pLast + (INT)r.GetVar();
+            pq.q  = (INT)r.GetVar();
+            pLast = pq.p;
+        }
+    }
+    return (r.Fail() == false ? 0 : -1);
+}
+
+int BinMsg::DecodeReqs(const char *payload, std::size_t size, std::vector<ReqMsg> &reqs)
+{
+    Reader r(payload, size);
+    auto nReqs = (uint64_t)r.GetVar();
+    if (nReqs > r.Left()) return -1;
+    reqs.resize((std::size_t)nReqs);
+    for (auto &req : reqs)
+    {
+        uint8_t type = r.Get<uint8_t>();
+        if (type > (uint8_t)ReqType::sa) return -1;
+        req.type = (ReqType)type;
+        r.GetCode(req.code);
+        req.p  = (INT)r.GetVar();
+        req.q  = (INT)r.GetVar();
+        req.mp = (INT)r.GetVar();
+    }
+    return (r.Fail() == false ? 0 : -1);
+}
+
+int BinMsg::DecodeDay(const char *payload, std::size_t size, STR &name)
+{
+    name.assign(payload, size);
+    return 0;
+}
+
+}
@@ -0,0 +1,89 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_BINMSG_H_
+#define SIBYL_BINMSG_H_
+
+#include <vector>
+#include <cstdint>
+
+#include "TickMsg.h"
+
+namespace sibyl
+{
+
+// Binary encoding of the messages exchanged every tick (see TickMsg.h), as an alternative to
+// the text format of OrderBook::BuildMsgOut & RewardModel::BuildMsgOut
+// Negotiated per connection: client appends kNegotiate to the password; a server that supports it
+// replies in binary only, and a client that receives a text message ("/*\n") falls back to text
+// kNegotiateDelta likewise requests delta state messages (text or binary; see StateDelta in TickMsg.h)
+// kNegotiateFrame requests text messages to be framed as well (kMagicText) instead of delimited by "*/\n" or "\n"
+// kNegotiateSub makes the client a read-only subscriber (see NetServer)
+// kNegotiateShm comes with the descriptors of shared memory rings to continue through (see ShmLink.h)
+// kNegotiateDay requests the day message on the first day as well, if the server knows the day (see Trader::Resume)
+// kNegotiateEnd ends the list (it may arrive in more than one segment); without it, only the password is taken
+//
+// Frame:   magic (4 bytes) | payload size (uint32) | payload
+//          fixed size values in host byte order (both ends are assumed to share it)
+//          integers are zigzag varints (v); prices in tbr & ord are differences from the previous entry (dv)
+// State:   time, bal, sum.buy, sell, feetax (v) | sum.tck_orig[] (v x 3 each) |
+//          kospi200 (float) | # of items (v) | items
+//   item:  code (char[8], 0-padded) | type (uint8) | pr (float) | qr (v) | tbrMask (v) |
+//          tbr[] (dv p, v q; only levels set in tbrMask) |
+//          [ELW] iCP, expiry (v) thr[] (float) | [ETF] devNAV (float) |
+//          cnt (v) | # of orders (v) | ord[] (dv p, v q)
+// Reqs:    # of reqs (v) | reqs
+//   req:   type (uint8) | code (char[8], 0-padded) | p, q, mp (v)
+// Day:     name (rest of payload; see NetServer::SendNewDay)
+// Text:    text message as is (rest of payload)
+class BinMsg
+{
+public:
+    struct Header {
+        uint32_t magic;
+        uint32_t size; // of payload
+    };
+    constexpr static uint32_t kMagicState = 0x54534253; // "SBST"
+    constexpr static uint32_t kMagicReqs  = 0x51525253; // "SBRQ"
+    constexpr static uint32_t kMagicDay   = 0x59444253; // "SBDY"
+    constexpr static uint32_t kMagicText  = 0x58544253; // "SBTX"
+    constexpr static const char *kNegotiate      = "\nbin\n";
+    constexpr static const char *kNegotiateDelta = "\ndelta\n";
+    constexpr static const char *kNegotiateFrame = "\nframe\n";
+    constexpr static const char *kNegotiateSub   = "\nsub\n";
+    constexpr static const char *kNegotiateShm   = "\nshm\n";
+    constexpr static const char *kNegotiateDay   = "\nday\n";
+    constexpr static const char *kNegotiateEnd   = "\nend\n";
+    constexpr static std::size_t szCode = 8;
+
+    // Encoders replace buf with a whole frame (header included)
+    static void EncodeState(const StateMsg &state, std::vector<char> &buf);
+    static void EncodeReqs (const std::vector<ReqMsg> &reqs, std::vector<char> &buf);
+    static void EncodeDay  (CSTR &name, std::vector<char> &buf);
+    static void EncodeText (CSTR &msg , std::vector<char> &buf);
+
+    // Decoders take the payload only; return non-0 for invalid payload
+    // Existing elements of state.items & reqs are overwritten in place (allocations reused)
+    static int DecodeState(const char *payload, std::size_t size, StateMsg &state);
+    static int DecodeReqs (const char *payload, std::size_t size, std::vector<ReqMsg> &reqs);
+    static int DecodeDay  (const char *payload, std::size_t size, STR &name);
+
+    static bool IsMagic(uint32_t magic) { return magic == kMagicState || magic == kMagicReqs || magic == kMagicDay || magic == kMagicText; }
+};
+
+}
+
+#endif /* SIBYL_BINMSG_H_ */
@@ -18,17 +18,31 @@
 #define SIBYL_CATALOG_H_
 
 #include <memory>
-#include <map>
 #include <atomic>
 #include <vector>
 #include <algorithm>
 
 #include "Security.h"
+#include "ItemTable.h"
 #include "time_common.h"
 
 namespace sibyl
 {
 
+// Accumulated statistics of a Catalog (same type for all TItem)
+struct SumStat {
+    INT64 buy, sell, feetax;
+
+    // For each tick at which an order was placed
+    struct tck_orig_sum {
+        INT64 bal, q, evt;
+    };
+
+    // Index convention is the same as usual for [0, idx::szTb)
+    // Use Catalog::idxTckOrigS0 & idxTckOrigB0 for s0 & b0 
+    std::array<tck_orig_sum, idx::szTb + 2> tck_orig;
+};
+
 // Container for dynamically allocated securities with other relevant info
 // Base class for Portfolio and OrderBook
 template <class TItem> // default: Item
@@ -39,23 +53,13 @@ public:
     INT64           bal;  // balance excluding amount staged as buy orders
 
     // Accumulated statistics
-    struct {
-        INT64 buy, sell, feetax;
-
-        // For each tick at which an order was placed
-        struct tck_orig_sum {
-            INT64 bal, q, evt;
-        };
+    SumStat sum;
 
-        // Index convention is the same as usual for [0, idx::szTb)
-        // Use idxTckOrigS0 & idxTckOrigB0 for s0 & b0 
-        std::array<tck_orig_sum, idx::szTb + 2> tck_orig;
-    } sum;
-
-    // Pointers to items; indexed by code
-    std::map<STR, std::unique_ptr<TItem>> items;
+    // Pointers to items; indexed by code, and by ItemId in the order of codes
+    ItemTable<TItem> items;
 
     void   UpdateRefInitBal();
+    void   ResetDay        (); // all but items back to the initial state (for another day)
     double GetProfitRate   (bool isRef = false); // based on balInit by default
     
     // Evaluation of the whole catalog
@@ -69,18 +73,17 @@ public:
     SEval Evaluate() const;
 
     // returns (at most) n items sorted by count * price
-    std::vector<typename std::map<STR, std::unique_ptr<TItem>>::const_iterator> GetTopCnts(std::size_t n);
+    std::vector<typename ItemTable<TItem>::const_iterator> GetTopCnts(std::size_t n);
     
     Catalog() : time(kTimeBounds::null), bal(0), sum{0, 0, 0, {}},
                 balRef(0), balInit(0), isFirstTick(true) {}
 protected:
     INT64 balRef;  // evaluation with 'reference price' (= ending price from the previous day)
     INT64 balInit; // evaluation with 'starting price'  (= price right after marken opens)
+    bool  isFirstTick;
     
     constexpr static const int idxTckOrigS0 = idx::szTb + 0;  // not to be used on tbr
     constexpr static const int idxTckOrigB0 = idx::szTb + 1;  // not to be used on tbr
-private:
-    bool isFirstTick;
 };
 
 template <class TItem>
@@ -104,6 +107,17 @@ void Catalog<TItem>::UpdateRefInitBal()
     }
 }
 
+template <class TItem>
+void Catalog<TItem>::ResetDay()
+{
+    time        = kTimeBounds::null;
+    bal         = 0;
+    sum         = SumStat{0, 0, 0, {}};
+    balRef      = 0;
+    balInit     = 0;
+    isFirstTick = true;
+}
+
 template <class TItem>
 double Catalog<TItem>::GetProfitRate(bool isRef)
 {
@@ -142,11 +156,11 @@ typename Catalog<TItem>::SEval Catalog<TItem>::Evaluate() const {
 }
 
 template <class TItem>
-std::vector<typename std::map<STR, std::unique_ptr<TItem>>::const_iterator> Catalog<TItem>::GetTopCnts(std::size_t n)
+std::vector<typename ItemTable<TItem>::const_iterator> Catalog<TItem>::GetTopCnts(std::size_t n)
 {
     verify(n >= 0);
 
-    using it_t = typename std::map<STR, std::unique_ptr<TItem>>::const_iterator; 
+    using it_t = typename ItemTable<TItem>::const_iterator; 
     std::vector<it_t> vec;
     for (auto it = std::begin(items), end = std::end(items); it != end; ++it)
         if (it->second->cnt > 0) vec.push_back(it);
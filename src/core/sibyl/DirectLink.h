@@ -0,0 +1,109 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_DIRECTLINK_H_
+#define SIBYL_DIRECTLINK_H_
+
+#include "server/Broker.h"
+#include "client/Trader.h"
+
+namespace sibyl
+{
+
+// Connects a Broker and a Trader in the same process in place of NetServer & NetClient
+// (e.g., for backtesting); state and reqs are passed as StateMsg & ReqMsg by function calls
+// Broker is driven in the same order as in NetServer::Launch, and Broker::latency & Trader::latency are fed likewise
+// (no send, wait or recvTick phases); printing them is left to the caller
+template <class TOrder, class TItem>
+class DirectLink
+{
+public:
+    void SetVerbose(bool verbose_) { verbose = verbose_; pBroker->SetVerbose(verbose); }
+
+    // Advance Broker to the next tick that is not skipped and call Trader::ApplyState
+    // At the end of a day, roll Broker over to the next day if any and call Trader::NewDay
+    // Returns 0 for success, +1 for a day boundary (no SendResponse expected),
+    // -1 if either side signals exit (Broker::OnExit is called then)
+    int RecvNextTick();
+
+    // Call Trader::BuildReqs and apply the reqs to Broker
+    void SendResponse();
+
+    DirectLink(Broker<TOrder, TItem> *pBroker_, Trader *pTrader_) // names the first day (if known) to Trader
+        : pBroker(pBroker_), pTrader(pTrader_), verbose(false), exited(false) {
+        STR name = pBroker->Day();
+        if (name.empty() == false) pTrader->NewDay(name);
+    }
+private:
+    Broker<TOrder, TItem> *pBroker;
+    Trader *pTrader;
+    bool verbose;
+    bool exited;
+
+    int Exit();
+};
+
+template <class TOrder, class TItem>
+int DirectLink<TOrder, TItem>::RecvNextTick()
+{
+    if (exited == true) return -1;
+
+    pTrader->latency.EndCycle(false);
+    do {
+        auto t0 = TickLatency::clock::now();
+        int ret = pBroker->AdvanceTick();
+        pBroker->latency.EndCycle(pBroker->IsSkipping());
+        pBroker->latency.Add(TickPhase::advance, TickLatency::clock::now() - t0);
+        if (0 != ret)
+        {
+            STR name;
+            if (0 != pBroker->NextDay(name)) return Exit();
+            if (verbose == true) std::cout << dispPrefix << "DirectLink: New day " << name << std::endl;
+            pTrader->NewDay(name);
+            return 1;
+        }
+    } while (true == pBroker->IsSkipping());
+
+    const StateMsg *pState;
+    {
+        TickLatency::Scope scope(pBroker->latency, TickPhase::buildMsg);
+        pState = &pBroker->BuildState();
+    }
+    if (0 != pTrader->ApplyState(*pState)) return Exit();
+    return 0;
+}
+
+template <class TOrder, class TItem>
+void DirectLink<TOrder, TItem>::SendResponse()
+{
+    verify(exited == false);
+    pBroker->ApplyReqs(pTrader->BuildReqs());
+}
+
+template <class TOrder, class TItem>
+int DirectLink<TOrder, TItem>::Exit()
+{
+    if (verbose == true) std::cout << dispPrefix << "DirectLink: Exiting main loop" << std::endl;
+    pBroker->OnExit();
+    pBroker->latency.EndCycle(false);
+    pTrader->latency.EndCycle(false);
+    exited = true;
+    return -1;
+}
+
+}
+
+#endif /* SIBYL_DIRECTLINK_H_ */
@@ -0,0 +1,183 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_ITEMTABLE_H_
+#define SIBYL_ITEMTABLE_H_
+
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+#include "sibyl_common.h"
+
+namespace sibyl
+{
+
+// Dense index of an item in an ItemTable (its position in the order of codes)
+// Not stable: ids at and after an inserted code move by one; valid until the next insertion or erasure
+// (see ItemTable::Generation)
+typedef uint32_t ItemId;
+constexpr ItemId kNoItem = (ItemId)-1;
+
+// Items indexed by code, with entries (code, pointer) held contiguously in the order of codes and a hash from codes to ids
+// Keeps the part of std::map<STR, std::unique_ptr<TItem>> in use (entries have first & second),
+// so that iteration in id order, find & insert read the same as for a map
+// NOTE: items themselves are still separate heap objects (polymorphic KOSPI/ELW/ETF), reached through one
+//       pointer each; only lookup & iteration over entries are dense
+// Iterators are positions (it - begin() is the ItemId); unlike a map's, they are invalidated
+// by insertion and erasure, which only happen while items are loaded (or first seen by a client)
+template <class TItem>
+class ItemTable
+{
+public:
+    struct Entry {
+        STR                    first;  // code
+        std::unique_ptr<TItem> second;
+    };
+    typedef typename std::vector<Entry>::iterator       iterator;
+    typedef typename std::vector<Entry>::const_iterator const_iterator;
+
+    iterator       begin()       { return std::begin(entries); }
+    iterator       end  ()       { return std::end  (entries); }
+    const_iterator begin() const { return std::begin(entries); }
+    const_iterator end  () const { return std::end  (entries); }
+    std::size_t    size () const { return entries.size();    }
+    bool           empty() const { return entries.empty();   }
+
+    // by id
+    ItemId   Id  (const_iterator it) const { return (ItemId)(it - std::begin(entries)); }
+    ItemId   Id  (CSTR &code)        const { return Id(code.data(), code.size()); }
+    ItemId   Id  (const char *code, std::size_t len) const; // kNoItem if not found; code need not be null-terminated
+    CSTR&    Code(ItemId id)         const { return entries[id].first;   }
+    TItem&   At  (ItemId id)         const { return *entries[id].second; }
+    uint64_t Generation()            const { return gen; } // changes with every insertion or erasure
+
+    // as std::map
+    iterator       find(CSTR &code)       { ItemId id = Id(code); return (id == kNoItem ? end() : begin() + id); }
+    const_iterator find(CSTR &code) const { ItemId id = Id(code); return (id == kNoItem ? end() : begin() + id); }
+    std::pair<iterator, bool> insert(std::pair<STR, std::unique_ptr<TItem>> &&code_pItem); // pointer left as is if code exists
+    std::unique_ptr<TItem>& operator[](CSTR &code); // an empty pointer is inserted if not found
+    iterator erase(iterator it);
+    void     clear();
+
+    ItemTable() : gen(0) { Rehash(); }
+private:
+    std::vector<Entry> entries; // sorted by code
+    uint64_t gen;
+
+    // open addressing (linear probing, at most half full); holds the first 8 characters of each code
+    // so that codes of up to 8 characters (6 for KRX) are matched without touching entries
+    struct Slot {
+        uint64_t key; // first 8 characters, zero padded
+        uint32_t len;
+        ItemId   id;  // kNoItem if empty
+    };
+    std::vector<Slot> slots; // size is a power of 2
+
+    static uint64_t Key(const char *code, std::size_t len) {
+        uint64_t key = 0;
+        memcpy(&key, code, std::min(len, sizeof(key)));
+        return key;
+    }
+    std::size_t Home(uint64_t key, std::size_t len) const {
+        return (std::size_t)(((key ^ len) * 0x9E3779B97F4A7C15ull) >> 32) & (slots.size() - 1);
+    }
+    void Place(ItemId id); // entries[id] into slots
+    void Rehash();
+};
+
+template <class TItem>
+ItemId ItemTable<TItem>::Id(const char *code, std::size_t len) const
+{
+    uint64_t key = Key(code, len);
+    for (std::size_t h = Home(key, len); slots[h].id != kNoItem; h = (h + 1) & (slots.size() - 1))
+    {
+        const auto &s = slots[h];
+        if (s.key == key && s.len == len &&
+            (len <= sizeof(key) || 0 == memcmp(entries[s.id].first.data() + sizeof(key), code + sizeof(key), len - sizeof(key))))
+            return s.id;
+    }
+    return kNoItem;
+}
+
+template <class TItem>
+std::pair<typename ItemTable<TItem>::iterator, bool> ItemTable<TItem>::insert(std::pair<STR, std::unique_ptr<TItem>> &&code_pItem)
+{
+    ItemId id = Id(code_pItem.first);
+    if (id != kNoItem) return std::make_pair(begin() + id, false);
+
+    auto it = std::lower_bound(begin(), end(), code_pItem.first, [](const Entry &e, CSTR &code) { return e.first < code; });
+    id = Id(it);
+    if (it != end()) // ids at and after it move by one (codes are mostly inserted in order, skipping this)
+        for (auto &s : slots) if (s.id != kNoItem && s.id >= id) s.id++;
+    it = entries.insert(it, Entry{std::move(code_pItem.first), std::move(code_pItem.second)});
+    if (2 * entries.size() > slots.size()) Rehash();
+    else                                   Place(id);
+    gen++;
+    return std::make_pair(it, true);
+}
+
+template <class TItem>
+std::unique_ptr<TItem>& ItemTable<TItem>::operator[](CSTR &code)
+{
+    auto it = find(code);
+    if (it == end()) it = insert(std::make_pair(code, std::unique_ptr<TItem>())).first;
+    return it->second;
+}
+
+template <class TItem>
+typename ItemTable<TItem>::iterator ItemTable<TItem>::erase(iterator it)
+{
+    ItemId id = Id(it);
+    entries.erase(it);
+    Rehash();
+    gen++;
+    return begin() + id;
+}
+
+template <class TItem>
+void ItemTable<TItem>::clear()
+{
+    entries.clear();
+    Rehash();
+    gen++;
+}
+
+template <class TItem>
+void ItemTable<TItem>::Place(ItemId id)
+{
+    CSTR &code = entries[id].first;
+    uint64_t key = Key(code.data(), code.size());
+    std::size_t h = Home(key, code.size());
+    while (slots[h].id != kNoItem) h = (h + 1) & (slots.size() - 1);
+    slots[h] = Slot{key, (uint32_t)code.size(), id};
+}
+
+template <class TItem>
+void ItemTable<TItem>::Rehash()
+{
+    std::size_t size = 16;
+    while (size < 2 * entries.size()) size *= 2;
+    slots.assign(size, Slot{0, 0, kNoItem});
+    for (std::size_t id = 0; id < entries.size(); id++) Place((ItemId)id);
+}
+
+}
+
+#endif /* SIBYL_ITEMTABLE_H_ */
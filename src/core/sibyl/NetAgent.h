@@ -20,6 +20,7 @@
 #ifndef _WIN32
     #include <netdb.h>
     #include <unistd.h>
+    #include <sys/un.h>
     #define close_socket(expression) close(expression)
 #else
     #include <winsock2.h>
@@ -27,9 +28,14 @@
     #define close_socket(expression) closesocket(expression)
 #endif /* !_WIN32 */
 
-#include <new>
+#include <vector>
+#include <algorithm>
+#include <initializer_list>
+#include <cerrno>
+#include <cstring>
 
 #include "sibyl_common.h"
+#include "ShmLink.h"
 
 namespace sibyl
 {
@@ -40,27 +46,157 @@ class NetAgent
 public:
     void SetVerbose(bool verbose_) { verbose = verbose_; }
     
-    NetAgent() : verbose(false)
-                { bufTCP = new char[kTCPBufSize];
-                  bufMsg = new char[kTCPBufSize]; }
+    NetAgent() : verbose(false), bufMsg(kTCPBufSize), lenMsg(0) {}
     NetAgent           (const NetAgent&) = delete;
     NetAgent& operator=(const NetAgent&) = delete;
     NetAgent           (NetAgent&&) = delete;
     NetAgent& operator=(NetAgent&&) = delete;
-    ~NetAgent() { delete[] bufTCP;
-                  delete[] bufMsg; }
 protected:
     bool verbose;
     
     constexpr static const char *kTCPPassword = "sendorder";
     constexpr static       int   kTCPBacklog  = 8;
-    constexpr static       int   kTCPBufSize  = (1 << 16);
+    constexpr static std::size_t kTCPBufSize  = (1 << 16); // initial size of bufMsg (grows as needed)
     constexpr static       int   sock_fail    = -1;
     
-    char *bufTCP;
-    char *bufMsg;
+    // Addresses of the same host, in place of an IP address or a port (see NetServer::Launch & NetClient::Connect)
+    //   unix:<path>: unix socket at path
+    //   shm:<path> : shared memory rings (see ShmLink.h), linked through a unix socket at path
+    constexpr static const char *kSchemeUnix = "unix:";
+    constexpr static const char *kSchemeShm  = "shm:";
+    
+    // Returns true for a unix: or shm: address, setting path & shm
+    static bool ParseLocal(CSTR &addr, STR &path, bool &shm);
+    
+    // Fill sockaddr_un with path; returns non-0 if path does not fit
+    #ifndef _WIN32
+    static int SetUnixAddr(struct sockaddr_un &addr, CSTR &path);
+    #endif /* !_WIN32 */
+    
+    // Client side transport once connected: shared memory if active, sock otherwise
+    ShmLink shm;
+    long RecvLink(int sock, char *buf, std::size_t len);       // as a blocking recv
+    long SendLink(int sock, const char *buf, std::size_t len); // as a blocking send
+    
+    // Received message (NUL-terminated at lenMsg); reused across messages, parsed in place
+    std::vector<char> bufMsg;
+    std::size_t       lenMsg;
+    
+    // Outgoing frames (see BinMsg.h)
+    std::vector<char> bufBin;
+    
+    // Receive exactly len bytes (waiting through recv timeouts once the first byte has arrived)
+    // Returns 0 for success, +1 for recv timeout before any byte, -1 for error or disconnection
+    int RecvExact(int sock, char *buf, std::size_t len);
+    
+    // Receive the payload of a frame into bufMsg (replaces contents); return value as in RecvExact
+    int RecvPayload(int sock, std::size_t size);
+    
+    // Append a single recv (whatever has arrived) to bufMsg, for unframed text messages
+    // Returns # of bytes received, 0 for recv timeout, -1 for error or disconnection
+    int RecvAppend(int sock);
+    
+    // Append len bytes to bufMsg
+    void AppendMsg(const char *buf, std::size_t len);
+private:
+    void ReserveMsg(std::size_t len) { // room for len more bytes and NUL
+        if (lenMsg + len + 1 > bufMsg.size()) bufMsg.resize(std::max(bufMsg.size() * 2, lenMsg + len + 1));
+    }
 };
 
+inline bool NetAgent::ParseLocal(CSTR &addr, STR &path, bool &shm)
+{
+    for (auto scheme : { kSchemeUnix, kSchemeShm })
+    {
+        if (0 != addr.compare(0, strlen(scheme), scheme)) continue;
+        path = addr.substr(strlen(scheme));
+        shm  = (scheme == kSchemeShm);
+        return true;
+    }
+    return false;
+}
+
+#ifndef _WIN32
+inline int NetAgent::SetUnixAddr(struct sockaddr_un &addr, CSTR &path)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() == true || path.size() >= sizeof(addr.sun_path)) return -1;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return 0;
+}
+#endif /* !_WIN32 */
+
+inline long NetAgent::RecvLink(int sock, char *buf, std::size_t len)
+{
+    if (shm.Active() == true) return shm.Recv(buf, len, true, sock);
+    return (long)recv(sock, buf, len, 0);
+}
+
+inline long NetAgent::SendLink(int sock, const char *buf, std::size_t len)
+{
+    if (shm.Active() == true) return shm.Send(buf, len, true, sock);
+    return (long)send(sock, buf, len, 0);
+}
+
+inline int NetAgent::RecvExact(int sock, char *buf, std::size_t len)
+{
+    std::size_t lenRecv = 0;
+    while (lenRecv < len)
+    {
+        auto ret = RecvLink(sock, buf + lenRecv, len - lenRecv);
+        if (ret > 0)
+        {
+            lenRecv += (std::size_t)ret;
+            continue;
+        }
+        #ifndef _WIN32
+        bool timeout = (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+        #else
+        bool timeout = (ret < 0 && WSAGetLastError() == WSAETIMEDOUT);
+        #endif
+        if (timeout == false) return -1;
+        if (lenRecv == 0)     return  1;
+    }
+    return 0;
+}
+
+inline int NetAgent::RecvPayload(int sock, std::size_t size)
+{
+    lenMsg = 0;
+    ReserveMsg(size);
+    int ret = RecvExact(sock, bufMsg.data(), size);
+    lenMsg = (ret == 0 ? size : 0);
+    bufMsg[lenMsg] = '\0';
+    return ret;
+}
+
+inline int NetAgent::RecvAppend(int sock)
+{
+    ReserveMsg(kTCPBufSize / 4);
+    auto ret = RecvLink(sock, bufMsg.data() + lenMsg, bufMsg.size() - lenMsg - 1);
+    if (ret > 0)
+    {
+        lenMsg += (std::size_t)ret;
+        bufMsg[lenMsg] = '\0';
+        return (int)ret;
+    }
+    #ifndef _WIN32
+    bool timeout = (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    #else
+    bool timeout = (ret < 0 && WSAGetLastError() == WSAETIMEDOUT);
+    #endif
+    return (timeout == true ? 0 : -1);
+}
+
+inline void NetAgent::AppendMsg(const char *buf, std::size_t len)
+{
+    ReserveMsg(len);
+    memcpy(bufMsg.data() + lenMsg, buf, len);
+    lenMsg += len;
+    bufMsg[lenMsg] = '\0';
+}
+
 }
 
 #endif /* SIBYL_NETAGENT_H_ */
\ No newline at end of file
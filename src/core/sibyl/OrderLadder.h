@@ -0,0 +1,242 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_ORDERLADDER_H_
+#define SIBYL_ORDERLADDER_H_
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <new>
+
+#include "sibyl_common.h"
+
+namespace sibyl
+{
+
+// Drop-in replacement for std::multimap<INT, TOrder> holding orders of a single item
+// Price levels are kept in a small sorted vector (only a few ticks around ps0/pb0 are in use),
+// each pointing to a FIFO run of nodes stored contiguously and linked in (price, insertion) order
+// Iteration order, equal_range and iterator/reference stability are the same as std::multimap
+template <class TOrder>
+class OrderLadder
+{
+    typedef uint32_t node_t;
+    constexpr static node_t nil = UINT32_MAX;
+public:
+    typedef INT                          key_type;
+    typedef TOrder                       mapped_type;
+    typedef std::pair<const INT, TOrder> value_type;
+    typedef std::size_t                  size_type;
+
+    template <bool isConst>
+    class Iter
+    {
+        typedef typename std::conditional<isConst, const OrderLadder*, OrderLadder*>::type ladder_ptr;
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef OrderLadder::value_type         value_type;
+        typedef std::ptrdiff_t                  difference_type;
+        typedef typename std::conditional<isConst, const value_type&, value_type&>::type reference;
+        typedef typename std::conditional<isConst, const value_type*, value_type*>::type pointer;
+
+        reference operator* () const { return pL->Val(i); }
+        pointer   operator->() const { return &pL->Val(i); }
+        Iter& operator++()    { i = pL->nodes[i].next; return *this; }
+        Iter& operator--()    { i = (i == nil ? pL->tail : pL->nodes[i].prev); return *this; }
+        Iter  operator++(int) { Iter t(*this); ++*this; return t; }
+        Iter  operator--(int) { Iter t(*this); --*this; return t; }
+        bool operator==(const Iter &it) const { return i == it.i && pL == it.pL; }
+        bool operator!=(const Iter &it) const { return !(*this == it); }
+
+        Iter() : pL(nullptr), i(nil) {}
+        template <bool isConst_, class = typename std::enable_if<isConst && !isConst_>::type>
+        Iter(const Iter<isConst_> &it) : pL(it.pL), i(it.i) {}
+    private:
+        friend class OrderLadder;
+        template <bool> friend class Iter;
+        Iter(ladder_ptr pL_, node_t i_) : pL(pL_), i(i_) {}
+        ladder_ptr pL;
+        node_t     i;
+    };
+    typedef Iter<false>                           iterator;
+    typedef Iter<true >                           const_iterator;
+    typedef std::reverse_iterator<iterator>       reverse_iterator;
+    typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+    iterator               begin ()       { return iterator      (this, head); }
+    iterator               end   ()       { return iterator      (this, nil ); }
+    const_iterator         begin () const { return const_iterator(this, head); }
+    const_iterator         end   () const { return const_iterator(this, nil ); }
+    reverse_iterator       rbegin()       { return reverse_iterator      (end  ()); }
+    reverse_iterator       rend  ()       { return reverse_iterator      (begin()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end  ()); }
+    const_reverse_iterator rend  () const { return const_reverse_iterator(begin()); }
+
+    size_type size () const { return n; }
+    bool      empty() const { return n == 0; }
+
+    // Orders of the same price are in insertion order (new orders go last)
+    iterator insert(const value_type &v);
+    iterator erase (const_iterator it); // returns iterator to the next order
+    void     clear ();
+    void     swap  (OrderLadder &ol);
+
+    std::pair<iterator      , iterator      > equal_range(INT p);
+    std::pair<const_iterator, const_iterator> equal_range(INT p) const;
+
+    OrderLadder() : head(nil), tail(nil), n(0) {}
+    OrderLadder(const OrderLadder &ol) : OrderLadder() { for (const auto &v : ol) insert(v); }
+    OrderLadder& operator=(OrderLadder ol) { swap(ol); return *this; }
+    ~OrderLadder() { clear(); }
+private:
+    struct Node {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type val;
+        node_t prev, next;
+    };
+    struct Level {
+        INT p;
+        node_t first, last;
+    };
+
+    std::deque<Node>    nodes; // deque keeps references valid on growth
+    std::vector<node_t> freed;
+    std::vector<Level>  levels; // sorted by p
+    node_t    head, tail;
+    size_type n;
+
+          value_type& Val(node_t i)       { return *reinterpret_cast<      value_type*>(&nodes[i].val); }
+    const value_type& Val(node_t i) const { return *reinterpret_cast<const value_type*>(&nodes[i].val); }
+
+    typename std::vector<Level>::const_iterator FindLevel(INT p) const {
+        return std::lower_bound(std::begin(levels), std::end(levels), p, [](const Level &l, INT p_) { return l.p < p_; });
+    }
+    std::pair<node_t, node_t> Range(INT p) const; // [first, next of last)
+};
+
+template <class TOrder>
+typename OrderLadder<TOrder>::iterator OrderLadder<TOrder>::insert(const value_type &v)
+{
+    node_t i;
+    if (freed.empty() == false)
+    {
+        i = freed.back();
+        freed.pop_back();
+    }
+    else
+    {
+        i = (node_t)nodes.size();
+        nodes.emplace_back();
+    }
+    new (&nodes[i].val) value_type(v);
+
+    auto iL = std::begin(levels) + (FindLevel(v.first) - std::begin(levels));
+    node_t next;
+    if (iL != std::end(levels) && iL->p == v.first)
+    {
+        next = nodes[iL->last].next;
+        iL->last = i;
+    }
+    else
+    {
+        next = (iL != std::end(levels) ? iL->first : nil);
+        Level l;
+        l.p     = v.first;
+        l.first = i;
+        l.last  = i;
+        levels.insert(iL, l);
+    }
+
+    node_t prev = (next != nil ? nodes[next].prev : tail);
+    nodes[i].prev = prev;
+    nodes[i].next = next;
+    (prev != nil ? nodes[prev].next : head) = i;
+    (next != nil ? nodes[next].prev : tail) = i;
+    n++;
+    return iterator(this, i);
+}
+
+template <class TOrder>
+typename OrderLadder<TOrder>::iterator OrderLadder<TOrder>::erase(const_iterator it)
+{
+    node_t i    = it.i;
+    node_t prev = nodes[i].prev;
+    node_t next = nodes[i].next;
+
+    auto iL = std::begin(levels) + (FindLevel(Val(i).first) - std::begin(levels));
+    if (iL->first == i && iL->last == i) levels.erase(iL);
+    else if (iL->first == i) iL->first = next;
+    else if (iL->last  == i) iL->last  = prev;
+
+    (prev != nil ? nodes[prev].next : head) = next;
+    (next != nil ? nodes[next].prev : tail) = prev;
+    Val(i).~value_type();
+    freed.push_back(i);
+    n--;
+    return iterator(this, next);
+}
+
+template <class TOrder>
+void OrderLadder<TOrder>::clear()
+{
+    for (node_t i = head; i != nil; i = nodes[i].next) Val(i).~value_type();
+    nodes .clear();
+    freed .clear();
+    levels.clear();
+    head = tail = nil;
+    n = 0;
+}
+
+template <class TOrder>
+void OrderLadder<TOrder>::swap(OrderLadder &ol)
+{
+    nodes .swap(ol.nodes );
+    freed .swap(ol.freed );
+    levels.swap(ol.levels);
+    std::swap(head, ol.head);
+    std::swap(tail, ol.tail);
+    std::swap(n   , ol.n   );
+}
+
+template <class TOrder>
+std::pair<typename OrderLadder<TOrder>::node_t, typename OrderLadder<TOrder>::node_t> OrderLadder<TOrder>::Range(INT p) const
+{
+    auto iL = FindLevel(p);
+    if (iL == std::end(levels)) return std::make_pair(nil, nil);
+    if (iL->p != p)             return std::make_pair(iL->first, iL->first); // empty range at insertion point
+    return std::make_pair(iL->first, nodes[iL->last].next);
+}
+
+template <class TOrder>
+std::pair<typename OrderLadder<TOrder>::iterator, typename OrderLadder<TOrder>::iterator> OrderLadder<TOrder>::equal_range(INT p)
+{
+    auto r = Range(p);
+    return std::make_pair(iterator(this, r.first), iterator(this, r.second));
+}
+
+template <class TOrder>
+std::pair<typename OrderLadder<TOrder>::const_iterator, typename OrderLadder<TOrder>::const_iterator> OrderLadder<TOrder>::equal_range(INT p) const
+{
+    auto r = Range(p);
+    return std::make_pair(const_iterator(this, r.first), const_iterator(this, r.second));
+}
+
+}
+
+#endif /* SIBYL_ORDERLADDER_H_ */
@@ -50,6 +50,7 @@
 //     If there is no order to send, send "\n"
 
 #include <iostream>
+#include <cstring>
 
 namespace sibyl
 {
@@ -84,6 +85,35 @@ inline std::ostream& operator<<(std::ostream &os, ReqType type)
     return os;
 }
 
+// Command word of a req in the syntax above
+inline const char* ReqWord(ReqType type)
+{
+    switch (type)
+    {
+        case ReqType::null : return "";
+        case ReqType::b    : return "b";
+        case ReqType::s    : return "s";
+        case ReqType::cb   : return "cb";
+        case ReqType::cs   : return "cs";
+        case ReqType::mb   : return "mb";
+        case ReqType::ms   : return "ms";
+        case ReqType::ca   : return "ca";
+        case ReqType::sa   : return "sa";
+    }
+    return "";
+}
+
+// ReqType of a command word (pc need not be null-terminated); null if not a command
+inline ReqType ReqTypeOf(const char *pc, std::size_t len)
+{
+    for (long l = (long)ReqType::b; l <= (long)ReqType::sa; l++)
+    {
+        const char *word = ReqWord((ReqType)l);
+        if (len == strlen(word) && 0 == memcmp(pc, word, len)) return (ReqType)l;
+    }
+    return ReqType::null;
+}
+
 }
 
 #endif /* SIBYL_REQTYPE_H_ */
\ No newline at end of file
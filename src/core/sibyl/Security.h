@@ -24,8 +24,10 @@
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <limits>
 
 #include "sibyl_common.h"
+#include "OrderLadder.h"
 
 namespace sibyl
 {
@@ -78,8 +80,62 @@ public:
     PQ(int p_, int q_) : p(p_), q(q_) {}
 };
 
-// Abstract class for holding the current state of a security item
+inline bool operator==(const PQ &a, const PQ &b) { return a.p == b.p && a.q == b.q; }
+inline bool operator!=(const PQ &a, const PQ &b) { return !(a == b); }
+
+// Tick & fee rules of each security type as static functions over constexpr tables
+// Security dispatches on its type tag; code that knows the type at compile time (e.g., RequantizeBy)
+// calls these directly so that the tick arithmetic is inlined
+namespace rules
+{
+    // KOSPI tick size kTck[b] applies to prices in band b, i.e., [kBnd[b], kBnd[b + 1])
+    constexpr int nBand       = 7;
+    constexpr INT kBnd[nBand] = {0, 1000, 5000, 10000, 50000, 100000, 500000};
+    constexpr INT kTck[nBand] = {1,    5,   10,    50,   100,    500,   1000};
+    
+    inline int Band(INT p) { int b = 0; for (int i = 1; i < nBand; i++) b += (p >= kBnd[i]); return b; }
+}
+
+struct KOSPIRules
+{
+    static INT     TckHi (INT p)   { return  p + rules::kTck[rules::Band(p)];                }
+    static INT     TckLo (INT p)   { return (p - rules::kTck[rules::Band(p - 1)]) * (p > 0); }
+    static bool    ValidP(INT p)   { int b = rules::Band(p);
+                                     return (p > 0) && (((p - rules::kBnd[b]) % rules::kTck[b]) == 0); }
+    static INT64   BFee  (INT64 r) { return (INT64)std::round(r * dBF0);                     }
+    static INT64   SFee  (INT64 r) { return (INT64)std::round(r * dSF0) +
+                                            (INT64)std::floor(r * dST0) +
+                                            (INT64)std::floor(r * dST1);                     }
+    static double  dBF   ()        { return dBF0;                                            }
+    static double  dSF   ()        { return dSF0 + dST0 + dST1;                              }
+    
+    constexpr static const double dBF0 = 0.00015;
+    constexpr static const double dSF0 = 0.00015;
+    constexpr static const double dST0 = 0.0015;
+    constexpr static const double dST1 = 0.0015;
+};
+
+struct Tick5Rules // ELW, ETF
+{
+    static INT     TckHi (INT p)   { return p + 5;                       }
+    static INT     TckLo (INT p)   { return (p - 5) * (p > 0);           }
+    static bool    ValidP(INT p)   { return (p > 0) && ((p % 5) == 0);   }
+    static INT64   BFee  (INT64 r) { return (INT64)std::round(r * dBF0); }
+    static INT64   SFee  (INT64 r) { return (INT64)std::round(r * dSF0); }
+    static double  dBF   ()        { return dBF0;                        }
+    static double  dSF   ()        { return dSF0;                        }
+    
+    constexpr static const double dBF0 = 0.00015;
+    constexpr static const double dSF0 = 0.00015;
+};
+
+// Security::Requantize with the tick rules of TRules
+template <class TRules>
+void RequantizeBy(std::array<PQ, idx::szTb> &in, INT trPs1, INT trPb1);
+
+// Base class for holding the current state of a security item
 // Derive with application specific members, then derive again as KOSPI/ELW/etc.
+// Tick & fee rules are dispatched on the type tag set by KOSPI/ELW/etc. (no virtual calls)
 template <class TOrder> // TOrder should be derived from PQ with additional members as needed
 class Security
 {
@@ -88,23 +144,26 @@ public:
     INT64                      qr;  // trade amount            during        this time tick
     std::array<PQ, idx::szTb>  tbr; // bids/asks in the market at the end of this time tick
     INT                        cnt; // # of idle holds that I own, NOT staged as sell orders
-    std::multimap<INT, TOrder> ord; // orders placed by me staged in the market; indexed by price
+    OrderLadder<TOrder>        ord; // orders placed by me staged in the market; indexed by price
     
-    virtual SecType Type  ()        const = 0;
-    virtual INT     TckHi (INT p)   const = 0; // price one tick higher than p 
-    virtual INT     TckLo (INT p)   const = 0; // price one tick lower  than p
-    virtual bool    ValidP(INT p)   const = 0; // check if p conforms to tick rules of a security
-    virtual INT64   BFee  (INT64 r) const = 0; // floored/rounded (fee + tax) for raw buy  price * quant
-    virtual INT64   SFee  (INT64 r) const = 0; // floored/rounded (fee + tax) for raw sell price * quant
-    virtual double  dBF   ()        const = 0; // ratio of buy  (fee + tax)
-    virtual double  dSF   ()        const = 0; // ratio of sell (fee + tax)
+    SecType Type  ()        const { return secType; }
+    INT     TckHi (INT p)   const { return IsKOSPI() ? KOSPIRules::TckHi (p) : Tick5Rules::TckHi (p); } // price one tick higher than p 
+    INT     TckLo (INT p)   const { return IsKOSPI() ? KOSPIRules::TckLo (p) : Tick5Rules::TckLo (p); } // price one tick lower  than p
+    bool    ValidP(INT p)   const { return IsKOSPI() ? KOSPIRules::ValidP(p) : Tick5Rules::ValidP(p); } // check if p conforms to tick rules of a security
+    INT64   BFee  (INT64 r) const { return IsKOSPI() ? KOSPIRules::BFee  (r) : Tick5Rules::BFee  (r); } // floored/rounded (fee + tax) for raw buy  price * quant
+    INT64   SFee  (INT64 r) const { return IsKOSPI() ? KOSPIRules::SFee  (r) : Tick5Rules::SFee  (r); } // floored/rounded (fee + tax) for raw sell price * quant
+    double  dBF   ()        const { return IsKOSPI() ? KOSPIRules::dBF   ( ) : Tick5Rules::dBF   ( ); } // ratio of buy  (fee + tax)
+    double  dSF   ()        const { return IsKOSPI() ? KOSPIRules::dSF   ( ) : Tick5Rules::dSF   ( ); } // ratio of sell (fee + tax)
     
     // NOTE: the following must be used on Requantized tbr
     INT Ps0() const { return TckLo(tbr[idx::ps1].p); }
     INT Pb0() const { return TckHi(tbr[idx::pb1].p); }
     
     // Convert from raw market data to ps#|pb# convention defined above, while filling any price gaps 
-    void Requantize(std::array<PQ, idx::szTb> &in, INT trPs1, INT trPb1);
+    void Requantize(std::array<PQ, idx::szTb> &in, INT trPs1, INT trPb1) {
+        if (IsKOSPI()) RequantizeBy<KOSPIRules>(in, trPs1, trPb1);
+        else           RequantizeBy<Tick5Rules>(in, trPs1, trPb1);
+    }
     void Requantize(INT trPs1, INT trPb1)          { Requantize(tbr, trPs1          , trPb1          ); }
     void Requantize(std::array<PQ, idx::szTb> &in) { Requantize(in , in [idx::ps1].p, in [idx::pb1].p); }
     void Requantize()                              { Requantize(tbr, tbr[idx::ps1].p, tbr[idx::pb1].p); }                                               
@@ -120,24 +179,43 @@ public:
     // Handling potential overflow & special cases (e.g., ELW)
     INT MaxBuyQ(INT64 bal, INT p) const;
     
-    Security() : pr(0.0f), qr(0), cnt(0) {}
+    Security() : pr(0.0f), qr(0), cnt(0), secType(SecType::null) {}
     virtual ~Security() {}
+protected:
+    SecType secType; // set by KOSPI/ELW/etc.
+private:
+    bool IsKOSPI() const { return secType == SecType::KOSPI; }
 };
 
-template <class TOrder>
-void Security<TOrder>::Requantize(std::array<PQ, idx::szTb> &in, INT trPs1, INT trPb1)
+template <class TRules>
+void RequantizeBy(std::array<PQ, idx::szTb> &in, INT trPs1, INT trPb1)
 {
     if ((trPs1 <= 0) && (trPb1 <= 0)) { trPs1 = in[idx::ps1].p; trPb1 = in[idx::pb1].p; }
     if ((trPs1 <= 0) && (trPb1 <= 0))                     return;
     if ((trPs1 >  0) && (trPb1 >  0) && (trPs1 <= trPb1)) return; // triggered by unknown invalid situation in table values; only happens when trPs1 & trPb1 are pulled from tbp (t < 0) and is safe to ignore
     std::array<PQ, idx::szTb> out;   
-    out[idx::ps1].p = (trPb1 > 0 ? TckHi(trPb1) : trPs1);
-    out[idx::pb1].p = (trPs1 > 0 ? TckLo(trPs1) : trPb1);
-    for (auto iO = std::begin(out) + idx::ps1; iO > std::begin(out)  ; iO--) (iO - 1)->p = TckHi(iO->p);
-    for (auto iO = std::begin(out) + idx::pb1; iO < std::end(out) - 1; iO++) (iO + 1)->p = TckLo(iO->p);
-    for (auto &o : out) {
-        auto iI = std::find_if(std::begin(in), std::end(in), [&o](const PQ &i) { return i.p == o.p; });
-        o.q = (iI != std::end(in) ? iI->q : 0);        
+    out[idx::ps1].p = (trPb1 > 0 ? TRules::TckHi(trPb1) : trPs1);
+    out[idx::pb1].p = (trPs1 > 0 ? TRules::TckLo(trPs1) : trPb1);
+    for (auto iO = std::begin(out) + idx::ps1; iO > std::begin(out)  ; iO--) (iO - 1)->p = TRules::TckHi(iO->p);
+    for (auto iO = std::begin(out) + idx::pb1; iO < std::end(out) - 1; iO++) (iO + 1)->p = TRules::TckLo(iO->p);
+    // Quant of the first level of in at each price of out; out is descending within each half (the halves
+    // may overlap across a gap), so if in is also descending (as from the market) each half is one merge
+    auto descending = [](const PQ &a, const PQ &b) { return a.p > b.p; };
+    if (std::is_sorted(std::begin(in), std::end(in), descending)) {
+        auto merge = [&in](std::array<PQ, idx::szTb>::iterator first, std::array<PQ, idx::szTb>::iterator last) {
+            auto iI = std::begin(in);
+            for (auto iO = first; iO != last; iO++) {
+                while ((iI != std::end(in)) && (iI->p > iO->p)) iI++;
+                iO->q = ((iI != std::end(in)) && (iI->p == iO->p) ? iI->q : 0);
+            }
+        };
+        merge(std::begin(out)           , std::begin(out) + idx::pb1);
+        merge(std::begin(out) + idx::pb1, std::end  (out)           );
+    } else {
+        for (auto &o : out) {
+            auto iI = std::find_if(std::begin(in), std::end(in), [&o](const PQ &i) { return i.p == o.p; });
+            o.q = (iI != std::end(in) ? iI->q : 0);        
+        }
     }
     in = out;
 }
@@ -145,24 +223,18 @@ void Security<TOrder>::Requantize(std::array<PQ, idx::szTb> &in, INT trPs1, INT
 template <class TOrder>
 int Security<TOrder>::P2Tck(INT p, OrdType type) const
 {
+    // Branch-free scans of a fixed length (unrolled/vectorized by the compiler); the match written last
+    // is the one a linear search from ps10 (sell) or pb1 (buy) would find first
     int tck = (int)idx::tckN;
     if (type == OrdType::sell) {
-        if (p == Ps0()) tck = -1;
-        else { // find_if [first, last)
-            auto first = std::begin(tbr);
-            auto last  = std::begin(tbr) + idx::ps1 + 1;
-            auto iT    = std::find_if(first, last, [&p](const PQ &tb) { return tb.p == p; });
-            if (iT != last) tck = (int)idx::ps1 - (int)(iT - first);
-        }
+        if (p == Ps0()) return -1;
+        for (int t = 0; t < (int)idx::tckN; t++)
+            tck = (tbr[(std::size_t)(idx::ps1 - t)].p == p ? t : tck);
     } else
     if (type == OrdType::buy ) {
-        if (p == Pb0()) tck = -1;
-        else { // find_if [first, last)
-            auto first = std::begin(tbr) + idx::pb1;
-            auto last  = std::end(tbr);
-            auto iT    = std::find_if(first, last, [&p](const PQ &tb) { return tb.p == p; });
-            if (iT != last) tck = (int)(iT - first);
-        }
+        if (p == Pb0()) return -1;
+        for (int t = (int)idx::tckN - 1; t >= 0; t--)
+            tck = (tbr[(std::size_t)(idx::pb1 + t)].p == p ? t : tck);
     }
     return tck;
 }
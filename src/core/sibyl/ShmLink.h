@@ -0,0 +1,330 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SHMLINK_H_
+#define SIBYL_SHMLINK_H_
+
+#ifdef __linux__
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/eventfd.h>
+    #include <sys/socket.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif /* __linux__ */
+
+#include <atomic>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+namespace sibyl
+{
+
+// Byte stream between NetServer and NetClient on the same host (address scheme "shm:"; see NetAgent::ParseLocal)
+// through a pair of single-producer single-consumer rings in shared memory, in place of the socket
+// The client creates the shared memory and an eventfd for each end, and passes them to the server with the password
+// over a unix socket (SCM_RIGHTS); the socket stays open only to signal disconnection
+// A reader of an empty ring (or a writer of a full ring) raises a flag in the ring before it waits on its eventfd,
+// and the other end writes to that eventfd after moving data if the flag is up
+// (eventfd rather than futex, so that NetServer waits on it through Poller along with sockets)
+// Linux only; Active() is always false elsewhere
+class ShmLink
+{
+public:
+    constexpr static std::size_t kRingSize = (1 << 22); // bytes per direction (power of 2)
+    constexpr static int         nFds      = 3;         // shared memory, eventfd of client, eventfd of server
+
+    bool Active() const { return rings != nullptr; }
+    int  Bell  () const { return bell; }                // eventfd of this end; readable when woken
+
+    int  Create(int (&fds)[nFds]);       // client: create & map; fds are to be sent to server (owned by this)
+    int  Attach(const int (&fds)[nFds]); // server: map fds received (takes ownership)
+    void Close ();
+
+    // Same results as recv & send: # of bytes moved, or -1 with errno EAGAIN if nothing can be moved without blocking
+    // block: wait on Bell until something can be moved; returns 0 (Recv) or -1 (Send) when sock is disconnected
+    long Recv(char *buf, std::size_t len, bool block, int sock);
+    long Send(const char *buf, std::size_t len, bool block, int sock);
+    void Drain(); // clear Bell after being woken (before Recv or Send)
+
+    // Send & receive a message along with nFds descriptors over a unix socket
+    // RecvFds sets nRecv to 0 if the message came without exactly nFds descriptors (any received are closed)
+    static long SendFds(int sock, const char *buf, std::size_t len, const int (&fds)[nFds]);
+    static long RecvFds(int sock, char *buf, std::size_t len, int (&fds)[nFds], int &nRecv);
+
+    ShmLink() : rings(nullptr), in(nullptr), out(nullptr), bell(-1), peer(-1) { std::fill(std::begin(fds), std::end(fds), -1); }
+    ~ShmLink() { Close(); }
+    ShmLink           (const ShmLink&) = delete;
+    ShmLink& operator=(const ShmLink&) = delete;
+private:
+    struct Ring {
+        alignas(64) std::atomic<uint64_t> head; // bytes written so far
+        alignas(64) std::atomic<uint64_t> tail; // bytes read so far
+        alignas(64) std::atomic<uint32_t> readerWaiting;
+                    std::atomic<uint32_t> writerWaiting;
+        alignas(64) char data[kRingSize];
+    };
+    Ring *rings;    // [0] client to server, [1] server to client
+    Ring *in, *out;
+    int   bell, peer;
+    int   fds[nFds];
+
+    int  Map (bool server);
+    void Notify(int fd) const;
+    int  Wait(int sock); // returns -1 if sock is disconnected
+    static long Corrupt() { errno = EPROTO; return -1; } // positions in a ring written by the other end are out of range
+};
+
+#ifdef __linux__
+
+inline int ShmLink::Create(int (&fds_)[nFds])
+{
+    Close();
+    fds[0] = memfd_create("sibyl", MFD_CLOEXEC);
+    fds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    fds[2] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fds[0] < 0 || fds[1] < 0 || fds[2] < 0 || 0 != ftruncate(fds[0], sizeof(Ring) * 2) || 0 != Map(false))
+    {
+        Close();
+        return -1;
+    }
+    std::copy(std::begin(fds), std::end(fds), std::begin(fds_));
+    return 0;
+}
+
+inline int ShmLink::Attach(const int (&fds_)[nFds])
+{
+    Close();
+    std::copy(std::begin(fds_), std::end(fds_), std::begin(fds));
+    struct stat st;
+    if (0 != fstat(fds[0], &st) || st.st_size != (off_t)(sizeof(Ring) * 2) || 0 != Map(true))
+    {
+        Close();
+        return -1;
+    }
+    in->readerWaiting.store(1); // always woken through Poller
+    return 0;
+}
+
+inline int ShmLink::Map(bool server)
+{
+    void *p = mmap(nullptr, sizeof(Ring) * 2, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    if (p == MAP_FAILED) return -1;
+    rings = static_cast<Ring*>(p);
+    in    = &rings[server == true ? 0 : 1];
+    out   = &rings[server == true ? 1 : 0];
+    bell  = fds[server == true ? 2 : 1];
+    peer  = fds[server == true ? 1 : 2];
+    return 0;
+}
+
+inline void ShmLink::Close()
+{
+    if (rings != nullptr) munmap(rings, sizeof(Ring) * 2);
+    rings = in = out = nullptr;
+    for (auto &fd : fds)
+    {
+        if (fd >= 0) close(fd);
+        fd = -1;
+    }
+    bell = peer = -1;
+}
+
+inline long ShmLink::Recv(char *buf, std::size_t len, bool block, int sock)
+{
+    while (true)
+    {
+        uint64_t tail = in->tail.load(std::memory_order_relaxed);
+        uint64_t head = in->head.load(std::memory_order_acquire);
+        if (head - tail > kRingSize) return Corrupt();
+        if (head != tail)
+        {
+            std::size_t n   = (std::size_t)std::min<uint64_t>(len, head - tail);
+            std::size_t pos = (std::size_t)(tail & (kRingSize - 1));
+            std::size_t n0  = std::min(n, kRingSize - pos);
+            memcpy(buf, in->data + pos, n0);
+            memcpy(buf + n0, in->data, n - n0);
+            in->tail.store(tail + n, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (in->writerWaiting.load(std::memory_order_relaxed) != 0) Notify(peer);
+            return (long)n;
+        }
+        in->readerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (in->head.load(std::memory_order_acquire) != tail) continue;
+        if (block == false)
+        {
+            errno = EAGAIN;
+            return -1;
+        }
+        if (0 != Wait(sock) && in->head.load(std::memory_order_acquire) == tail) return 0;
+    }
+}
+
+inline long ShmLink::Send(const char *buf, std::size_t len, bool block, int sock)
+{
+    std::size_t sent = 0;
+    while (true)
+    {
+        uint64_t head = out->head.load(std::memory_order_relaxed);
+        uint64_t tail = out->tail.load(std::memory_order_acquire);
+        if (head - tail > kRingSize) return Corrupt();
+        std::size_t n = std::min<std::size_t>(len - sent, kRingSize - (std::size_t)(head - tail));
+        if (n > 0)
+        {
+            std::size_t pos = (std::size_t)(head & (kRingSize - 1));
+            std::size_t n0  = std::min(n, kRingSize - pos);
+            memcpy(out->data + pos, buf + sent, n0);
+            memcpy(out->data, buf + sent + n0, n - n0);
+            out->head.store(head + n, std::memory_order_release);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (out->readerWaiting.load(std::memory_order_relaxed) != 0) Notify(peer);
+            sent += n;
+        }
+        if (sent == len)
+        {
+            if (out->writerWaiting.load(std::memory_order_relaxed) != 0) out->writerWaiting.store(0, std::memory_order_relaxed);
+            return (long)sent;
+        }
+        out->writerWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (out->tail.load(std::memory_order_acquire) != tail) continue;
+        if (block == false)
+        {
+            if (sent > 0) return (long)sent;
+            errno = EAGAIN;
+            return -1;
+        }
+        if (0 != Wait(sock))
+        {
+            errno = EPIPE;
+            return -1;
+        }
+    }
+}
+
+inline void ShmLink::Drain()
+{
+    uint64_t val;
+    while (read(bell, &val, sizeof(val)) < 0 && errno == EINTR);
+}
+
+inline void ShmLink::Notify(int fd) const
+{
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) < 0 && errno == EINTR);
+}
+
+inline int ShmLink::Wait(int sock)
+{
+    struct pollfd pfd[2] = {};
+    pfd[0].fd     = bell;
+    pfd[0].events = POLLIN;
+    pfd[1].fd     = sock;
+    pfd[1].events = POLLIN;
+    while (poll(pfd, 2, -1) < 0)
+        if (errno != EINTR) return -1;
+    if ((pfd[0].revents & POLLIN) != 0)
+    {
+        Drain();
+        return 0;
+    }
+    return (pfd[1].revents != 0 ? -1 : 0); // nothing but disconnection is sent through sock once linked
+}
+
+inline long ShmLink::SendFds(int sock, const char *buf, std::size_t len, const int (&fds_)[nFds])
+{
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(buf);
+    iov.iov_len  = len;
+
+    union {
+        char           bufCtrl[CMSG_SPACE(sizeof(int) * nFds)];
+        struct cmsghdr align;
+    } ctrl;
+    memset(&ctrl, 0, sizeof(ctrl));
+
+    struct msghdr msg = {};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl.bufCtrl;
+    msg.msg_controllen = sizeof(ctrl.bufCtrl);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type  = SCM_RIGHTS;
+    cmsg->cmsg_len   = CMSG_LEN(sizeof(int) * nFds);
+    memcpy(CMSG_DATA(cmsg), fds_, sizeof(int) * nFds);
+
+    return (long)sendmsg(sock, &msg, MSG_NOSIGNAL);
+}
+
+inline long ShmLink::RecvFds(int sock, char *buf, std::size_t len, int (&fds_)[nFds], int &nRecv)
+{
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len  = len;
+
+    union {
+        char           bufCtrl[CMSG_SPACE(sizeof(int) * nFds)];
+        struct cmsghdr align;
+    } ctrl;
+
+    struct msghdr msg = {};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl.bufCtrl;
+    msg.msg_controllen = sizeof(ctrl.bufCtrl);
+
+    nRecv = 0;
+    auto ret = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    if (ret < 0) return (long)ret;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        std::size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int); // fits in bufCtrl
+        int fdsRecv[nFds];
+        memcpy(fdsRecv, CMSG_DATA(cmsg), sizeof(int) * n);
+        if (n == (std::size_t)nFds && (msg.msg_flags & MSG_CTRUNC) == 0)
+        {
+            std::copy(std::begin(fdsRecv), std::end(fdsRecv), std::begin(fds_));
+            nRecv = nFds;
+        }
+        else
+            for (std::size_t i = 0; i < n; i++) close(fdsRecv[i]);
+    }
+    return (long)ret;
+}
+
+#else
+
+inline int  ShmLink::Create(int (&)[nFds])       { return -1; }
+inline int  ShmLink::Attach(const int (&)[nFds]) { return -1; }
+inline void ShmLink::Close ()                    {}
+inline long ShmLink::Recv  (char*, std::size_t, bool, int)       { errno = EINVAL; return -1; }
+inline long ShmLink::Send  (const char*, std::size_t, bool, int) { errno = EINVAL; return -1; }
+inline void ShmLink::Drain ()                    {}
+inline long ShmLink::SendFds(int, const char*, std::size_t, const int (&)[nFds])      { return -1; }
+inline long ShmLink::RecvFds(int, char*, std::size_t, int (&)[nFds], int &nRecv)      { nRecv = 0; return -1; }
+
+#endif /* __linux__ */
+
+}
+
+#endif /* SIBYL_SHMLINK_H_ */
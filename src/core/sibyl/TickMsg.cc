@@ -0,0 +1,239 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "TickMsg.h"
+
+#include <cstdio>
+#include <cinttypes>
+
+namespace sibyl
+{
+
+namespace
+{
+    // snprintf at the end of msg, in place (no line buffer to outgrow)
+    template <class... Args>
+    void AppendF(STR &msg, const char *format, Args... args)
+    {
+        constexpr std::size_t szGuess = 1 << 9; // longer lines are formatted twice
+        std::size_t len = msg.size();
+        msg.resize(len + szGuess);
+        int n = snprintf(&msg[len], szGuess, format, args...);
+        verify(n >= 0);
+        if ((std::size_t)n >= szGuess)
+        {
+            msg.resize(len + (std::size_t)n + 1);
+            snprintf(&msg[len], (std::size_t)n + 1, format, args...);
+        }
+        msg.resize(len + (std::size_t)n);
+    }
+    
+    // decimal digits of v at the end of msg, as %d or %lld would (digits in pairs from a table)
+    void AppendInt(STR &msg, INT64 v)
+    {
+        static const char kDigits[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+        char buf[24];
+        char *pc = buf + sizeof(buf);
+        uint64_t u = (v < 0 ? 0 - (uint64_t)v : (uint64_t)v);
+        while (u >= 100)
+        {
+            std::size_t d = (std::size_t)(u % 100) * 2;
+            u /= 100;
+            *--pc = kDigits[d + 1];
+            *--pc = kDigits[d    ];
+        }
+        if (u >= 10)
+        {
+            *--pc = kDigits[u * 2 + 1];
+            *--pc = kDigits[u * 2    ];
+        }
+        else *--pc = (char)('0' + u);
+        if (v < 0) *--pc = '-';
+        msg.append(pc, (std::size_t)(buf + sizeof(buf) - pc));
+    }
+}
+
+void BuildStateText(const StateMsg &state, STR &msg)
+{
+    StateText::Build(state, msg, nullptr);
+}
+
+void StateText::Build(const StateMsg &state, STR &msg, std::vector<Fragment> *pCache)
+{
+    // capacity of msg is kept across calls; reserve so that a message is formatted without reallocation
+    constexpr std::size_t szHeader = 1 << 10, szItem = 1 << 9; // d & o (& e) lines of an item without orders
+    std::size_t szOrd = 0;
+    for (const auto &s : state.items) szOrd += s.ord.size();
+    msg.clear();
+    msg.reserve(szHeader + szItem * state.items.size() + 16 * szOrd);
+    
+    // /*\n
+    // b time bal sum.buy sum.sell sum.feetax
+    msg.append("/*\nb ");
+    AppendInt(msg, state.time    ); msg.push_back(' ');
+    AppendInt(msg, state.bal     ); msg.push_back(' ');
+    AppendInt(msg, state.sum.buy ); msg.push_back(' ');
+    AppendInt(msg, state.sum.sell); msg.push_back(' ');
+    AppendInt(msg, state.sum.feetax);
+    msg.push_back('\n');
+    
+    // s sum.tck_orig.{bal q ord}[0..<(idx::szTb + 2)] (interleaved ordering)
+    msg.append("s");
+    for (const auto &s : state.sum.tck_orig) {
+        msg.push_back(' '); AppendInt(msg, s.bal);
+        msg.push_back(' '); AppendInt(msg, s.q  );
+        msg.push_back(' '); AppendInt(msg, s.evt);
+    }
+    msg.append("\n");
+    
+    // k kospi200
+    AppendF(msg, "k %.5e\n", state.kospi200);
+    
+    // Individual items (d|D, (e), (n), o); lines of a full item reused from the cache while it is unchanged
+    if (pCache != nullptr && pCache->size() != state.items.size()) pCache->resize(state.items.size());
+    for (std::size_t k = 0; k < state.items.size(); k++)
+    {
+        const auto &s = state.items[k];
+        if (pCache == nullptr || s.tbrMask != ItemMsg::kTbrAll)
+        {
+            AppendItem(msg, s);
+            continue;
+        }
+        auto &f = (*pCache)[k];
+        if (f.valid == false || SameItem(f.item, s) == false)
+        {
+            f.item = s;
+            f.text.clear();
+            AppendItem(f.text, s);
+            f.valid = true;
+        }
+        msg.append(f.text);
+    }
+    msg.append("*/\n");
+}
+
+void StateText::AppendItem(STR &msg, const ItemMsg &s)
+{
+    const auto &tbm = s.tbr; // tb_merged
+    
+    if (s.tbrMask == ItemMsg::kTbrAll)
+    {
+        // d code pr qr tbr.p[0..<idx::szTb] tbr.q[0..<idx::szTb]
+        AppendF(msg, "d %s %.5e ", s.code.c_str(), s.pr);
+        AppendInt(msg, s.qr);
+        for (std::size_t idx = 0; idx < idx::szTb; idx++) { msg.push_back(' '); AppendInt(msg, tbm[idx].p); }
+        for (std::size_t idx = 0; idx < idx::szTb; idx++) { msg.push_back(' '); AppendInt(msg, tbm[idx].q); }
+        msg.push_back('\n');
+    }
+    else
+    {
+        // D code pr qr (idx tbr.p tbr.q)[changed levels] (delta messages only)
+        AppendF(msg, "D %s %.5e ", s.code.c_str(), s.pr);
+        AppendInt(msg, s.qr);
+        for (std::size_t idx = 0; idx < idx::szTb; idx++)
+        {
+            if ((s.tbrMask & (1u << idx)) == 0) continue;
+            msg.push_back(' '); AppendInt(msg, (INT64)idx);
+            msg.push_back(' '); AppendInt(msg, tbm[idx].p);
+            msg.push_back(' '); AppendInt(msg, tbm[idx].q);
+        }
+        msg.push_back('\n');
+    }
+    
+    if (s.type == SecType::ELW)
+    {
+        AppendF(msg, "e %s %+d %d %.5e %.5e %.5e %.5e %.5e %.5e %.5e %.5e\n",
+                            s.code.c_str(), s.iCP, s.expiry,
+                            s.thr[0], s.thr[1], s.thr[2], s.thr[3], s.thr[4], s.thr[5], s.thr[6], s.thr[7]);
+    }
+    
+    if (s.type == SecType::ETF)
+    {
+        AppendF(msg, "n %s %.5e\n", s.code.c_str(), s.devNAV);
+    }
+    
+    msg.append("o ");
+    msg.append(s.code);
+    msg.push_back(' ');
+    AppendInt(msg, s.cnt);
+    
+    // orders of the same price merged (+ for buy, - for sell)
+    for (const auto &pq : s.ord)        
+    {
+        msg.push_back(' ');
+        AppendInt(msg, pq.p);
+        msg.push_back(' ');
+        if (pq.q >= 0) msg.push_back('+'); // %+d
+        AppendInt(msg, pq.q);
+    }
+    msg.push_back('\n');
+}
+
+bool StateText::SameItem(const ItemMsg &a, const ItemMsg &b)
+{
+    return a.code == b.code && a.type == b.type && a.pr == b.pr && a.qr == b.qr && a.tbr == b.tbr &&
+           a.tbrMask == b.tbrMask && a.cnt == b.cnt && a.ord == b.ord &&
+           (a.type != SecType::ELW || (a.iCP == b.iCP && a.expiry == b.expiry && a.thr == b.thr)) &&
+           (a.type != SecType::ETF || a.devNAV == b.devNAV);
+}
+
+const StateMsg& StateDelta::Filter(const StateMsg &state)
+{
+    if (snapshotPeriod == 0) return state;
+    
+    bool full = (sent.size() != state.items.size() || ++nSinceSnapshot >= snapshotPeriod);
+    if (full == true)
+    {
+        sent.resize(state.items.size());
+        nSinceSnapshot = 0;
+    }
+    
+    delta.time     = state.time;
+    delta.bal      = state.bal;
+    delta.sum      = state.sum;
+    delta.kospi200 = state.kospi200;
+    delta.items.clear();
+    for (std::size_t k = 0; k < state.items.size(); k++)
+    {
+        const auto &s = state.items[k];
+        auto       &l = sent[k];
+        
+        uint32_t mask = ItemMsg::kTbrAll;
+        if (full == false)
+        {
+            mask = 0;
+            for (std::size_t idx = 0; idx < idx::szTb; idx++)
+                if (s.tbr[idx] != l.tbr[idx]) mask |= (1u << idx);
+            
+            bool dirty = (mask != 0) || s.code != l.code || s.pr != l.pr || s.qr != l.qr || s.cnt != l.cnt || s.ord != l.ord ||
+                         (s.type == SecType::ELW && (s.iCP != l.iCP || s.expiry != l.expiry || s.thr != l.thr)) ||
+                         (s.type == SecType::ETF && s.devNAV != l.devNAV);
+            if (dirty == false) continue;
+            if (s.code != l.code) mask = ItemMsg::kTbrAll;
+        }
+        
+        l = s;
+        delta.items.push_back(s);
+        delta.items.back().tbrMask = mask;
+    }
+    
+    return delta;
+}
+
+}
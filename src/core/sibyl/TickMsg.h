@@ -0,0 +1,120 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_TICKMSG_H_
+#define SIBYL_TICKMSG_H_
+
+#include <vector>
+#include <array>
+#include <cstdint>
+
+#include "Catalog.h"
+#include "ReqType.h"
+
+namespace sibyl
+{
+
+// Structured equivalents of the messages exchanged every tick, for passing them
+// between a Broker and a Trader in the same process (see DirectLink.h)
+
+// One line of the req message (see ReqType.h); code is empty for ca/sa
+struct ReqMsg
+{
+    ReqType type;
+    STR     code;
+    INT     p, q, mp; // mp: newprice for mb/ms only (0 otherwise)
+    ReqMsg() : type(ReqType::null), p(0), q(0), mp(0) {}
+    ReqMsg(ReqType type_, CSTR &code_, INT p_, INT q_, INT mp_ = 0) : type(type_), code(code_), p(p_), q(q_), mp(mp_) {}
+};
+
+// d, (e), (n), o lines of the state message (see BuildStateText)
+struct ItemMsg
+{
+    STR     code;
+    SecType type;
+    FLOAT   pr;
+    INT64   qr;
+    std::array<PQ, idx::szTb> tbr; // with own orders merged if requested
+    uint32_t tbrMask;              // bit idx set if tbr[idx] is valid (delta messages; see StateDelta)
+    int     iCP, expiry;           // ELW only
+    std::array<FLOAT, ELW<Security<PQ>>::szTh> thr; // ELW only
+    FLOAT   devNAV;                // ETF only
+    INT     cnt;
+    std::vector<PQ> ord;           // merged per price; q > 0 for buy, q < 0 for sell
+    ItemMsg() : type(SecType::null), pr(0.0f), qr(0), tbr{}, tbrMask(kTbrAll), iCP(0), expiry(0), thr{}, devNAV(0.0f), cnt(0) {}
+    
+    constexpr static uint32_t kTbrAll = (1u << idx::szTb) - 1;
+};
+static_assert(idx::szTb <= 32, "ItemMsg::tbrMask too narrow");
+
+// Whole state message; items are in the order of codes
+// (delta messages only have items changed since the previous message)
+struct StateMsg
+{
+    int     time;
+    INT64   bal;
+    SumStat sum;
+    FLOAT   kospi200;
+    std::vector<ItemMsg> items;
+    StateMsg() : time(0), bal(0), sum{0, 0, 0, {}}, kospi200(0.0f) {}
+};
+
+// Text format of a state message (see TickMsg.cc); msg is replaced
+void BuildStateText(const StateMsg &state, STR &msg);
+
+// BuildStateText for a sender of successive states: the lines of each full item are kept and
+// formatted again only when the item changed (table, price/quant, count or own orders), then concatenated
+class StateText
+{
+public:
+    void Build(const StateMsg &state, STR &msg) { Build(state, msg, &cache); }
+    void Reset() { cache.clear(); }
+private:
+    struct Fragment {
+        ItemMsg item; // as formatted
+        STR     text;
+        bool    valid;
+        Fragment() : valid(false) {}
+    };
+    std::vector<Fragment> cache; // by position in StateMsg::items
+    
+    static void Build     (const StateMsg &state, STR &msg, std::vector<Fragment> *pCache); // no cache if nullptr
+    static void AppendItem(STR &msg, const ItemMsg &s);
+    static bool SameItem  (const ItemMsg &a, const ItemMsg &b);
+    
+    friend void BuildStateText(const StateMsg &state, STR &msg);
+};
+
+// Reduces full state messages to the items (and tbr levels) changed since the previous call,
+// passing a full one every snapshotPeriod calls (0: always; default), when the items change and after Reset
+class StateDelta
+{
+public:
+    void SetPeriod(int snapshotPeriod_) { snapshotPeriod = snapshotPeriod_; Reset(); }
+    void Reset() { sent.clear(); }
+    
+    const StateMsg& Filter(const StateMsg &state); // returns state itself if always full
+    
+    StateDelta() : snapshotPeriod(0), nSinceSnapshot(0) {}
+private:
+    int snapshotPeriod, nSinceSnapshot;
+    std::vector<ItemMsg> sent; // items as of the previous call
+    StateMsg delta;
+};
+
+}
+
+#endif /* SIBYL_TICKMSG_H_ */
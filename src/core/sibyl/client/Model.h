@@ -29,9 +29,16 @@ class Model
 public:
     // Build list of requests based on pPortfolio and internal model
     virtual CSTR& BuildMsgOut() = 0;
+    virtual const std::vector<ReqMsg>& BuildReqs() = 0; // structured equivalent of BuildMsgOut
 
     // Called by Trader
     virtual void SetStateLogPaths(CSTR &state, CSTR &log) = 0;
+    virtual void ResetDay() = 0; // back to the state before the first tick of a day
+    
+    // State kept across ticks (see Trader::SetCheckpoint); Load is called at the first tick after a restart,
+    // with pPortfolio already updated, timeSaved being the time of the tick Save was called at
+    virtual void SaveCheckpoint(Checkpoint &ckpt) const = 0;
+    virtual int  LoadCheckpoint(Checkpoint &ckpt, int timeSaved) = 0; // returns non-0 for invalid data
 
     void SetPortfolio(Portfolio *pPortfolio_) { pPortfolio = pPortfolio_; }
 
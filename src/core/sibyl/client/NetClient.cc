@@ -24,77 +24,224 @@ namespace sibyl
 
 int NetClient::Connect(CSTR &addr, CSTR &port)
 {
-    addrinfo hints, *ai;
-    memset(&hints, 0, sizeof(addrinfo));
-    hints.ai_family   = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
+    // unix: or shm: address given in place of either (see NetAgent::ParseLocal)
+    STR  path;
+    bool useShm = false;
+    bool local  = ParseLocal(addr, path, useShm) || ParseLocal(port, path, useShm);
     
-    getaddrinfo(addr.c_str(), port.c_str(), &hints, &ai);
-    int ret            = sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
-    if (sock_fail != ret) ret = connect(sock, ai->ai_addr, ai->ai_addrlen);
-    freeaddrinfo(ai);
+    int ret;
+    if (local == true)
+    {
+        #ifndef _WIN32
+        struct sockaddr_un addr_serv;
+        if (0 != SetUnixAddr(addr_serv, path))
+        {
+            std::cerr << "NetClient: Invalid unix socket path " << path << std::endl;
+            return -1;
+        }
+        ret = sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sock_fail != ret) ret = connect(sock, (struct sockaddr *)&addr_serv, sizeof(addr_serv));
+        #else
+        std::cerr << "NetClient: Unix sockets not supported" << std::endl;
+        return -1;
+        #endif /* !_WIN32 */
+    }
+    else
+    {
+        addrinfo hints, *ai;
+        memset(&hints, 0, sizeof(addrinfo));
+        hints.ai_family   = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+        
+        getaddrinfo(addr.c_str(), port.c_str(), &hints, &ai);
+        ret            = sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (sock_fail != ret) ret = connect(sock, ai->ai_addr, ai->ai_addrlen);
+        freeaddrinfo(ai);
+    }
     
-    if (0 == ret) send(sock, kTCPPassword, strlen(kTCPPassword), 0);
-    else          std::cerr << strerror(errno) << std::endl;
+    if (0 == ret)
+    {
+        STR msg(kTCPPassword);
+        if (binary == true) msg.append(BinMsg::kNegotiate);
+        if (framed == true) msg.append(BinMsg::kNegotiateFrame);
+        if (delta  == true) msg.append(BinMsg::kNegotiateDelta);
+        if (sub    == true) msg.append(BinMsg::kNegotiateSub);
+        msg.append(BinMsg::kNegotiateDay); // checkpoints are kept by day
+        if (useShm == true)
+        {
+            // rings are used only after the password is sent along with their descriptors
+            int fds[ShmLink::nFds];
+            msg.append(BinMsg::kNegotiateShm);
+            msg.append(BinMsg::kNegotiateEnd);
+            if (0 != shm.Create(fds) || 0 > ShmLink::SendFds(sock, msg.c_str(), msg.size(), fds))
+            {
+                std::cerr << "NetClient: Shared memory link failed\n" << strerror(errno) << std::endl;
+                Disconnect();
+                return -1;
+            }
+        }
+        else
+        {
+            msg.append(BinMsg::kNegotiateEnd);
+            send(sock, msg.c_str(), msg.size(), 0);
+        }
+    }
+    else std::cerr << strerror(errno) << std::endl;
     return ret;
 }
 
 int NetClient::RecvNextTick()
 {   
-    // Process packets until a full message is received
-    std::size_t lenMark       = 3;
-    const char  pcStartMark[] = "/*\n";
-    const char  pcEndMark  [] = "*/\n";
+    pTrader->latency.EndCycle(false);
+    timeRecv = TickLatency::clock::now();
     
+    lenMsg = 0;
     bufMsg[0] = '\0';
-    bool isNewMsg = true;
-    while (true)
+    
+    if (framed == true)
     {
-        memset(bufTCP, 0, kTCPBufSize);
-        if (recv(sock, bufTCP, kTCPBufSize, 0) > 0) 
+        BinMsg::Header h;
+        if (0 != RecvExact(sock, reinterpret_cast<char*>(&h), sizeof(h)))
         {
-            if (isNewMsg == true)
-            {
-                if (strncmp(bufTCP, pcStartMark, lenMark))
-                    continue;
-                else
-                    isNewMsg = false;
-            }
-            std::size_t len = strlen(bufTCP);
-            if ((len = strlen(bufMsg) + len) >= kTCPBufSize)
+            if (verbose) std::cout << "Server disconnected" << std::endl;
+            return Disconnect();
+        }
+        if (BinMsg::IsMagic(h.magic) == true)
+        {
+            if (0 != RecvPayload(sock, h.size))
             {
-                std::cerr << "NetClient: TCP input buffer overflow" << std::endl;
-                return -1;
+                if (verbose) std::cout << "Server disconnected" << std::endl;
+                return Disconnect();
             }
-            strcat(bufMsg, bufTCP);
-            if ((len >= lenMark) && !strncmp(bufMsg + len - lenMark, pcEndMark, lenMark))
-                break;
+            if (h.magic != BinMsg::kMagicText) return RecvBinNextTick(h);
         }
         else
+        {
+            // server replied in unframed text; fall back to it for the rest of the session
+            binary = framed = false;
+            if (0 == memcmp(&h, kStartMark, strlen(kStartMark))) AppendMsg(reinterpret_cast<char*>(&h), sizeof(h));
+            if (0 != RecvUnframed()) return Disconnect();
+        }
+    }
+    else if (0 != RecvUnframed()) return Disconnect();
+    
+    char *msg = bufMsg.data();
+    if (verbose) std::cout << msg << std::endl;
+    
+    // "/*\nday <name>\n*/\n" (see NetServer::SendNewDay)
+    const char pcDayMark[] = "/*\nday ";
+    if (0 == strncmp(msg, pcDayMark, strlen(pcDayMark)))
+    {
+        char *pcName = msg + strlen(pcDayMark);
+        char *pc = strpbrk(pcName, "\r\n");
+        if (pc != NULL) *pc = '\0';
+        pTrader->NewDay(pcName);
+        SendText("\n");
+        return 1;
+    }
+    
+    Received();
+    if (0 != pTrader->ApplyMsgIn(msg)) return Disconnect();
+    return 0;
+}
+
+int NetClient::RecvUnframed()
+{
+    // Process packets until a packet ends with kEndMark (packets before kStartMark are dropped)
+    const std::size_t lenMark = strlen(kEndMark);
+    while (true)
+    {
+        std::size_t lenPrev = lenMsg;
+        if (RecvAppend(sock) <= 0)
         {
             if (verbose) std::cout << "Server disconnected" << std::endl;
-            close_socket(sock);
-            sock = sock_fail;
             return -1;
         }
+        if ((lenPrev == 0) && strncmp(bufMsg.data(), kStartMark, strlen(kStartMark)))
+        {
+            lenMsg = 0;
+            continue;
+        }
+        if ((lenMsg >= lenMark) && !strncmp(bufMsg.data() + lenMsg - lenMark, kEndMark, lenMark))
+            return 0;
+    }
+}
+
+int NetClient::RecvBinNextTick(const BinMsg::Header &h)
+{
+    if (h.magic == BinMsg::kMagicDay)
+    {
+        STR name;
+        BinMsg::DecodeDay(bufMsg.data(), lenMsg, name);
+        if (verbose) std::cout << "Day " << name << std::endl;
+        pTrader->NewDay(name);
+        BinMsg::EncodeReqs(std::vector<ReqMsg>(), bufBin);
+        SendLink(sock, bufBin.data(), bufBin.size());
+        return 1;
     }
-    if (verbose) std::cout << bufMsg << std::endl;
     
-    if (0 != pTrader->ApplyMsgIn(bufMsg))
+    if (h.magic != BinMsg::kMagicState || 0 != BinMsg::DecodeState(bufMsg.data(), lenMsg, state))
     {
-        close_socket(sock);
-        sock = sock_fail;
-        return -1;
+        std::cerr << "NetClient: Invalid binary state msg" << std::endl;
+        return Disconnect();
     }
+    if (verbose) std::cout << "State [t=" << state.time << "] " << h.size << " bytes" << std::endl;
+    
+    Received();
+    if (0 != pTrader->ApplyState(state)) return Disconnect();
     return 0;
 }
 
+int NetClient::Disconnect()
+{
+    if (sock != sock_fail)
+    {
+        pTrader->latency.EndCycle(false);
+        pTrader->latency.Print(std::cout, "client");
+    }
+    shm.Close();
+    close_socket(sock);
+    sock = sock_fail;
+    return -1;
+}
+
 void NetClient::SendResponse()
 {
-    auto &msg = pTrader->BuildMsgOut(); 
-    send(sock, msg.c_str(), msg.size(), 0);
-    if (verbose) std::cout << msg << std::endl;
+    if (binary == true)
+    {
+        const auto &reqs = pTrader->BuildReqs();
+        BinMsg::EncodeReqs(reqs, bufBin);
+        SendLink(sock, bufBin.data(), bufBin.size());
+        if (verbose)
+        {
+            for (const auto &r : reqs)
+            {
+                std::cout << ReqWord(r.type) << " " << r.code << " " << r.p << " " << r.q;
+                if (r.mp > 0) std::cout << " " << r.mp;
+                std::cout << "\n";
+            }
+            std::cout << std::endl;
+        }
+    }
+    else
+    {
+        auto &msg = pTrader->BuildMsgOut(); 
+        SendText(msg);
+        if (verbose) std::cout << msg << std::endl;
+    }
+    pTrader->EndTick();
+}
+
+void NetClient::SendText(CSTR &msg)
+{
+    if (framed == true)
+    {
+        BinMsg::EncodeText(msg, bufBin);
+        SendLink(sock, bufBin.data(), bufBin.size());
+    }
+    else
+        SendLink(sock, msg.c_str(), msg.size());
 }
 
 }
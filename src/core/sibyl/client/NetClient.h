@@ -18,30 +18,57 @@
 #define SIBYL_CLIENT_NETCLIENT_H_
 
 #include "../NetAgent.h"
+#include "../BinMsg.h"
 #include "Trader.h"
 
 namespace sibyl
 {
 
-// Implement a TCP client and relay messages between Trader and the server
+// Implement a TCP (or unix socket, shared memory) client and relay messages between Trader and the server
 class NetClient : public NetAgent
 {
 public:
+    // Request binary messages (see BinMsg.h) at Connect; falls back to text if the server replies in text
+    void SetBinary(bool binary_) { binary = binary_; }
+    // Request delta state messages (only changed items & book levels; see StateDelta in TickMsg.h) at Connect
+    void SetDelta (bool delta_ ) { delta  = delta_;  }
+    // Connect as a read-only subscriber (server never waits for, nor applies, SendResponse)
+    void SetSubscriber(bool sub_) { sub = sub_; }
+    
     // Connect to server and send password
+    // unix:<path> or shm:<path> as either addr or port connects on the same host (see NetAgent::ParseLocal)
     // Returns 0 for success, non-0 otherwise
     int Connect(CSTR &addr, CSTR &port);
     
-    // Block until message from server arrives and call Trader::ApplyMsgIn
-    // Returns 0 for success, non-0 otherwise
+    // Block until message from server arrives and call Trader::ApplyMsgIn (parsed in place)
+    // For a day boundary message (multi-day simulation), call Trader::NewDay and reply instead
+    // Returns 0 for success, +1 for a day boundary (no SendResponse expected), -1 otherwise
+    // Each call starts a cycle of Trader::latency, which is printed on disconnection
     int RecvNextTick();
 
-    // Call Trader::BuildMsgOut and send the built message to server
+    // Call Trader::BuildMsgOut (or BuildReqs) and send the built message to server, then Trader::EndTick
     void SendResponse();
 
-    NetClient(Trader *ptr) : pTrader(ptr), sock(sock_fail) {}
+    NetClient(Trader *ptr) : pTrader(ptr), sock(sock_fail), binary(true), framed(true), delta(true), sub(false) {}
 private:
     Trader *pTrader;
     int sock;
+    
+    bool binary;
+    bool framed; // length-prefixed text messages (BinMsg::kMagicText); always true if binary until fallback
+    bool delta;
+    bool sub;
+    StateMsg state;
+    TickLatency::clock::time_point timeRecv; // RecvNextTick called
+    
+    int RecvBinNextTick(const BinMsg::Header &h); // binary counterpart of RecvNextTick after payload
+    int RecvUnframed();                           // unframed text message into bufMsg; returns -1 on disconnection
+    void Received() { pTrader->latency.Add(TickPhase::recvTick, TickLatency::clock::now() - timeRecv); }
+    void SendText(CSTR &msg);
+    
+    constexpr static const char *kStartMark = "/*\n";
+    constexpr static const char *kEndMark   = "*/\n";
+    int Disconnect();                             // returns -1
 };
 
 }
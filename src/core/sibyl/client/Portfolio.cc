@@ -84,6 +84,18 @@ void Portfolio::SetStateLogPaths(CSTR &state, CSTR &log)
     }
 }
 
+ItemTable<ItemPf>::iterator Portfolio::FindOrInsert(CSTR &code)
+{
+    auto iM = items.find(code);
+    if (iM == std::end(items))
+    {
+        auto it_bool = items.insert(std::make_pair(code, std::unique_ptr<ItemPf>(new KOSPI<ItemPf>)));
+        verify(it_bool.second == true); // assure successful insertion
+        iM = it_bool.first;
+    }
+    return iM;
+}
+
 int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
 {    
     if (logMsgIn.is_open() == true) // log raw input from server
@@ -103,8 +115,8 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
         
         if (pcLine[0] == 'b')
         {
-            // char cW : index of word (warning: overflows at 127)
-            for (char *pcWord = strchr(pcLine, ' '), cW = 1; pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
+            int cW = 1; // index of word (an o line has 2 words per order)
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
                 while (*pcWord == ' ') pcWord++;
                 if (cW == 1) {
@@ -120,7 +132,8 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
         }
         if (pcLine[0] == 's')
         {
-            for (char *pcWord = strchr(pcLine, ' '), cW = 1; pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
+            int cW = 1;
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
                 while (*pcWord == ' ') pcWord++;
                 if ((cW - 1) % 3 == 0) sscanf(pcWord, "%" SCNd64, &sum.tck_orig[(std::size_t)((cW - 1) / 3)].bal);
@@ -130,7 +143,8 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
         }
         if (pcLine[0] == 'k')
         {
-            for (char *pcWord = strchr(pcLine, ' '), cW = 1; pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
+            int cW = 1;
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
                 while (*pcWord == ' ') pcWord++;
                 if (cW == 1) sscanf(pcWord, "%f", &ELW<ItemPf>::kospi200);
@@ -139,23 +153,14 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
         if (pcLine[0] == 'd')
         {
             iM = std::end(items);
-            for (char *pcWord = strchr(pcLine, ' '), cW = 1; pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
+            int cW = 1;
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
                 while (*pcWord == ' ') pcWord++;
                 if (cW == 1)
                 {
                     char *pcSpace = strchr(pcWord, ' ');
-                    if (pcSpace != nullptr) *pcSpace = '\0';
-                    STR c(pcWord);
-                    if (pcSpace != nullptr) *pcSpace = ' ';
-                    
-                    iM = items.find(c);
-                    if (iM == std::end(items))
-                    {
-                        auto it_bool = items.insert(std::make_pair(c, std::unique_ptr<ItemPf>(new KOSPI<ItemPf>)));
-                        verify(it_bool.second == true); // assure successful insertion
-                        iM = it_bool.first;
-                    }
+                    iM = FindOrInsert(STR(pcWord, (pcSpace != nullptr ? (std::size_t)(pcSpace - pcWord) : strlen(pcWord))));
                 }
                 auto &i = *(iM->second); // reference to ItemPf
                 if  (cW ==  2)               sscanf(pcWord, "%f"      , &i.pr);
@@ -164,23 +169,44 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
                 if ((cW >= 24) && (cW < 44)) sscanf(pcWord, "%d"      , &i.tbr[(std::size_t)(cW - 24)].q);
             }
         }
-        if (pcLine[0] == 'e')
+        if (pcLine[0] == 'D') // delta message: only changed tbr levels as (idx p q) triplets
         {
-            if (iM->second->Type() == SecType::KOSPI) // on first run: reallocate as ELW
+            iM = std::end(items);
+            std::size_t idx = 0;
+            int cW = 1;
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
-                auto &ptr = iM->second;
-                KOSPI<ItemPf> temp = *static_cast<KOSPI<ItemPf>*>(ptr.get()); // store copy
-                ptr.reset(new ELW<ItemPf>);
-                ptr->pr   = temp.pr;
-                ptr->qr   = temp.qr;
-                ptr->tbr  = temp.tbr;
+                while (*pcWord == ' ') pcWord++;
+                if (cW == 1)
+                {
+                    char *pcSpace = strchr(pcWord, ' ');
+                    iM = FindOrInsert(STR(pcWord, (pcSpace != nullptr ? (std::size_t)(pcSpace - pcWord) : strlen(pcWord))));
+                }
+                auto &i = *(iM->second); // reference to ItemPf
+                if  (cW ==  2)                     sscanf(pcWord, "%f"      , &i.pr);
+                if  (cW ==  3)                     sscanf(pcWord, "%" SCNd64, &i.qr);
+                if ((cW >=  4) && (cW % 3 == 1))
+                {
+                    sscanf(pcWord, "%zu", &idx);
+                    if (idx >= idx::szTb)
+                    {
+                        std::cerr << "Portfolio: invalid tbr index " << idx << " in a delta line" << std::endl;
+                        return -1;
+                    }
+                }
+                if ((cW >=  4) && (cW % 3 == 2))   sscanf(pcWord, "%d"      , &i.tbr[idx].p);
+                if ((cW >=  4) && (cW % 3 == 0))   sscanf(pcWord, "%d"      , &i.tbr[idx].q);
             }
-            auto &i = *static_cast<ELW<ItemPf>*>(iM->second.get()); // reference as ELW<ItemPf>
+        }
+        if (pcLine[0] == 'e')
+        {
+            auto &i = Reallocate<ELW<ItemPf>>(iM->second); // on first run: reallocate as ELW
             
             OptType optType(OptType::null);
             int expiry = -1;
             int iCP = 0;
-            for (char *pcWord = strchr(pcLine, ' '), cW = 1; pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
+            int cW = 1;
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
                 while (*pcWord == ' ') pcWord++;
                 if  (cW ==  2)               sscanf(pcWord, "%d", &iCP);
@@ -193,18 +219,10 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
         }
         if (pcLine[0] == 'n')
         {
-            if (iM->second->Type() == SecType::KOSPI) // on first run: reallocate as ETF
-            {
-                auto &ptr = iM->second;
-                KOSPI<ItemPf> temp = *static_cast<KOSPI<ItemPf>*>(ptr.get()); // store copy
-                ptr.reset(new ETF<ItemPf>);
-                ptr->pr   = temp.pr;
-                ptr->qr   = temp.qr;
-                ptr->tbr  = temp.tbr;
-            }
-            auto &i = *static_cast<ETF<ItemPf>*>(iM->second.get()); // reference as ETF<ItemPf>
+            auto &i = Reallocate<ETF<ItemPf>>(iM->second); // on first run: reallocate as ETF
             
-            for (char *pcWord = strchr(pcLine, ' '), cW = 1; pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
+            int cW = 1;
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
                 while (*pcWord == ' ') pcWord++;
                 if  (cW ==  2)               sscanf(pcWord, "%f", &i.devNAV);
@@ -215,7 +233,8 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
             auto &i = *(iM->second); // reference to ItemPf
             i.ord.clear();
             OrderPf o;
-            for (char *pcWord = strchr(pcLine, ' '), cW = 1; pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
+            int cW = 1;
+            for (char *pcWord = strchr(pcLine, ' '); pcWord != nullptr; pcWord = strchr(pcWord, ' '), cW++)
             {
                 while (*pcWord == ' ') pcWord++;
                 if  (cW == 2)                 sscanf(pcWord, "%d", &i.cnt);
@@ -236,6 +255,89 @@ int Portfolio::ApplyMsgIn(char *msg) // Parse message and update entries
         }
     }
     
+    return OnMsgIn();
+}
+
+int Portfolio::ApplyState(const StateMsg &state)
+{
+    time = state.time; // std::atomic_int time
+    bal  = state.bal;
+    sum  = state.sum;
+    ELW<ItemPf>::kospi200 = state.kospi200;
+    
+    for (const auto &s : state.items)
+    {
+        auto iM = FindOrInsert(s.code);
+        auto &i = *(iM->second); // reference to ItemPf
+        i.pr  = s.pr;
+        i.qr  = s.qr;
+        if (s.tbrMask == ItemMsg::kTbrAll)
+            i.tbr = s.tbr;
+        else
+        {
+            for (std::size_t idx = 0; idx < idx::szTb; idx++)
+                if ((s.tbrMask & (1u << idx)) != 0) i.tbr[idx] = s.tbr[idx];
+        }
+        
+        if (s.type == SecType::ELW)
+        {
+            auto &i = Reallocate<ELW<ItemPf>>(iM->second); // on first run: reallocate as ELW
+            std::copy(std::begin(s.thr), std::end(s.thr), std::begin(i.thr));
+            i.SetInfo((s.iCP == +1 ? OptType::call : (s.iCP == -1 ? OptType::put : OptType::null)), s.expiry);
+        }
+        if (s.type == SecType::ETF)
+        {
+            auto &i = Reallocate<ETF<ItemPf>>(iM->second); // on first run: reallocate as ETF
+            i.devNAV = s.devNAV;
+        }
+        
+        auto &iR = *(iM->second); // reference to ItemPf (possibly reallocated)
+        iR.cnt = s.cnt;
+        iR.ord.clear();
+        OrderPf o;
+        for (const auto &pq : s.ord)
+        {
+            verify(pq.q != 0);
+            o.p    = pq.p;
+            o.q    = (pq.q > 0 ? pq.q : -pq.q);
+            o.type = (pq.q > 0 ? OrdType::buy : OrdType::sell);
+            iR.ord.insert(std::make_pair(o.p, o));
+        }
+    }
+    
+    return OnMsgIn();
+}
+
+void Portfolio::ResetDay()
+{
+    items.clear();
+    Catalog<ItemPf>::ResetDay();
+    ELW<ItemPf>::kospi200 = (FLOAT) std::nan("");
+}
+
+void Portfolio::SaveCheckpoint(Checkpoint &ckpt) const
+{
+    ckpt.Put(balRef);
+    ckpt.Put(balInit);
+    ckpt.Put(isFirstTick);
+}
+
+int Portfolio::LoadCheckpoint(Checkpoint &ckpt)
+{
+    INT64 balRef_(0), balInit_(0);
+    bool  isFirstTick_(true);
+    ckpt.Get(balRef_);
+    ckpt.Get(balInit_);
+    ckpt.Get(isFirstTick_);
+    if (ckpt.Good() == false) return -1;
+    balRef      = balRef_;
+    balInit     = balInit_;
+    isFirstTick = isFirstTick_;
+    return 0;
+}
+
+int Portfolio::OnMsgIn()
+{
     UpdateRefInitBal();
     
     if (pathState.empty() == false) {
@@ -368,6 +470,7 @@ void Portfolio::WriteState()
             tot_s.clear();
             u_tot.clear();
             index.clear();
+            index_init = std::nan(""); // a new day (see ResetDay)
         }
 
         // if (timeCur >= 0 && timeCur <= kTimeBounds::stop && timeCur % 300 == 0) { // every 5 min
@@ -22,6 +22,8 @@
 
 #include "../Security.h"
 #include "../Catalog.h"
+#include "../TickMsg.h"
+#include "../util/Checkpoint.h"
 #include "ItemState.h"
 
 namespace sibyl
@@ -49,6 +51,12 @@ public:
     // to be called by Trader
     void SetStateLogPaths(CSTR &state, CSTR &log);
     int  ApplyMsgIn      (char *msg); // this destroys msg during parsing; returns non-0 to signal termination
+    int  ApplyState      (const StateMsg &state); // structured equivalent of ApplyMsgIn (msg_in.log not written)
+    void ResetDay        (); // empty portfolio before the first msg of a day
+    
+    // State not carried by server messages (reference balances of the day; see Catalog::UpdateRefInitBal)
+    void SaveCheckpoint(Checkpoint &ckpt) const;
+    int  LoadCheckpoint(Checkpoint &ckpt); // returns non-0 for invalid data
 private:
     std::vector<ItemState> vecState;
     
@@ -56,6 +64,14 @@ private:
     STR pathLog;
     
     void WriteState(); // writes only if state path was set
+    int  OnMsgIn   (); // common to ApplyMsgIn & ApplyState after updating entries
+    
+    // entry of code, inserted as KOSPI if not found (see Reallocate)
+    ItemTable<ItemPf>::iterator FindOrInsert(CSTR &code);
+    
+    // reallocate a KOSPI entry as TItemDerived on first run (ELW, ETF)
+    template <class TItemDerived>
+    TItemDerived& Reallocate(std::unique_ptr<ItemPf> &ptr);
     
     std::ofstream logMsgIn;  // full state msg
     std::ofstream logVecOut; // t, pr, qr, tbr
@@ -63,6 +79,20 @@ private:
     char bufLine[1 << 10];
 };
 
+template <class TItemDerived>
+TItemDerived& Portfolio::Reallocate(std::unique_ptr<ItemPf> &ptr)
+{
+    if (ptr->Type() == SecType::KOSPI)
+    {
+        KOSPI<ItemPf> temp = *static_cast<KOSPI<ItemPf>*>(ptr.get()); // store copy
+        ptr.reset(new TItemDerived);
+        ptr->pr   = temp.pr;
+        ptr->qr   = temp.qr;
+        ptr->tbr  = temp.tbr;
+    }
+    return *static_cast<TItemDerived*>(ptr.get());
+}
+
 }
 
 #endif  /* SIBYL_CLIENT_PORTFOLIO_H_ */
\ No newline at end of file
@@ -21,6 +21,7 @@
 #include <numeric>
 
 #include "../ReqType.h"
+#include "../util/FileLimit.h"
 
 namespace sibyl
 {
@@ -32,7 +33,7 @@ void RewardModel::SetParams(double timeConst_, double rhoWeight_, double rhoInit
     verify(timeConst_ > 0.0 && rhoWeight_ >= 0.0 && rhoInit_ >= 0.0);
     timeConst = timeConst_;
     rhoWeight = rhoWeight_;
-    rho = rhoInit_;
+    rho = rhoInit = rhoInit_;
     exclusiveBuy = exclusiveBuy_;
     sellBeforeEnd = sellBeforeEnd_;
     earlyQuit = earlyQuit_;
@@ -96,20 +97,99 @@ void RewardModel::SetStateLogPaths(CSTR &state, CSTR &log)
     }
 }
 
+void RewardModel::ResetDay()
+{
+    // codes may differ from the previous day (see InitCodes); G logs are rewritten
+    rewards   .clear();
+    mfRef     .clear();
+    mfLogRef  .clear();
+    vecRewards.clear();
+    isFirstTick = true;
+    
+    rho        = rhoInit;
+    exitMarket = false;
+    vec_rate_r.clear();
+    idx_rate_r = 0;
+    
+    nTickRef = nTickRefSkip = 0;
+    resumed  = false;
+}
+
+void RewardModel::SaveCheckpoint(Checkpoint &ckpt) const
+{
+    ckpt.Put(rho);
+    ckpt.Put(exitMarket);
+    ckpt.Put(vec_rate_r);
+    ckpt.Put((uint64_t)idx_rate_r);
+    ckpt.Put((uint64_t)nTickRef);
+    ckpt.Put((uint64_t)rewards.size());
+    for (std::size_t id = 0; id < rewards.size(); id++)
+    {
+        ckpt.Put(pPortfolio->items.Code((ItemId)id));
+        ckpt.Put(rewards[id]);
+    }
+}
+
+int RewardModel::LoadCheckpoint(Checkpoint &ckpt, int timeSaved)
+{
+    verify(pPortfolio != nullptr && isFirstTick == true); // before GetRefData or GetRewardVec
+    
+    double rho_(0.0);
+    bool exitMarket_(false);
+    std::vector<double> vec_rate_r_;
+    uint64_t idx_rate_r_(0), nTickRef_(0), nRewards(0);
+    ckpt.Get(rho_);
+    ckpt.Get(exitMarket_);
+    ckpt.Get(vec_rate_r_);
+    ckpt.Get(idx_rate_r_);
+    ckpt.Get(nTickRef_);
+    ckpt.Get(nRewards);
+    std::vector<Reward> rewards_(pPortfolio->items.size());
+    for (uint64_t iR = 0; iR < nRewards && ckpt.Good() == true; iR++)
+    {
+        STR code;
+        Reward r;
+        ckpt.Get(code);
+        ckpt.Get(r);
+        ItemId id = pPortfolio->items.Id(code);
+        if (id != kNoItem) rewards_[id] = r; // codes of today only
+    }
+    if (ckpt.Good() == false || (vec_rate_r_.empty() == false && idx_rate_r_ >= vec_rate_r_.size())) return -1;
+    
+    rho        = rho_;
+    exitMarket = exitMarket_;
+    vec_rate_r.swap(vec_rate_r_);
+    idx_rate_r = (std::size_t)idx_rate_r_;
+    rewards.swap(rewards_); // the rest stay as added by InitCodes
+    
+    // ref data is read a record per tick in bounds; skip the ticks missed while down as well
+    nTickRefSkip = (std::size_t)nTickRef_;
+    for (int t = timeSaved + kTimeRates::secPerTick; t < pPortfolio->time; t += kTimeRates::secPerTick)
+        if (t >= kTimeBounds::init && t < kTimeBounds::stop) nTickRefSkip++;
+    nTickRef = nTickRefSkip;
+    resumed  = true;
+    return 0;
+}
+
 void RewardModel::SetRefPath(CSTR &path)
 {
     pathData = path;
     if ('/' != pathData[pathData.size() - 1]) pathData.append("/");
 }
 
+void RewardModel::SetRefDay(CSTR &day)
+{
+    verify(pathData.empty() == false);
+    STR path(pathData, 0, pathData.size() - 1); // trailing '/'
+    auto posSlash = path.find_last_of('/');
+    SetRefPath((posSlash == std::string::npos ? STR() : path.substr(0, posSlash + 1)) + day);
+}
+
 void RewardModel::InitCodes()
 {
     verify(pPortfolio != nullptr);
-    for (const auto &code_pItem : pPortfolio->items)
-    {
-        auto it_bool = rewards.insert(std::make_pair(code_pItem.first, Reward()));
-        verify(it_bool.second == true);
-    }
+    RaiseFileLimit(); // .ref files of each item are kept open (ref data & G logs)
+    rewards.resize(pPortfolio->items.size()); // entries restored by LoadCheckpoint kept
     InitGLogs();
 }
 
@@ -117,47 +197,46 @@ void RewardModel::InitGLogs()
 {
     if (pathLog.empty() == false)
     {
-        for (const auto &code_reward : rewards)
+        for (const auto &code_pItem : pPortfolio->items)
         {
-            STR filename = pathLog + code_reward.first + ".ref";
-            FILE *pf = fopen(filename.c_str(), "wb");
+            STR filename = pathLog + code_pItem.first + ".ref";
+            FILE *pf = fopen(filename.c_str(), (resumed == true ? "ab" : "wb"));
             verify(pf != nullptr); // kill, as fclose(nullptr) is a crash anyways
-            auto it_bool = mfLogRef.insert(std::make_pair(code_reward.first, std::unique_ptr<FILE, int(*)(FILE*)>(pf, fclose)));
-            verify(it_bool.second == true);
+            mfLogRef.push_back(std::unique_ptr<FILE, int(*)(FILE*)>(pf, fclose));
         }
     }
 }
 
 void RewardModel::GetRefData()
 {
+    const std::ptrdiff_t dimRef = 42;
     if (isFirstTick == true)
     {
         InitCodes(); 
-        for (const auto &code_reward : rewards)
+        for (const auto &code_pItem : pPortfolio->items)
         {
-            STR filename = pathData + code_reward.first + STR(".ref");
+            STR filename = pathData + code_pItem.first + STR(".ref");
             FILE *pf = fopen(filename.c_str(), "rb");
             if (pf == nullptr)
             {
                 std::cerr << filename << " not found" << std::endl;
                 return;
             }
-            auto it_bool = mfRef.insert(std::make_pair(code_reward.first, std::unique_ptr<FILE, int(*)(FILE*)>(pf, fclose)));
-            verify(it_bool.second == true);
+            if (nTickRefSkip > 0) fseek(pf, (long)(nTickRefSkip * dimRef * sizeof(float)), SEEK_SET);
+            mfRef.push_back(std::unique_ptr<FILE, int(*)(FILE*)>(pf, fclose));
         }
         isFirstTick = false;
     }
     if ((pPortfolio->time >= kTimeBounds::init) && (pPortfolio->time < kTimeBounds::stop))
     {
-        const std::ptrdiff_t dimRef = 42;
         float bufRef[dimRef];
+        nTickRef++;
 
-        for (auto &code_reward : rewards)
+        verify(mfRef.size() == rewards.size());
+        for (std::size_t id = 0; id < rewards.size(); id++)
         {
-            auto &r = code_reward.second;
-            auto imf = mfRef.find(code_reward.first);
-            verify(imf != std::end(mfRef));
-            std::size_t szRead = fread(bufRef, sizeof(float), dimRef, &*(imf->second));
+            auto &r = rewards[id];
+            std::size_t szRead = fread(bufRef, sizeof(float), dimRef, &*mfRef[id]);
             if (szRead == dimRef)
             {
                 r.G0.s = bufRef[0];
@@ -174,13 +253,13 @@ void RewardModel::GetRefData()
             else
                 break;
             
-            auto &i = *(pPortfolio->items.find(code_reward.first)->second);
+            auto &i = pPortfolio->items.At((ItemId)id);
             if (i.Type() == SecType::KOSPI)
             {
                 for (int iB = 0; iB < (int)dimRef; iB++)
                 {
                     if ((std::abs(bufRef[iB]) > 1.0f) && (std::abs(bufRef[iB]) < 100.0f)) {
-                        sprintf(bufLine, "Warning: [%5d] {%s} G = %f too large (iB %d)", pPortfolio->time.load(), code_reward.first.c_str(), bufRef[iB], iB);
+                        sprintf(bufLine, "Warning: [%5d] {%s} G = %f too large (iB %d)", pPortfolio->time.load(), pPortfolio->items.Code((ItemId)id).c_str(), bufRef[iB], iB);
                         std::cerr << bufLine << std::endl;
                     }
                 }
@@ -204,38 +283,29 @@ std::vector<Reward>& RewardModel::GetRewardVec()
 void RewardModel::SetRewardVec(const std::vector<Reward> &vec)
 {
     verify(rewards.size() == vec.size());
-    std::size_t codeIdx = 0;
-    for (auto &code_reward : rewards)
-    {
-        code_reward.second = vec[codeIdx];
-        codeIdx++; 
-    }
+    std::copy(std::begin(vec), std::end(vec), std::begin(rewards));
 }
 
-// shorthand for Catalog.map's iterator
-template <class TItem>
-using it_map_t = typename std::map<STR, std::unique_ptr<TItem>>::iterator; 
-
 class GTck {
 public:
     FLOAT G;
-    it_map_t<ItemPf> iM;
+    ItemId id;         // of Catalog.items
     int tick;          // 0-based index of price (-1: Gs0/Gb0, and so on)
-    GTck() : G(0.0f), tick(0) {}
+    GTck() : G(0.0f), id(kNoItem), tick(0) {}
 };
 
 class GReq {
 public:
     FLOAT G;           // GTck * price * quant * (1 +- fee/tax)
     ReqType type;    
-    it_map_t<ItemPf> iM;
+    ItemId id;         // of Catalog.items
     INT price;         // actual price
     INT quant;         // actual quantity
     INT modprice;      // actual mod price
-    GReq() : G(0.0f), type(ReqType::null), price(0), quant(0), modprice(0) {}
+    GReq() : G(0.0f), type(ReqType::null), id(kNoItem), price(0), quant(0), modprice(0) {}
 };
 
-CSTR& RewardModel::BuildMsgOut()
+const std::vector<ReqMsg>& RewardModel::BuildReqs()
 // Sell orders
 // 1. For each code, define PGi, where i spans all (0~10th) prices with Gs > 0
 // 2. EG=sum(PGi*PGi)/sum(PGi) (EG=0 if sum(PGi)==0)
@@ -251,11 +321,12 @@ CSTR& RewardModel::BuildMsgOut()
 // Put cancel and new order in buffers first and match cancel->new order pairs to replace with modify orders 
 {
     verify(timeConst > 0.0);
-    msg.clear();
+    reqs.clear();
     
     const int   time  = pPortfolio->time; // std::atomic_int time
           auto  bal   = pPortfolio->bal;
           auto &items = pPortfolio->items;
+    verify(rewards.size() == items.size()); // codes do not change during a day
     
     if (pathState.empty() == false) {
         WritePosGCnt();
@@ -291,9 +362,8 @@ CSTR& RewardModel::BuildMsgOut()
     // convert b0 -> b1, remove auto cancel at b1 (leave explicit cb1 signal)
     if (patientB0 == true)
     {
-        for (auto &code_reward : rewards)
+        for (auto &r : rewards)
         {
-            auto &r = code_reward.second;
             if (r.G0.b > 0.f)
             {
                 r.G[0].b = r.G0.b;
@@ -307,9 +377,8 @@ CSTR& RewardModel::BuildMsgOut()
     // convert s0 -> s1, remove auto cancel at s1 (leave explicit cs1 signal)
     if (patientS0 == true)
     {
-        for (auto &code_reward : rewards)
+        for (auto &r : rewards)
         {
-            auto &r = code_reward.second;
             if (r.G0.s > 0.f)
             {
                 r.G[0].s = r.G0.s;
@@ -323,9 +392,8 @@ CSTR& RewardModel::BuildMsgOut()
     // Stop buying anything between 20 minutes before stop time and stop time
     if (time >= kTimeBounds::stop - 1200 && time < kTimeBounds::stop)
     {
-        for (auto &code_reward : rewards)
+        for (auto &r : rewards)
         {
-            auto &r = code_reward.second;
             r.G0.b    = -100.0f;
             for (auto &gn : r.G)
             {
@@ -338,9 +406,8 @@ CSTR& RewardModel::BuildMsgOut()
     // // Don't do anything between 14:50 and 15:15
     // if (time >= kTimeBounds::stop && time < timeSellAll)
     // {
-    //     for (auto &code_reward : rewards)
+    //     for (auto &r : rewards)
     //     {
-    //         auto &r = code_reward.second;
     //         r.G0.b    = -100.0f;
     //         r.G0.s    = -100.0f;
     //         for (auto &gn : r.G)
@@ -360,9 +427,8 @@ CSTR& RewardModel::BuildMsgOut()
     // Early quit mechanism
     if (exitMarket == true)
     {
-        for (auto &code_reward : rewards)
+        for (auto &r : rewards)
         {
-            auto &r = code_reward.second;
             r.G0.b    = -100.0f;
             r.G0.s    =  100.0f;
             for (auto &gn : r.G)
@@ -385,9 +451,8 @@ CSTR& RewardModel::BuildMsgOut()
                 else       { b = b - a; a = 0.0f; }
             } 
         };
-        for (auto &code_reward : rewards)
+        for (auto &r : rewards)
         {
-            auto &r = code_reward.second;
             Annihilate(r.G0.b, r.G0.s);
             for (auto &gn : r.G)
             {
@@ -401,11 +466,10 @@ CSTR& RewardModel::BuildMsgOut()
         std::vector<GReq> oReq; // Buf for s, ms, b, mb 
 
         // Sell reqs
-        for (auto iM = std::begin(items); iM != std::end(items); iM++)
+        for (ItemId id = 0; id < (ItemId)items.size(); id++)
         {
-            const auto &code_pItem = *iM;
-            const auto &i = *code_pItem.second;
-            const auto &r = rewards.find(code_pItem.first)->second;
+            const auto &i = items.At(id);
+            const auto &r = rewards[id];
 
             // Register positive Gs in intermediate buf and calculate EG 
             std::vector<GTck> vPosGs;
@@ -455,7 +519,7 @@ CSTR& RewardModel::BuildMsgOut()
                     {
                         cntAvail    += o.q;
                         reqGcs.type  = ReqType::cs;
-                        reqGcs.iM    = iM;
+                        reqGcs.id    = id;
                         reqGcs.price = o.p;
                         reqGcs.quant = o.q;
                         cReq.push_back(reqGcs);
@@ -484,7 +548,7 @@ CSTR& RewardModel::BuildMsgOut()
                     else
                         reqGs.G = (FLOAT)(r.G.at((std::size_t)req.tick).s * i.Ps0() * reqGs.quant * (1.0 - i.dSF()));
                     reqGs.type = ReqType::s;
-                    reqGs.iM   = iM;
+                    reqGs.id   = id;
                     oReq.push_back(reqGs);
                     if (cntLeft <= 0) break;
                 }
@@ -497,18 +561,17 @@ CSTR& RewardModel::BuildMsgOut()
         GTck posGb;
         double sumPosGb  = 0.0;
         double sumPosGb2 = 0.0;
-        for (auto iM = std::begin(items); iM != std::end(items); iM++)
+        for (ItemId id = 0; id < (ItemId)items.size(); id++)
         {
-            const auto &code_pItem = *iM;
-            // const auto &i = *code_pItem.second;
-            const auto &r = rewards.find(code_pItem.first)->second;
+            // const auto &i = items.At(id);
+            const auto &r = rewards[id];
             
             bool doG0b = true;
             for (auto iG = std::begin(r.G); iG != std::end(r.G);) {
                 if ((posGb.G   = (doG0b == true ? r.G0.b : iG->b)) > 0.0f)
                 {
                     posGb.tick = (doG0b == true ? -1 : (int)(iG - std::begin(r.G)));
-                    posGb.iM   = iM;
+                    posGb.id   = id;
                     sumPosGb  += posGb.G;
                     sumPosGb2 += posGb.G * posGb.G;
                     vPosGb.push_back(posGb);
@@ -528,11 +591,10 @@ CSTR& RewardModel::BuildMsgOut()
         // Register cb reqs in cReq and add canceled bal
         GReq reqGcb;
         INT64 balAvail = bal;
-        for (auto iM = std::begin(items); iM != std::end(items); iM++)
+        for (ItemId id = 0; id < (ItemId)items.size(); id++)
         {
-            const auto &code_pItem = *iM;
-            const auto &i = *code_pItem.second;
-            const auto &r = rewards.find(code_pItem.first)->second;
+            const auto &i = items.At(id);
+            const auto &r = rewards[id];
             
             for (const auto &price_Order : i.ord)
             {
@@ -561,7 +623,7 @@ CSTR& RewardModel::BuildMsgOut()
                         INT64 delta = (INT64)o.p * o.q;
                         balAvail += delta + i.BFee(delta);
                         reqGcb.type = ReqType::cb;
-                        reqGcb.iM   = iM;
+                        reqGcb.id   = id;
                         reqGcb.price = o.p;
                         reqGcb.quant = o.q;
                         cReq.push_back(reqGcb);
@@ -575,10 +637,10 @@ CSTR& RewardModel::BuildMsgOut()
         INT64 balLeft = balAvail - (INT64)std::round(balAvail * rhoWeight * lastRho / sumPosGb); // invest in unused fund first
         for (const auto &req : vPosGb)
         {
-            auto &i = *(req.iM->second); // reference to ItemPf
+            auto &i = items.At(req.id); // reference to ItemPf
             if (exclusiveBuy == false || i.cnt == 0)
             {
-                const auto &r = rewards.find(req.iM->first)->second;
+                const auto &r = rewards[req.id];
                 
                 reqGb.price = i.Tck2P(req.tick, OrdType::buy);
                 INT64 balDist = (INT64)std::round((double)balAvail * req.G / sumPosGb);
@@ -601,7 +663,7 @@ CSTR& RewardModel::BuildMsgOut()
                     if (req.tick == -1) reqGb.G = FLOAT(r.G0.b                          * reqGb.price * reqGb.quant * (1.0 + i.dBF()));
                     else                reqGb.G = FLOAT(r.G.at((std::size_t)req.tick).b * reqGb.price * reqGb.quant * (1.0 + i.dBF()));
                     reqGb.type = ReqType::b;
-                    reqGb.iM   = req.iM;
+                    reqGb.id   = req.id;
                     oReq.push_back(reqGb);
                     if (balLeft <= 0) break;
                 }
@@ -616,7 +678,7 @@ CSTR& RewardModel::BuildMsgOut()
         bool bBreak = false;
         for (const auto &req : cReq)
         {
-            if (true == (bBreak = CatReq((req.type == ReqType::cb ? "cb" : "cs"), req.iM->first, req.price, req.quant))) 
+            if (true == (bBreak = CatReq(req.type, items.Code(req.id), req.price, req.quant))) 
                 break;
         }
         if (bBreak == false)
@@ -624,23 +686,40 @@ CSTR& RewardModel::BuildMsgOut()
             for (const auto &req : oReq)
             {
                 if      ( ((req.type == ReqType::b ) || (req.type == ReqType::s )) &&
-                     (true == (bBreak = CatReq((req.type == ReqType::b  ? "b"  : "s" ), req.iM->first, req.price, req.quant              ))) )
+                     (true == (bBreak = CatReq(req.type, items.Code(req.id), req.price, req.quant              ))) )
                     break;
                 else if ( ((req.type == ReqType::mb) || (req.type == ReqType::ms)) &&
-                     (true == (bBreak = CatReq((req.type == ReqType::mb ? "mb" : "ms"), req.iM->first, req.price, req.quant, req.modprice))) )
+                     (true == (bBreak = CatReq(req.type, items.Code(req.id), req.price, req.quant, req.modprice))) )
                     break;
             }            
         }
     }
 
     // If < 5 min, process rho as usual, but don't send any msg (unstable data)
-    if (time < (5 * 60)) msg.clear();
-    
-    if (msg.size() == 0) msg.append("\n");  // should have '\n' even for empty msg's
+    if (time < (5 * 60)) reqs.clear();
     
     if (logMsgOut.is_open() == true) // log raw output to server
-        logMsgOut << "[t=" << time << "]\n" << msg;
+        logMsgOut << "[t=" << time << "]\n" << FormatReqs();
         
+    return reqs;
+}
+
+CSTR& RewardModel::BuildMsgOut()
+{
+    BuildReqs();
+    return FormatReqs();
+}
+
+CSTR& RewardModel::FormatReqs()
+{
+    msg.clear();
+    for (const auto &r : reqs)
+    {
+        if (r.mp > 0) sprintf(bufLine, "%s %s %d %d %d\n", ReqWord(r.type), r.code.c_str(), r.p, r.q, r.mp);
+        else          sprintf(bufLine, "%s %s %d %d\n"   , ReqWord(r.type), r.code.c_str(), r.p, r.q);
+        msg.append(bufLine);
+    }
+    if (msg.size() == 0) msg.append("\n");  // should have '\n' even for empty msg's
     return msg;
 }
 
@@ -652,9 +731,8 @@ void RewardModel::WritePosGCnt()
     filename.append("posGCnt.log");
     
     static std::array<int, idx::szTb + 2> posGCnt = {}; // 0-fill
-    for (const auto &code_reward : rewards)
+    for (const auto &r : rewards)
     {
-        const auto &r = code_reward.second;
         if (r.G0.s > 0.0f) posGCnt[idx::szTb + 0]++;
         if (r.G0.b > 0.0f) posGCnt[idx::szTb + 1]++;
         std::ptrdiff_t tck = 0;
@@ -689,11 +767,11 @@ void RewardModel::WriteGLogs()
         (pPortfolio->time >= kTimeBounds::init) && (pPortfolio->time < kTimeBounds::stop))
     {
         logVecIn << "[t=" << pPortfolio->time << "]\n";
-        for (const auto &code_reward : rewards)
+        for (std::size_t id = 0; id < rewards.size(); id++)
         {
             // text log
-            const auto &r = code_reward.second;
-            sprintf(bufLine, "{%s}\n"                 , code_reward.first.c_str()); logVecIn << bufLine;
+            const auto &r = rewards[id];
+            sprintf(bufLine, "{%s}\n"                 , pPortfolio->items.Code((ItemId)id).c_str()); logVecIn << bufLine;
             sprintf(bufLine, "Gs0\t%+.3e\n"           , r.G0.s);                    logVecIn << bufLine;
             sprintf(bufLine, "Gb0\t%+.3e\n"           , r.G0.b);                    logVecIn << bufLine;
             sprintf(bufLine, "     \tGs/b\t\tGcs/cb\n");                            logVecIn << bufLine;
@@ -709,9 +787,8 @@ void RewardModel::WriteGLogs()
             // binary log
             const std::size_t szDim = 42;
             float data[szDim];
-            auto imf = mfLogRef.find(code_reward.first);
-            verify(imf != std::end(mfLogRef));
-            FILE *pf = &*(imf->second);
+            verify(id < mfLogRef.size());
+            FILE *pf = &*mfLogRef[id];
             data[0] = r.G0.s;
             data[1] = r.G0.b;
             
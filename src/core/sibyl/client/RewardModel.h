@@ -18,7 +18,6 @@
 #define SIBYL_CLIENT_REWARDMODEL_H_
 
 #include <vector>
-#include <map>
 #include <fstream>
 #include <cstring>
 
@@ -40,6 +39,7 @@ public:
 
     // for ref
     void SetRefPath(CSTR &path);
+    void SetRefDay (CSTR &day); // ref path of another day, as a sibling of the current ref path
     void GetRefData();
     
     // for rnn 
@@ -48,15 +48,20 @@ public:
 
     // virtuals from Model; to be called by Trader
     void  SetStateLogPaths(CSTR &state, CSTR &log);
+    void  ResetDay        ();
     CSTR& BuildMsgOut     ();
+    const std::vector<ReqMsg>& BuildReqs();
+    void  SaveCheckpoint  (Checkpoint &ckpt) const;
+    int   LoadCheckpoint  (Checkpoint &ckpt, int timeSaved);
     
-    RewardModel() : timeConst(0.0), rhoWeight(0.0), rho(0.0),
+    RewardModel() : timeConst(0.0), rhoWeight(0.0), rho(0.0), rhoInit(0.0),
                     exclusiveBuy(false), sellBeforeEnd(false), earlyQuit(false),
                     patientB0(false), patientS0(false),
-                    exitMarket(false), idx_rate_r(0), isFirstTick(true) {}
+                    exitMarket(false), idx_rate_r(0), nTickRef(0), nTickRefSkip(0), resumed(false),
+                    isFirstTick(true) {}
 private:
     // parameters
-    double timeConst, rhoWeight, rho;
+    double timeConst, rhoWeight, rho, rhoInit;
     bool   exclusiveBuy, sellBeforeEnd, earlyQuit, patientB0, patientS0;
 
     // early quit mechanism
@@ -64,12 +69,16 @@ private:
     std::vector<double> vec_rate_r;
     std::size_t         idx_rate_r;
 
-    std::map<STR, Reward> rewards;
+    // by ItemId of the portfolio's items (whose codes do not change during a day)
+    std::vector<Reward> rewards;
     void InitCodes(); // create rewards entries with codes from first msg
     
     // for ref
     STR pathData;
-    std::map<STR, std::unique_ptr<FILE, int(*)(FILE*)>> mfRef; // for binary log of G values
+    std::vector<std::unique_ptr<FILE, int(*)(FILE*)>> mfRef; // for binary log of G values; by ItemId
+    std::size_t nTickRef;     // ticks read from mfRef so far
+    std::size_t nTickRefSkip; // to skip when opening mfRef (resumed after a restart)
+    bool        resumed;      // G logs appended to rather than rewritten
 
     // for rnn
     std::vector<Reward> vecRewards;
@@ -85,19 +94,19 @@ private:
     
     std::ofstream logMsgOut; // req msg
     std::ofstream logVecIn;  // G
-    std::map<STR, std::unique_ptr<FILE, int(*)(FILE*)>> mfLogRef; // for binary log of G values
+    std::vector<std::unique_ptr<FILE, int(*)(FILE*)>> mfLogRef; // for binary log of G values; by ItemId
     
     int nMsgCurTick;
     char bufLine[1 << 10];
-    bool CatReq(const char *pcMsgType, CSTR &code, INT price, INT quant, INT modprice = 0)
+    bool CatReq(ReqType type, CSTR &code, INT price, INT quant, INT modprice = 0)
     {
-        if (modprice > 0) sprintf(bufLine, "%s %s %d %d %d\n", pcMsgType, code.c_str(), price, quant, modprice);
-        else              sprintf(bufLine, "%s %s %d %d\n"   , pcMsgType, code.c_str(), price, quant);
-        msg.append(bufLine);
+        reqs.push_back(ReqMsg(type, code, price, quant, (modprice > 0 ? modprice : 0)));
         if (kTimeRates::reqPerTick == ++nMsgCurTick)
             return true;
         return false;        
     }
+    std::vector<ReqMsg> reqs;
+    CSTR& FormatReqs(); // reqs in text (see ReqType.h)
     STR msg;
 };
 
@@ -0,0 +1,133 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "StateLog.h"
+
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <iostream>
+
+namespace sibyl
+{
+
+namespace
+{
+    // ItemState but code, in a trivially copyable layout without padding
+    struct Fixed {
+        int32_t time;
+        FLOAT   pr;
+        INT64   qr;
+        std::array<PQ, idx::szTb> tbr;
+        int32_t isELW, isETF;
+        int32_t iCP, expiry;
+        FLOAT   kospi200;
+        std::array<FLOAT, ELW<Security<PQ>>::szTh> thr;
+        FLOAT   devNAV;
+    };
+    static_assert(sizeof(Fixed) == 8 + 8 + sizeof(Fixed::tbr) + 16 + 4 + sizeof(Fixed::thr) + 4, "StateLog: Fixed padded");
+}
+
+int StateLog::Open(CSTR &path, bool append)
+{
+    Close();
+    pf = fopen(path.c_str(), (append == true ? "ab" : "wb"));
+    if (pf == nullptr)
+    {
+        std::cerr << "StateLog: " << path << " not writable" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+void StateLog::Close()
+{
+    if (pf != nullptr) fclose(pf);
+    pf = nullptr;
+}
+
+void StateLog::Write(const std::vector<ItemState> &vecState)
+{
+    if (pf == nullptr) return;
+    buf.clear();
+    auto Append = [&](const void *src, std::size_t len) {
+        buf.insert(std::end(buf), static_cast<const char*>(src), static_cast<const char*>(src) + len);
+    };
+    uint32_t nItems = (uint32_t)vecState.size();
+    Append(&nItems, sizeof(nItems));
+    for (const auto &state : vecState)
+    {
+        uint8_t len = (uint8_t)std::min<std::size_t>(state.code.size(), 255);
+        Append(&len, sizeof(len));
+        Append(state.code.data(), len);
+        Fixed f;
+        f.time     = state.time;
+        f.pr       = state.pr;
+        f.qr       = state.qr;
+        f.tbr      = state.tbr;
+        f.isELW    = state.isELW;
+        f.isETF    = state.isETF;
+        f.iCP      = state.iCP;
+        f.expiry   = state.expiry;
+        f.kospi200 = state.kospi200;
+        f.thr      = state.thr;
+        f.devNAV   = state.devNAV;
+        Append(&f, sizeof(f));
+    }
+    fwrite(buf.data(), 1, buf.size(), pf);
+    fflush(pf);
+}
+
+long StateLog::Read(CSTR &path, const std::function<void(const std::vector<ItemState>&)> &onFrame)
+{
+    FILE *pfRead = fopen(path.c_str(), "rb");
+    if (pfRead == nullptr) return -1;
+    
+    std::vector<ItemState> vecState;
+    long nFrames = 0;
+    for (uint32_t nItems; 1 == fread(&nItems, sizeof(nItems), 1, pfRead);)
+    {
+        vecState.resize(nItems);
+        bool whole = true;
+        for (auto &state : vecState)
+        {
+            uint8_t len;
+            char code[256];
+            Fixed f;
+            if (1 != fread(&len, sizeof(len), 1, pfRead) || len != fread(code, 1, len, pfRead) ||
+                1 != fread(&f, sizeof(f), 1, pfRead)) { whole = false; break; }
+            state.code.assign(code, len);
+            state.time     = f.time;
+            state.pr       = f.pr;
+            state.qr       = f.qr;
+            state.tbr      = f.tbr;
+            state.isELW    = (f.isELW != 0);
+            state.isETF    = (f.isETF != 0);
+            state.iCP      = f.iCP;
+            state.expiry   = f.expiry;
+            state.kospi200 = f.kospi200;
+            state.thr      = f.thr;
+            state.devNAV   = f.devNAV;
+        }
+        if (whole == false) break;
+        onFrame(vecState);
+        nFrames++;
+    }
+    fclose(pfRead);
+    return nFrames;
+}
+
+}
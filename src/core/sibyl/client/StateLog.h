@@ -0,0 +1,55 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_CLIENT_STATELOG_H_
+#define SIBYL_CLIENT_STATELOG_H_
+
+#include <cstdio>
+#include <vector>
+#include <functional>
+
+#include "ItemState.h"
+
+namespace sibyl
+{
+
+// Binary log of the state vectors given to a model in a day (see Portfolio::GetStateVec), a frame per tick
+// A model with memory of its own (e.g., reshaper per item, RNN activations) is rebuilt after a restart
+// (see Trader::Resumed) by running it again over the frames logged before; flushed every frame for that reason
+// Frame: # of items (uint32) | per item, code (uint8 length + chars) & fixed fields; host byte order
+class StateLog
+{
+public:
+    int  Open (CSTR &path, bool append); // returns non-0 to signal error
+    void Close();
+    void Write(const std::vector<ItemState> &vecState);
+    
+    // Call onFrame for each frame of the log at path in order (a frame cut short at the end is ignored)
+    // Returns the number of frames read, -1 if inaccessible
+    static long Read(CSTR &path, const std::function<void(const std::vector<ItemState>&)> &onFrame);
+    
+    StateLog() : pf(nullptr) {}
+    ~StateLog() { Close(); }
+    StateLog           (const StateLog&) = delete;
+    StateLog& operator=(const StateLog&) = delete;
+private:
+    FILE *pf;
+    std::vector<char> buf;
+};
+
+}
+
+#endif /* SIBYL_CLIENT_STATELOG_H_ */
@@ -0,0 +1,76 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Trader.h"
+
+#include <iostream>
+
+namespace sibyl
+{
+
+constexpr uint32_t Trader::kCkptMagic;
+
+// checkpoint.bin: magic "SBCK" | day | time | Portfolio | Model
+void Trader::EndTick()
+{
+    nTick++;
+    if (period <= 0 || pathCkpt.empty() == true || nTick % period != 0) return;
+    ckpt.Clear();
+    ckpt.Put(kCkptMagic);
+    ckpt.Put(day);
+    ckpt.Put((int32_t)portfolio.time);
+    portfolio.SaveCheckpoint(ckpt);
+    model    .SaveCheckpoint(ckpt);
+    if (0 != ckpt.Save(pathCkpt))
+        std::cerr << "Trader: checkpoint not writable at " << pathCkpt << std::endl;
+}
+
+void Trader::Resume()
+{
+    resume = false; // first tick only
+    if (pathCkpt.empty() == true || 0 != ckpt.Load(pathCkpt)) return;
+    if (day.empty() == true)
+    {
+        std::cerr << "Trader: day unknown; checkpoint not restored" << std::endl;
+        return;
+    }
+    
+    uint32_t magic(0);
+    STR      daySaved;
+    int32_t  timeSaved(kTimeBounds::null);
+    ckpt.Get(magic);
+    ckpt.Get(daySaved);
+    ckpt.Get(timeSaved);
+    if (ckpt.Good() == false || magic != kCkptMagic)
+    {
+        std::cerr << "Trader: invalid checkpoint at " << pathCkpt << std::endl;
+        return;
+    }
+    if (daySaved != day || timeSaved > portfolio.time) // another day, or not a restart during the day
+    {
+        std::cerr << "Trader: checkpoint not of this day; started afresh" << std::endl;
+        return;
+    }
+    if (0 != portfolio.LoadCheckpoint(ckpt) || 0 != model.LoadCheckpoint(ckpt, timeSaved))
+    {
+        std::cerr << "Trader: invalid checkpoint at " << pathCkpt << std::endl;
+        return;
+    }
+    resumed = true;
+    std::cout << "Trader: resumed from checkpoint at t=" << timeSaved << " (now t=" << portfolio.time << ")" << std::endl;
+}
+
+}
@@ -19,28 +19,62 @@
 
 #include "Portfolio.h"
 #include "RewardModel.h"
+#include "../util/TickLatency.h"
 
 namespace sibyl
 {
 
-// Mediates interfaces for NetClient, Portfolio, Model
+// Mediates interfaces for NetClient (or DirectLink), Portfolio, Model
 // May be expanded if multiple Models are present
 class Trader
 {
 public:
     Portfolio   portfolio;
     RewardModel model;
+    TickLatency latency; // client side phases, fed by NetClient (or DirectLink), the methods below & the program
 
     void SetStateLogPaths(CSTR &state, CSTR &log) {
         portfolio.SetStateLogPaths(state, log);
         model    .SetStateLogPaths(state, log);
+        pathCkpt = (state.empty() == true ? STR() : state + (state.back() == '/' ? "" : "/") + kCkptName);
     }
     
+    // Save the state not carried by server messages (see Portfolio::SaveCheckpoint, Model::SaveCheckpoint)
+    // to <state path>/checkpoint.bin every period ticks (0: never); requires a state path
+    // With resume, restore it at the first tick if saved earlier on the same day, so that a restarted client
+    // trades on from that tick (NetServer sends every new connection a full state, preceded by the day name if known)
+    // Never restored if the day is unknown, as a checkpoint of another day cannot be told apart
+    void SetCheckpoint(int period_, bool resume_) { period = period_; resume = resume_; }
+    bool Resumed() const { return resumed; } // checkpoint restored at the first tick of the day
+    constexpr static int kCkptPeriod = 6;     // ticks (1 min)
+    
     // called by NetClient
-    int   ApplyMsgIn (char *msg) { return portfolio.ApplyMsgIn(msg); }
-    CSTR& BuildMsgOut()          { return model.BuildMsgOut();       };
+    int   ApplyMsgIn (char *msg) { TickLatency::Scope scope(latency, TickPhase::applyMsg ); return OnApplied(portfolio.ApplyMsgIn(msg)); }
+    CSTR& BuildMsgOut()          { TickLatency::Scope scope(latency, TickPhase::buildReqs); return model.BuildMsgOut();                  }
+    void  EndTick    ();         // after the reply is sent (off the round trip); saves a checkpoint every period ticks
+    
+    // called by NetClient & DirectLink at a day boundary (multi-day simulation)
+    void  NewDay(CSTR &name) { day = name; portfolio.ResetDay(); model.ResetDay(); nTick = 0; resumed = false; }
+    CSTR& Day   () const     { return day; } // empty until a day message (the server does not know the day)
+    
+    // called by DirectLink
+    int                        ApplyState(const StateMsg &state) { TickLatency::Scope scope(latency, TickPhase::applyMsg ); return OnApplied(portfolio.ApplyState(state)); }
+    const std::vector<ReqMsg>& BuildReqs ()                      { TickLatency::Scope scope(latency, TickPhase::buildReqs); return model.BuildReqs();                      }
 
-    Trader() { model.SetPortfolio(&portfolio); }
+    Trader() : period(0), resume(false), resumed(false), nTick(0) { model.SetPortfolio(&portfolio); }
+private:
+    STR day;
+    
+    STR  pathCkpt;
+    int  period;
+    bool resume, resumed;
+    int  nTick; // of the day
+    Checkpoint ckpt;
+    constexpr static const char *kCkptName  = "checkpoint.bin";
+    constexpr static uint32_t    kCkptMagic = 0x4b434253; // "SBCK"
+    
+    int  OnApplied(int ret) { if (resume == true) Resume(); return ret; }
+    void Resume();
 };
 
 }
@@ -32,15 +32,7 @@ template <class TItem>
 class ELW : public TItem // derive from a specialized Security<TOrder> (i.e., Item)
 {
 public:
-    // virtuals from Security
-    SecType Type  ()        const { return SecType::ELW;                }
-    INT     TckHi (INT p)   const { return p + 5;                       }
-    INT     TckLo (INT p)   const { return (p - 5) * (p > 0);           }
-    bool    ValidP(INT p)   const { return (p > 0) && ((p % 5) == 0);   }
-    INT64   BFee  (INT64 r) const { return (INT64)std::round(r * dBF0); }
-    INT64   SFee  (INT64 r) const { return (INT64)std::round(r * dSF0); }
-    double  dBF   ()        const { return dBF0;                        }
-    double  dSF   ()        const { return dSF0;                        }
+    typedef Tick5Rules Rules; // tick & fee rules (dispatched by Security on Type)
     
     // additionals
     static FLOAT kospi200;
@@ -55,11 +47,9 @@ public:
     OptType CallPut() const { verify(optType != OptType::null); return optType; }
     INT     Expiry () const { verify(optType != OptType::null); return expiry;  }
     
-    ELW() : thr{}, optType(OptType::null), expiry(0) {}
-    ELW(OptType t, INT e) : thr{} { SetInfo(t, e); }
+    ELW() : thr{}, optType(OptType::null), expiry(0) { this->secType = SecType::ELW; }
+    ELW(OptType t, INT e) : thr{} { this->secType = SecType::ELW; SetInfo(t, e); }
 private:
-    constexpr static const double dBF0 = 0.00015;
-    constexpr static const double dSF0 = 0.00015;
     OptType optType;
     INT     expiry;
 };
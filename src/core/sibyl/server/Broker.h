@@ -20,10 +20,13 @@
 #include <cstring>
 #include <iostream>
 #include <atomic>
+#include <limits>
 
 #include "OrderBook.h"
 #include "../util/DispPrefix.h"
+#include "../util/TickLatency.h"
 #include "../ReqType.h"
+#include "../TickMsg.h"
 
 namespace sibyl
 {
@@ -33,6 +36,7 @@ class Broker
 {
 public:
     OrderBook<TOrder, TItem> orderbook;
+    TickLatency              latency;   // server side phases, fed by NetServer (or DirectLink) & ApplyMsgIn/ApplyReqs
     
     void SetVerbose(bool verbose_) { verbose = verbose_; orderbook.SetVerbose(verbose); }
     
@@ -48,6 +52,17 @@ public:
     CSTR& BuildMsgOut() = 0;
     void  ApplyMsgIn (char *msg);
     
+    // called by DirectLink; structured equivalents of the above (no text involved)
+    virtual
+    const StateMsg& BuildState() = 0;
+    void            ApplyReqs (const std::vector<ReqMsg> &reqs);
+    
+    // called by NetServer main loop after AdvanceTick signals exit
+    virtual // Simulation: roll over to the next day in place (name: day name)
+    int NextDay(STR &name) { return -1; } // returns non-0 if no more days
+    virtual // Simulation: name of the day loaded; Kiwoom: today (empty if unknown, i.e., until a day boundary)
+    STR Day() const { return STR(); }
+    
     // called after NetServer finishes
     virtual void OnExit() = 0;
     
@@ -62,7 +77,9 @@ protected:
     void ResetInterrupt() { ab_interrupt = false; }
 
     const
-    std::vector<UnnamedReq<TItem>>& ParseMsgIn(char *msg); // this destroys msg during parsing
+    std::vector<UnnamedReq<TItem>>& ParseMsgIn(const char *msg);
+    const
+    std::vector<UnnamedReq<TItem>>& ResolveReqs(const std::vector<ReqMsg> &reqs); // same checks as ParseMsgIn
     void ExecuteUnnamedReqs(const std::vector<UnnamedReq<TItem>>& ureq);
     virtual
     int ExecuteNamedReq(NamedReq<TOrder, TItem> req) = 0; // returns non-0 to signal exit (req count limit)
@@ -70,73 +87,89 @@ protected:
 private:
     std::atomic_bool ab_interrupt;
     std::vector<UnnamedReq<TItem>> ureq;
+    void PushReq(const UnnamedReq<TItem> &req); // add a valid req to ureq
+    // digits only, as std::stoi of an all-digit word (false if empty or out of range)
+    static bool ParseNonNeg(const char *pc, std::size_t len, INT &val);
 };
 
 template <class TOrder, class TItem>
 void Broker<TOrder, TItem>::ApplyMsgIn(char *msg)
 {
     orderbook.RemoveEmptyOrders();
-    ExecuteUnnamedReqs(ParseMsgIn(msg));
+    {
+        TickLatency::Scope scope(latency, TickPhase::parseMsg);
+        ParseMsgIn(msg);
+    }
+    TickLatency::Scope scope(latency, TickPhase::executeReqs);
+    ExecuteUnnamedReqs(ureq);
 }
 
 template <class TOrder, class TItem>
-const std::vector<UnnamedReq<TItem>>& Broker<TOrder, TItem>::ParseMsgIn(char *msg)
+void Broker<TOrder, TItem>::ApplyReqs(const std::vector<ReqMsg> &reqs)
 {
-    ureq.clear();
+    orderbook.RemoveEmptyOrders();
+    {
+        TickLatency::Scope scope(latency, TickPhase::parseMsg);
+        ResolveReqs(reqs);
+    }
+    TickLatency::Scope scope(latency, TickPhase::executeReqs);
+    ExecuteUnnamedReqs(ureq);
+}
 
-    for (char *pcLine = strtok(msg, "\n"); pcLine != NULL; pcLine = strtok(NULL, "\n"))
+template <class TOrder, class TItem>
+const std::vector<UnnamedReq<TItem>>& Broker<TOrder, TItem>::ParseMsgIn(const char *msg)
+{
+    ureq.clear();
+    
+    // single pass over msg; words are (pointer, length) pairs into msg and codes are looked up by FindCode
+    for (const char *pcLine = msg; *pcLine != '\0';)
     {
-        char *pc = strpbrk(pcLine, "\r\n");
-        if (pc != NULL) *pc = '\0';
-        if (strlen(pcLine) == 0) continue;            
+        const char *pcEnd = pcLine; // a line ends at the first '\r' or '\n'
+        while (*pcEnd != '\0' && *pcEnd != '\r' && *pcEnd != '\n') pcEnd++;
+        const char *pcNext = pcEnd;
+        while (*pcNext != '\0' && *pcNext != '\n') pcNext++;
+        if (*pcNext == '\n') pcNext++;
+        const char *pcBegin = pcLine;
+        pcLine = pcNext;
+        if (pcBegin == pcEnd) continue;
         
         UnnamedReq<TItem> req;
         bool fail = true;
-        int iW = 0;
-        for (char *pcWord = pcLine; pcWord != NULL; pcWord = strchr (pcWord, ' '), iW++)
-        {                
-            while (*pcWord == ' ') pcWord++; // prevent empty word
-            char *pcSpace = strchr(pcWord, ' ');
-            if (pcSpace != NULL) *pcSpace = '\0';
-            STR word(pcWord);
-            if (pcSpace != NULL) *pcSpace = ' ';
+        const char *pc = pcBegin;
+        for (int iW = 0; ; iW++)
+        {
+            while (pc != pcEnd && *pc == ' ') pc++; // prevent empty word (but one follows trailing spaces)
+            const char *pcWord = pc;
+            while (pc != pcEnd && *pc != ' ') pc++;
+            std::size_t len = (std::size_t)(pc - pcWord);
             
             if (iW == 0) // command
             {
-                if (word == "b" ) req.type = ReqType::b;
-                if (word == "s" ) req.type = ReqType::s;
-                if (word == "cb") req.type = ReqType::cb;
-                if (word == "cs") req.type = ReqType::cs;
-                if (word == "mb") req.type = ReqType::mb;
-                if (word == "ms") req.type = ReqType::ms;
-                if (word == "ca") req.type = ReqType::ca;
-                if (word == "sa") req.type = ReqType::sa;
-                if ((word == "ca") || (word == "sa")) fail = false; // prepare to exit
+                req.type = ReqTypeOf(pcWord, len);
+                if ((req.type == ReqType::ca) || (req.type == ReqType::sa)) fail = false; // prepare to exit
                 if (req.type == ReqType::null) break; // command not found
             }
             if (iW == 1) // code
             {
-                if ((word == "ca") || (word == "sa")) { fail = true; break; } // too many words for a ca/sa command
-                req.iItems = orderbook.items.find(word);
+                ReqType type = ReqTypeOf(pcWord, len);
+                if ((type == ReqType::ca) || (type == ReqType::sa)) { fail = true; break; } // too many words for a ca/sa command
+                req.iItems = orderbook.FindCode(pcWord, len);
                 if (req.iItems == std::end(orderbook.items)) break; // code not found
             }
             if (iW == 2) // price
             {
-                if (false == std::all_of(std::begin(word), std::end(word), (int (*)(int))std::isdigit)) break; // not non-negative number
-                req.p = std::stoi(word);
+                if (false == ParseNonNeg(pcWord, len, req.p)) break; // not non-negative number
                 if (req.p <= 0) break; // 0 price not allowed
             }
             if (iW == 3) // quantity
             {
-                if (false == std::all_of(std::begin(word), std::end(word), (int (*)(int))std::isdigit)) break; // not non-negative number
-                req.q = std::stoi(word);
+                if (false == ParseNonNeg(pcWord, len, req.q)) break; // not non-negative number
                 if ((req.type != ReqType::mb) && (req.type != ReqType::ms)) fail = false; // prepare to exit
             }
             if (iW == 4) // modprice (mb/ms only)
             {
                 if ((req.type != ReqType::mb) && (req.type != ReqType::ms)) { fail = true; break; } // too many words for a b/s/cb/cs command
-                if (false == std::all_of(std::begin(word), std::end(word), (int (*)(int))std::isdigit)) break; // not non-negative number
-                req.mp = std::stoi(word);
+                if (false == ParseNonNeg(pcWord, len, req.mp)) break; // not non-negative number
                 if (req.mp <= 0) break; // 0 price not allowed
                 fail = false; // prepare to exit
             }
@@ -145,33 +178,94 @@ const std::vector<UnnamedReq<TItem>>& Broker<TOrder, TItem>::ParseMsgIn(char *ms
                 fail = true;
                 break;
             }
+            if (pc == pcEnd) break; // last word
         }
         
         if (fail == false)
+            PushReq(req);
+        else
         {
-            ureq.push_back(req);
-            if (verbose == true)
-            {
-                if (req.type == ReqType::ca || req.type == ReqType::sa)
-                    std::cout << dispPrefix << "ReqIn:  " << req.type << std::endl;
-                else
-                {
-                    std::cout << dispPrefix << "ReqIn:  " << req.type << " " << fmt_code(req.iItems->first) << " " << fmt_price(req.p) << " " << fmt_quant(req.q);
-                    if (req.type == ReqType::mb || req.type == ReqType::ms) std::cout << " " << fmt_price(req.mp);
-                    std::cout << std::endl;
-                }
-            }
+            std::cerr << dispPrefix << "Invalid req: ";
+            std::cerr.write(pcBegin, pcEnd - pcBegin);
+            std::cerr << std::endl;
+            continue;
         }
+    }
+    
+    return ureq;
+}
+
+template <class TOrder, class TItem>
+bool Broker<TOrder, TItem>::ParseNonNeg(const char *pc, std::size_t len, INT &val)
+{
+    if (len == 0) return false;
+    INT64 v = 0;
+    for (std::size_t k = 0; k < len; k++)
+    {
+        if (pc[k] < '0' || pc[k] > '9') return false;
+        v = v * 10 + (pc[k] - '0');
+        if (v > std::numeric_limits<INT>::max()) return false;
+    }
+    val = (INT)v;
+    return true;
+}
+
+template <class TOrder, class TItem>
+const std::vector<UnnamedReq<TItem>>& Broker<TOrder, TItem>::ResolveReqs(const std::vector<ReqMsg> &reqs)
+{
+    ureq.clear();
+    
+    for (const auto &r : reqs)
+    {
+        UnnamedReq<TItem> req;
+        req.type = r.type;
+        
+        bool fail;
+        if (r.type == ReqType::ca || r.type == ReqType::sa)
+            fail = (r.code.empty() == false || r.p != 0 || r.q != 0 || r.mp != 0);
         else
         {
-            std::cerr << dispPrefix << "Invalid req: " << pcLine << std::endl;
-            continue;
+            bool isMod = (r.type == ReqType::mb || r.type == ReqType::ms);
+            req.iItems = orderbook.FindCode(r.code.data(), r.code.size());
+            req.p  = r.p;
+            req.q  = r.q;
+            req.mp = r.mp;
+            fail = (r.type == ReqType::null) ||
+                   (req.iItems == std::end(orderbook.items)) || // code not found
+                   (r.p <= 0 || r.q < 0) ||                     // 0 price not allowed
+                   (isMod == true ? r.mp <= 0 : r.mp != 0);     // modprice for mb/ms only
+        }
+        
+        if (fail == false)
+            PushReq(req);
+        else
+        {
+            std::cerr << dispPrefix << "Invalid req: " << r.type << " " << r.code << " " << r.p << " " << r.q;
+            if (r.mp != 0) std::cerr << " " << r.mp;
+            std::cerr << std::endl;
         }
     }
     
     return ureq;
 }
 
+template <class TOrder, class TItem>
+void Broker<TOrder, TItem>::PushReq(const UnnamedReq<TItem> &req)
+{
+    ureq.push_back(req);
+    if (verbose == true)
+    {
+        if (req.type == ReqType::ca || req.type == ReqType::sa)
+            std::cout << dispPrefix << "ReqIn:  " << req.type << std::endl;
+        else
+        {
+            std::cout << dispPrefix << "ReqIn:  " << req.type << " " << fmt_code(req.iItems->first) << " " << fmt_price(req.p) << " " << fmt_quant(req.q);
+            if (req.type == ReqType::mb || req.type == ReqType::ms) std::cout << " " << fmt_price(req.mp);
+            std::cout << std::endl;
+        }
+    }
+}
+
 template <class TOrder, class TItem>
 void Broker<TOrder, TItem>::ExecuteUnnamedReqs(const std::vector<UnnamedReq<TItem>>& ureq)
 {
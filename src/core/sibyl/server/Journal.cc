@@ -0,0 +1,226 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Journal.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+namespace sibyl
+{
+
+    /* =========================================== */
+    /*                JournalWriter                */
+    /* =========================================== */
+
+int JournalWriter::Open(CSTR &path)
+{
+    Close();
+    pfJournal = fopen(path.c_str(), "wb");
+    pfIndex   = fopen((path + Journal::kIndexExt).c_str(), "wb");
+    Journal::FileHeader hJournal = { Journal::kMagicJournal, Journal::kVersion };
+    Journal::FileHeader hIndex   = { Journal::kMagicIndex  , Journal::kVersion };
+    if (pfJournal == nullptr || pfIndex == nullptr                 ||
+        1 != fwrite(&hJournal, sizeof(hJournal), 1, pfJournal)     ||
+        1 != fwrite(&hIndex  , sizeof(hIndex  ), 1, pfIndex  )     )
+    {
+        std::cerr << "JournalWriter: " << path << " not writable" << std::endl;
+        if (pfJournal != nullptr) fclose(pfJournal);
+        if (pfIndex   != nullptr) fclose(pfIndex  );
+        pfJournal = pfIndex = nullptr;
+        return -1;
+    }
+    offset   = sizeof(hJournal);
+    day      = 0;
+    closing  = false;
+    szQueued = 0;
+    nWritten = nDropped = 0;
+    thread   = std::thread(&JournalWriter::Run, this);
+    return 0;
+}
+
+void JournalWriter::Close()
+{
+    if (IsOpen() == false) return;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        closing = true;
+    }
+    queue_cv.notify_one();
+    thread.join();
+    fclose(pfJournal);
+    fclose(pfIndex  );
+    pfJournal = pfIndex = nullptr;
+}
+
+void JournalWriter::PushState(const StateMsg &state, const std::vector<char> *pFrame)
+{
+    if (IsOpen() == false) return;
+    Frame frame;
+    frame.time = state.time;
+    frame.day  = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (spare.empty() == false)
+        {
+            frame.buf.swap(spare.back());
+            spare.pop_back();
+        }
+    }
+    // outside the lock; capacity of spare buffers is kept
+    if (pFrame != nullptr) frame.buf.assign(std::begin(*pFrame), std::end(*pFrame));
+    else                   BinMsg::EncodeState(state, frame.buf);
+    Push(std::move(frame), true);
+}
+
+void JournalWriter::PushDay(CSTR &name)
+{
+    if (IsOpen() == false) return;
+    Frame frame;
+    frame.time = 0;
+    frame.day  = true;
+    BinMsg::EncodeDay(name, frame.buf);
+    Push(std::move(frame), false);
+}
+
+void JournalWriter::Push(Frame &&frame, bool droppable)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (droppable == true && szQueued + frame.buf.size() > kMaxQueued)
+        {
+            nDropped++;
+            spare.push_back(std::move(frame.buf));
+            return;
+        }
+        szQueued += frame.buf.size();
+        queue.push_back(std::move(frame));
+    }
+    queue_cv.notify_one();
+}
+
+void JournalWriter::Run()
+{
+    bool fail = false;
+    while (true)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [&]{ return queue.empty() == false || closing == true; });
+            if (queue.empty() == true) break; // closing
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        if (fail == false && 0 != Write(frame))
+        {
+            std::cerr << "JournalWriter: write failed; recording stopped" << std::endl;
+            fail = true;
+        }
+        if (fail == true && frame.day == false) nDropped++;
+
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        szQueued -= frame.buf.size();
+        spare.push_back(std::move(frame.buf));
+    }
+    fflush(pfJournal);
+    fflush(pfIndex  );
+}
+
+int JournalWriter::Write(const Frame &frame)
+{
+    if (frame.day == false)
+    {
+        Journal::Entry e = { (int32_t)frame.time, day, offset };
+        if (1 != fwrite(&e, sizeof(e), 1, pfIndex)) return -1;
+    }
+    if (frame.buf.size() != fwrite(frame.buf.data(), 1, frame.buf.size(), pfJournal)) return -1;
+    offset += frame.buf.size();
+    if (frame.day == false) nWritten++;
+    else                    day++;
+    return 0;
+}
+
+    /* =========================================== */
+    /*                JournalReader                */
+    /* =========================================== */
+
+int JournalReader::Open(CSTR &path)
+{
+    Close();
+    pf = fopen(path.c_str(), "rb");
+    Journal::FileHeader h = {};
+    if (pf == nullptr || 1 != fread(&h, sizeof(h), 1, pf) ||
+        h.magic != Journal::kMagicJournal || h.version != Journal::kVersion)
+    {
+        std::cerr << "JournalReader: " << path << " inaccessible or of unknown format/version" << std::endl;
+        Close();
+        return -1;
+    }
+
+    // index is optional (e.g., copied without it); Seek then fails, while reading from the start still works
+    FILE *pfIndex = fopen((path + Journal::kIndexExt).c_str(), "rb");
+    if (pfIndex != nullptr)
+    {
+        if (1 == fread(&h, sizeof(h), 1, pfIndex) && h.magic == Journal::kMagicIndex && h.version == Journal::kVersion)
+        {
+            Journal::Entry e;
+            while (1 == fread(&e, sizeof(e), 1, pfIndex)) index.push_back(e);
+        }
+        fclose(pfIndex);
+    }
+    return 0;
+}
+
+void JournalReader::Close()
+{
+    if (pf != nullptr) fclose(pf);
+    pf = nullptr;
+    index.clear();
+}
+
+int JournalReader::Seek(int time)
+{
+    if (pf == nullptr || index.empty() == true) return -1;
+    auto itEnd = std::find_if(std::begin(index), std::end(index), [](const Journal::Entry &e) { return e.day != 0; });
+    auto it = std::lower_bound(std::begin(index), itEnd, time,
+                               [](const Journal::Entry &e, int t) { return e.time < t; });
+    if (it == itEnd) return -1;
+    #ifndef _WIN32
+    return fseeko(pf, (off_t)it->offset, SEEK_SET);
+    #else
+    return _fseeki64(pf, (__int64)it->offset, SEEK_SET);
+    #endif /* !_WIN32 */
+}
+
+int JournalReader::Next(uint32_t &magic, const char *&payload, std::size_t &size)
+{
+    if (pf == nullptr) return -1;
+    BinMsg::Header h;
+    std::size_t n = fread(&h, 1, sizeof(h), pf);
+    if (n == 0) return 0;
+    if (n != sizeof(h) || BinMsg::IsMagic(h.magic) == false) return -1;
+    buf.resize(std::max<std::size_t>(h.size, 1));
+    if (h.size != fread(buf.data(), 1, h.size, pf)) return -1;
+    magic   = h.magic;
+    payload = buf.data();
+    size    = h.size;
+    return 1;
+}
+
+}
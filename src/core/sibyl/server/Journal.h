@@ -0,0 +1,136 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_JOURNAL_H_
+#define SIBYL_SERVER_JOURNAL_H_
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "../BinMsg.h"
+
+namespace sibyl
+{
+
+// Binary journal of the states sent by a server, with an index by time (see NetServer::SetJournal & Replay)
+// Journal: magic "SBJN" | version (uint32) | frames as sent to binary clients (see BinMsg.h),
+//          a kMagicState frame every tick and a kMagicDay frame at each day boundary
+// Index:   magic "SBJI" | version (uint32) | Entry per kMagicState frame (at <journal path> + kIndexExt)
+// Both are in host byte order, as BinMsg frames are
+struct Journal
+{
+    constexpr static uint32_t kMagicJournal = 0x4e4a4253; // "SBJN"
+    constexpr static uint32_t kMagicIndex   = 0x494a4253; // "SBJI"
+    constexpr static uint32_t kVersion      = 1;
+    constexpr static const char *kIndexExt  = ".idx";
+
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+    };
+    struct Entry {
+        int32_t  time;   // of the state
+        uint32_t day;    // # of kMagicDay frames before
+        uint64_t offset; // of the frame (header included) in the journal
+    };
+};
+static_assert(sizeof(Journal::Entry) == 16, "Journal::Entry not packed");
+
+// Records frames from the tick loop through a thread of its own; Push never waits for disk
+// Frames are queued up to kMaxQueued bytes; states beyond are dropped (counted) rather than stall the tick loop
+class JournalWriter
+{
+public:
+    int  Open (CSTR &path); // returns non-0 to signal error
+    void Close();           // writes out frames queued so far
+    bool IsOpen() const { return thread.joinable(); }
+
+    // called by the tick loop
+    void PushState(const StateMsg &state, const std::vector<char> *pFrame = nullptr); // pFrame: state already encoded
+    void PushDay  (CSTR &name);            // never dropped
+
+    uint64_t Written() const { return nWritten.load(); } // states
+    uint64_t Dropped() const { return nDropped.load(); } // states
+
+    JournalWriter() : szQueued(0), closing(false), pfJournal(nullptr), pfIndex(nullptr),
+                      offset(0), day(0), nWritten(0), nDropped(0) {}
+    ~JournalWriter() { Close(); }
+    JournalWriter           (const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+private:
+    constexpr static std::size_t kMaxQueued = (1 << 28);
+
+    struct Frame {
+        int  time;
+        bool day;
+        std::vector<char> buf; // whole frame
+    };
+    std::mutex              queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<Frame>       queue;
+    std::vector<std::vector<char>> spare; // buffers of frames written, reused
+    std::size_t szQueued;
+    bool        closing;
+    std::thread thread;
+
+    // accessed by thread only (after Open)
+    FILE    *pfJournal, *pfIndex;
+    uint64_t offset;
+    uint32_t day;
+
+    std::atomic<uint64_t> nWritten, nDropped;
+
+    void Push(Frame &&frame, bool droppable);
+    void Run();
+    int  Write(const Frame &frame); // returns non-0 to signal error
+};
+
+// Reads a journal frame by frame, from the start or from a time found through the index
+class JournalReader
+{
+public:
+    int  Open (CSTR &path); // returns non-0 to signal error (index is optional)
+    void Close();
+    bool IsOpen() const { return pf != nullptr; }
+
+    // Position at the first state of the first day at or after time; returns non-0 if none or no index
+    int Seek(int time);
+
+    // Read the next frame; payload is valid until the next call
+    // Returns 1 if read, 0 at the end, -1 for invalid data
+    int Next(uint32_t &magic, const char *&payload, std::size_t &size);
+
+    const std::vector<Journal::Entry>& Index() const { return index; }
+
+    JournalReader() : pf(nullptr) {}
+    ~JournalReader() { Close(); }
+    JournalReader           (const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+private:
+    FILE *pf;
+    std::vector<char> buf;
+    std::vector<Journal::Entry> index;
+};
+
+}
+
+#endif /* SIBYL_SERVER_JOURNAL_H_ */
@@ -19,6 +19,7 @@
 #include <thread>
 #include <fstream>
 #include <iomanip>
+#include <ctime>
 
 #include "../../util/Clock.h"
 #include "../../ostream_format.h"
@@ -27,6 +28,14 @@
 namespace sibyl
 {
 
+STR Kiwoom::Day() const
+{
+    std::time_t t = std::time(nullptr);
+    char buf[16];
+    std::strftime(buf, sizeof(buf), "%Y%m%d", std::localtime(&t));
+    return STR(buf);
+}
+
 void Kiwoom::SetStateFile(CSTR &filename)
 {
     {
@@ -134,7 +143,7 @@ bool Kiwoom::Launch()
     // Reverse ord ordering
     for (auto &code_pItem : orderbook.items)
     {
-        std::multimap<INT, OrderKw> reverse;
+        OrderLadder<OrderKw> reverse;
         for (auto rit_ord = code_pItem.second->ord.rbegin(); rit_ord != code_pItem.second->ord.rend(); rit_ord++)
             reverse.insert(std::make_pair(rit_ord->first, rit_ord->second));
         code_pItem.second->ord.swap(reverse);
@@ -253,7 +262,19 @@ int Kiwoom::AdvanceTick()
 CSTR& Kiwoom::BuildMsgOut()
 {
     std::lock_guard<std::recursive_mutex> lock(orderbook.items_mutex);
-    
+    PrepareMsgOut();
+    return orderbook.BuildMsgOut(false);
+}
+
+const StateMsg& Kiwoom::BuildState()
+{
+    std::lock_guard<std::recursive_mutex> lock(orderbook.items_mutex);
+    PrepareMsgOut();
+    return orderbook.BuildState(false);
+}
+
+void Kiwoom::PrepareMsgOut()
+{
     for (const auto &code_pItem : orderbook.items)
     {
         auto &i = *code_pItem.second;
@@ -273,8 +294,6 @@ CSTR& Kiwoom::BuildMsgOut()
     orderbook.UpdateRefInitBal();
     
     if (verbose == true && stateFileName.empty() == false) WriteState();
-    
-    return orderbook.BuildMsgOut(false);
 }
 
 void Kiwoom::WriteState()
@@ -39,7 +39,9 @@ public:
 
     // called by NetServer thread
     int   AdvanceTick() override;
+    STR   Day        () const override; // today as YYYYMMDD (local time)
 /**/CSTR& BuildMsgOut() override;
+/**/const StateMsg& BuildState() override;
 /**/void  WriteState ();
     
     // Asynchronous data (OnReceiveRealData { code = sRealKey } | OnReceiveChejanData)    
@@ -65,6 +67,7 @@ private:
     
     // called by NetServer thread
     void SetOrderBookTime(int t) { orderbook.time = t; }
+    void PrepareMsgOut(); // requantize, pr, qr of this tick for BuildMsgOut & BuildState (caller locks)
 /**/int  ExecuteNamedReq(NamedReq<OrderKw, ItemKw> req) override; // non-0 if req count overflow
     void OnExit() override;
     
@@ -31,6 +31,8 @@ namespace sibyl
 OrderBook<OrderKw, ItemKw> *TR::pob = nullptr;
 STR TR::accno;
 std::map<STR, TR*> TR::map_name_TR;
+constexpr int TR::t_timeout;
+constexpr int TR::t_waitOverflow;
 
 TR::State TR::Send(bool write)
 {
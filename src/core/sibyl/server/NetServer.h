@@ -20,29 +20,66 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <memory>
+#include <chrono>
+#include <algorithm>
 #include <cerrno>
 
 #include "../NetAgent.h"
+#include "../BinMsg.h"
 #include "Broker.h"
+#include "NetSession.h"
+#include "Poller.h"
+#include "Journal.h"
 #include "../util/DispPrefix.h"
 
 namespace sibyl
 {
 
+// Serves a Broker to any number of clients (NetSession) from a single thread through a non-blocking event loop
+// Every tick, the state is sent to all clients and the server waits (up to kTimeRates::secPerTick) for the replies
+// of trader clients only; subscriber clients (see BinMsg::kNegotiateSub) never hold up the tick loop
+// port may be unix:<path> or shm:<path> (see NetAgent::ParseLocal) to listen on a unix socket instead of TCP;
+// either accepts clients of both, since shared memory is set up by the client (see ShmLink.h)
 template <class TOrder, class TItem>
 class NetServer : public NetAgent
 {
 public:
+    // Which reqs of trader clients are applied every tick, and in what order
+    //   all   : reqs of every trader, in the order of connection (default)
+    //   first : reqs of the earliest connected trader only (others are still waited for)
+    //   rotate: reqs of every trader, starting from a different one every tick
+    enum class ReqPolicy { all, first, rotate };
+    
     void Launch(CSTR &port, bool autoStart, bool reconnectable);
     void StartMainLoop() { start_ab = true; start_cv.notify_one(); }
     
+    // called before Launch
+    void SetReqPolicy (ReqPolicy policy_) { policy     = policy_; }
+    void SetMinTraders(int minTraders_)   { minTraders = minTraders_; } // traders to wait for before the first tick (default 1)
+    int  SetJournal   (CSTR &path)        { return journal.Open(path); } // record the state of every tick (see Journal.h)
+    
     NetServer(Broker<TOrder, TItem> *pBroker_)
-        : pBroker(pBroker_), start_ab(false), sock_serv(sock_fail), sock_conn(sock_fail) {} 
+        : pBroker(pBroker_), start_ab(false), sock_serv(sock_fail),
+          policy(ReqPolicy::all), minTraders(1), nTraders(0), lostTrader(false), nextId(1), iTick(0), dayCrossed(false) {} 
 private:
     int  Initialize   (CSTR &port); // returns non-0 to signal error
-    int  AcceptConn   ();           // returns non-0 to signal error
+    void WaitTraders  (int n);      // serve clients until n traders are connected
+    void Serve        (int timeoutMs); // handle events of listening & client sockets (-1: block until any)
+    void Accept       ();
+    void Negotiate    (NetSession &s, bool expired); // Handshake once the tokens are complete (or on timeout)
+    void Handshake    (NetSession &s); // password & negotiation
+    void Join         (NetSession &s); // promote a joining session to trader once it replied to the day name
     void SendMsgOut   ();
-    int  RecvMsgIn    ();           // returns non-0 to signal client disconnection
+    void SendNewDay   (CSTR &name);
+    void SetDay       (CSTR &name);    // day & its messages
+    void SendDay      (NetSession &s); // day message of the current day
+    void RecvMsgIn    ();           // wait for replies of traders and apply reqs per ReqPolicy
+    void Send         (NetSession &s, const char *buf, std::size_t len);
+    void Close        (NetSession &s, CSTR &reason);
+    void Sweep        ();           // remove closed sessions
+    void Linger       (int timeoutMs); // let subscribers read up to the end & disconnect, before closing all
+    void DropReplies  (NetSession &s); // replies not taken in time, before sending a new message
     int  DisplayString(CSTR &disp, bool isError = false, int errno_ = 0);
     
     Broker<TOrder, TItem>  *pBroker;
@@ -50,8 +87,35 @@ private:
     std::mutex              start_mutex;
     std::atomic_bool        start_ab;
     
-    int sock_serv;
-    int sock_conn;
+    int    sock_serv;
+    STR    pathLocal; // of the unix socket listened on, if any
+    Poller poller;
+    std::vector<std::unique_ptr<NetSession>> sessions; // in the order of connection
+    
+    ReqPolicy policy;
+    int  minTraders, nTraders;
+    bool lostTrader; // a trader disconnected since the last check
+    int  nextId;
+    int  iTick;
+    
+    constexpr static int kSnapshotPeriod = 60;   // delta messages (see StateDelta)
+    constexpr static int kLingerMs       = 5000; // at exit (see Linger)
+    constexpr static int kHandshakeMs    = 1000; // for a pending session to complete its tokens (see Negotiate)
+    constexpr static std::size_t kHandshakeMax = (1 << 10); // bytes of password & tokens
+    
+    // messages shared by clients of the same settings, built once per tick
+    STR msgText, msgDelta;
+    StateText text; // formats msgText, reusing the lines of unchanged items
+    std::vector<char> frameText, frameDelta;
+    STR day, msgDay; // current day; empty until a day boundary if Broker::Day is unknown
+    bool dayCrossed; // a day boundary passed (day is sent to every client, not only those asking for it)
+    std::vector<char> frameDayText, frameDayBin;
+    std::vector<ReqMsg> reqs;
+    std::vector<NetSession*> order;
+    
+    JournalWriter journal; // written by a thread of its own; never holds up the tick loop
+    
+    static STR Tag(const NetSession &s) { return " [client " + std::to_string(s.id) + "]"; }
 };
 
 template <class TOrder, class TItem>
@@ -63,34 +127,65 @@ void NetServer<TOrder, TItem>::Launch(CSTR &port, bool autoStart, bool reconnect
     
     if (0 != Initialize(port)) return;
     
-    do {
-        if (0 == AcceptConn())
+    // the first day is named (if known) only to clients that ask (see Handshake); not a day boundary
+    SetDay(pBroker->Day());
+    
+    WaitTraders(minTraders);
+    {
+        std::unique_lock<std::mutex> lock(start_mutex);
+        start_cv.wait(lock, [&]{ return start_ab == true; });
+    } // mutex unlocked here
+    
+    while (true)
+    {
+        if (lostTrader == true && nTraders == 0) // last trader gone
         {
-            {
-                std::unique_lock<std::mutex> lock(start_mutex);
-                start_cv.wait(lock, [&]{ return start_ab == true; });
-            } // mutex unlocked here
-            
-            while (true)
-            {
-                if (0 != pBroker->AdvanceTick()) {
-                    reconnectable = false;
-                    break;
-                }
-                if (false == pBroker->IsSkipping())
-                {
-                    // debug_msg("[NetServer] New tick");
-                    SendMsgOut();
-                }
-                if (false == pBroker->IsSkipping() && 0 != RecvMsgIn())
-                    break; 
+            if (reconnectable == false) break;
+            WaitTraders(std::max(minTraders, 1));
+        }
+        lostTrader = false;
+        
+        Serve(0);
+        auto t0 = TickLatency::clock::now();
+        int ret = pBroker->AdvanceTick();
+        pBroker->latency.EndCycle(pBroker->IsSkipping()); // cycle of the previous tick ends here
+        pBroker->latency.Add(TickPhase::advance, TickLatency::clock::now() - t0);
+        if (0 != ret) {
+            STR name;
+            if (0 == pBroker->NextDay(name)) {
+                SendNewDay(name);
+                continue;
             }
+            break;
+        }
+        if (false == pBroker->IsSkipping())
+        {
+            // debug_msg("[NetServer] New tick");
+            SendMsgOut();
+            RecvMsgIn();
         }
-    } while (reconnectable == true);
+    }
     
     if (verbose) DisplayString("Exiting main loop");
     
+    Linger(kLingerMs);
+    for (auto &ps : sessions) Close(*ps, "");
+    Sweep();
+    close_socket(sock_serv);
+    sock_serv = sock_fail;
+    #ifndef _WIN32
+    if (pathLocal.empty() == false) unlink(pathLocal.c_str());
+    #endif /* !_WIN32 */
+    
     pBroker->OnExit();
+    if (journal.IsOpen() == true)
+    {
+        journal.Close();
+        if (verbose == true) DisplayString("Journal: " + std::to_string(journal.Written()) + " ticks written, " +
+                                           std::to_string(journal.Dropped()) + " dropped");
+    }
+    pBroker->latency.EndCycle(false);
+    pBroker->latency.Print(std::cout, "server");
     
 #ifdef _WIN32
     WSACleanup();
@@ -109,134 +204,495 @@ int NetServer<TOrder, TItem>::Initialize(CSTR &port)
     // if (verbose) DisplayString("[Done] Winsock DLL startup");
 #endif /* _WIN32 */
     
-    // Create server socket
-    if (sock_fail == (sock_serv = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)))
-        return   DisplayString("[Fail] Create socket", true, errno);
-    // if (verbose) DisplayString("[Done] Create socket");
-    
-    // Prevent socket's address being blocked after app terminates
-    int optval = 1;
-    if (sock_fail == setsockopt(sock_serv, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&optval), sizeof(optval)))
-        return   DisplayString("[Fail] Change socket option", true, errno); 
-    // if (verbose) DisplayString("[Done] Change socket option");
-
-    // Bind socket to address and listen
-    struct sockaddr_in addr_serv;    
-    memset(&addr_serv, 0, sizeof(addr_serv));
-    addr_serv.sin_family      = AF_INET;
-    addr_serv.sin_addr.s_addr = INADDR_ANY;
-    addr_serv.sin_port        = htons(std::stoi(port));
-
-    if (sock_fail == bind(sock_serv, (struct sockaddr *)&addr_serv, sizeof(addr_serv)))
-        return   DisplayString("[Fail] Bind address to socket", true, errno);
-    // if (verbose) DisplayString("[Done] Bind address to socket");
+    bool useShm;
+    if (true == ParseLocal(port, pathLocal, useShm))
+    {
+        #ifndef _WIN32
+        struct sockaddr_un addr_serv;
+        if (0 != SetUnixAddr(addr_serv, pathLocal))
+            return   DisplayString("[Fail] Invalid unix socket path " + pathLocal, true);
+        
+        if (sock_fail == (sock_serv = socket(AF_UNIX, SOCK_STREAM, 0)))
+            return   DisplayString("[Fail] Create socket", true, errno);
+        
+        unlink(pathLocal.c_str()); // left by a previous run
+        if (sock_fail == bind(sock_serv, (struct sockaddr *)&addr_serv, sizeof(addr_serv)))
+            return   DisplayString("[Fail] Bind address to socket", true, errno);
+        #else
+        pathLocal.clear();
+        return   DisplayString("[Fail] Unix sockets not supported", true);
+        #endif /* !_WIN32 */
+    }
+    else
+    {
+        // Create server socket
+        if (sock_fail == (sock_serv = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)))
+            return   DisplayString("[Fail] Create socket", true, errno);
+        // if (verbose) DisplayString("[Done] Create socket");
+        
+        // Prevent socket's address being blocked after app terminates
+        int optval = 1;
+        if (sock_fail == setsockopt(sock_serv, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&optval), sizeof(optval)))
+            return   DisplayString("[Fail] Change socket option", true, errno); 
+        // if (verbose) DisplayString("[Done] Change socket option");
+        
+        // Bind socket to address and listen
+        struct sockaddr_in addr_serv;    
+        memset(&addr_serv, 0, sizeof(addr_serv));
+        addr_serv.sin_family      = AF_INET;
+        addr_serv.sin_addr.s_addr = INADDR_ANY;
+        addr_serv.sin_port        = htons(std::stoi(port));
+        
+        if (sock_fail == bind(sock_serv, (struct sockaddr *)&addr_serv, sizeof(addr_serv)))
+            return   DisplayString("[Fail] Bind address to socket", true, errno);
+        // if (verbose) DisplayString("[Done] Bind address to socket");
+    }
         
     if (sock_fail == listen(sock_serv, kTCPBacklog))
         return   DisplayString("[Fail] Listen on socket", true, errno);
     // if (verbose) DisplayString("[Done] Listen on socket");
     
+    // Accept & serve clients through the event loop
+    if (0 != NetSession::SetNonBlocking(sock_serv) || 0 != poller.Add(sock_serv))
+        return   DisplayString("[Fail] Watch socket", true, errno);
+    
     return 0; 
 }
 
 template <class TOrder, class TItem>
-int NetServer<TOrder, TItem>::AcceptConn()
-{    
-    if (verbose) DisplayString("Waiting for client connection");
-    
-    // Establish a connection and query password
-    struct sockaddr_in addr_clnt;
-    socklen_t szAddr = sizeof(addr_clnt);
+void NetServer<TOrder, TItem>::WaitTraders(int n)
+{
+    if (nTraders < n && verbose == true) DisplayString("Waiting for client connection");
+    while (nTraders < n) Serve(-1);
+    lostTrader = false;
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Serve(int timeoutMs)
+{
+    // wake up in time for the handshake timeout of pending sessions
+    auto ElapsedMs = [](const NetSession &s) {
+        return (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - s.tConnect).count(); };
+    for (const auto &ps : sessions)
+    {
+        if (ps->role != NetSession::Role::pending || ps->sock == sock_fail) continue;
+        int remainMs = std::max(kHandshakeMs - ElapsedMs(*ps), 0);
+        timeoutMs = (timeoutMs < 0 ? remainMs : std::min(timeoutMs, remainMs));
+    }
     
-    if(sock_fail == (sock_conn = accept(sock_serv, (struct sockaddr *)&addr_clnt, &szAddr)))
-        return DisplayString("[Fail] Accept client", true, errno);
-    else
+    for (const auto &ev : poller.Wait(timeoutMs))
     {
-        if (verbose) DisplayString("Querying password");
-        memset(bufTCP, 0, kTCPBufSize);
-        if (recv(sock_conn, bufTCP, kTCPBufSize, 0) > 0)
+        if (ev.sock == sock_serv)
         {
-            char *pc = strpbrk(bufTCP, "\r\n");
-            if (pc != NULL) *pc = '\0';
-            if (kTCPPassword == STR(bufTCP))
-            {
-                // Set timeout for recv calls
-                #ifndef _WIN32
-                constexpr struct timeval sock_timeout = { .tv_sec  = kTimeRates::secPerTick,
-                                                          .tv_usec = 0 };
-                #else
-                constexpr DWORD sock_timeout = kTimeRates::secPerTick * 1000;
-                #endif /* !_WIN32 */
-                
-                if (sock_fail == setsockopt(sock_conn, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&sock_timeout), sizeof(sock_timeout)))
-                    return   DisplayString("[Fail] Change socket recv timeout", true, errno);
-            }
-            else
+            Accept();
+            continue;
+        }
+        auto iS = std::find_if(std::begin(sessions), std::end(sessions), [&ev](const std::unique_ptr<NetSession> &ps) {
+            return ps->sock == ev.sock || (ps->shm.Active() == true && ps->shm.Bell() == ev.sock); });
+        if (iS == std::end(sessions)) continue;
+        auto &s = **iS;
+        
+        if (s.shm.Active() == true && s.role != NetSession::Role::pending && ev.sock == s.sock)
+        {
+            Close(s, "Client disconnected"); // nothing else comes through the socket once linked
+            continue;
+        }
+        if (ev.in == true || ev.err == true)
+        {
+            if (0 != s.Read())
             {
-                close_socket(sock_conn);
-                sock_conn = sock_fail;
-                return DisplayString("[Fail] Invalid password", true);
+                Close(s, (s.role == NetSession::Role::pending ? "[Fail] Receive password" : "Client disconnected"));
+                continue;
             }
+            if      (s.role == NetSession::Role::pending   ) Negotiate(s, false);
+            else if (s.role == NetSession::Role::joining   ) Join(s);
+            else if (s.role == NetSession::Role::subscriber) s.DiscardInput(); // replies of subscribers ignored
         }
-        else
+        if (s.sock == sock_fail) continue;
+        if (ev.out == true || (s.shm.Active() == true && s.Pending() == true)) // shm: woken for space as well
+        {
+            if (0 != s.Flush()) Close(s, "Client disconnected");
+            else if (s.Pending() == false && s.shm.Active() == false) poller.Modify(s.sock, false);
+        }
+    }
+    for (const auto &ps : sessions)
+        if (ps->role == NetSession::Role::pending && ps->sock != sock_fail && ElapsedMs(*ps) >= kHandshakeMs) Negotiate(*ps, true);
+    Sweep();
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Accept()
+{
+    while (true)
+    {
+        struct sockaddr_storage addr_clnt;
+        socklen_t szAddr = sizeof(addr_clnt);
+        
+        int sock = (int)accept(sock_serv, (struct sockaddr *)&addr_clnt, &szAddr);
+        if (sock == sock_fail) return; // no more pending connections
+        
+        if (verbose) DisplayString("Querying password");
+        if (0 != NetSession::SetNonBlocking(sock) || 0 != poller.Add(sock))
+        {
+            DisplayString("[Fail] Accept client", true, errno);
+            close_socket(sock);
+            continue;
+        }
+        sessions.emplace_back(new NetSession(sock, nextId++));
+    }
+}
+
+// Password & negotiation tokens may arrive in more than one segment; the session stays pending until kNegotiateEnd
+// Clients older than kNegotiateEnd send the password alone, which is taken as complete on timeout
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Negotiate(NetSession &s, bool expired)
+{
+    const char *input = s.Input();
+    if (strstr(input, BinMsg::kNegotiateEnd) != NULL)
+    {
+        Handshake(s);
+        return;
+    }
+    if (s.InputSize() > kHandshakeMax)
+    {
+        Close(s, "[Fail] Receive password (too long)");
+        return;
+    }
+    if (expired == false) return;
+    if (strchr(input, '\n') == NULL) Handshake(s); // password alone (or cut short, then refused there)
+    else                             Close(s, "[Fail] Receive password (incomplete)");
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Handshake(NetSession &s)
+{
+    char *bufPw = s.Input(); // whole input as the password (see NetClient::Connect)
+    s.binary = (strstr(bufPw, BinMsg::kNegotiate     ) != NULL);
+    s.framed = (strstr(bufPw, BinMsg::kNegotiateFrame) != NULL) || s.binary;
+    s.delta  = (strstr(bufPw, BinMsg::kNegotiateDelta) != NULL);
+    bool sub = (strstr(bufPw, BinMsg::kNegotiateSub  ) != NULL);
+    bool shm = (strstr(bufPw, BinMsg::kNegotiateShm  ) != NULL);
+    bool dayNamed = (strstr(bufPw, BinMsg::kNegotiateDay) != NULL);
+    char *pc = strpbrk(bufPw, "\r\n");
+    if (pc != NULL) *pc = '\0';
+    bool valid = (kTCPPassword == STR(bufPw));
+    s.DiscardInput();
+    
+    if (valid == false)
+    {
+        Close(s, "");
+        DisplayString("[Fail] Invalid password", true);
+        return;
+    }
+    if (shm == false) s.shm.Close();
+    if (shm == true && (s.shm.Active() == false || 0 != poller.Add(s.shm.Bell())))
+    {
+        Close(s, "[Fail] Attach shared memory");
+        return;
+    }
+    
+    // A new session (including a client restarted in the middle of a day) gets a full state as its first message,
+    // as its StateDelta is fresh; after the first day boundary, the day name precedes it
+    // (from the first day on if asked for and known; see BinMsg::kNegotiateDay)
+    s.stateDelta.SetPeriod(s.delta == true ? kSnapshotPeriod : 0);
+    s.role = (sub == true ? NetSession::Role::subscriber : NetSession::Role::trader);
+    if (day.empty() == false && (dayCrossed == true || dayNamed == true))
+    {
+        SendDay(s);
+        if (s.role == NetSession::Role::trader)
         {
-            close_socket(sock_conn);
-            sock_conn = sock_fail;
-            return DisplayString("[Fail] Receive password", true);
+            s.role  = NetSession::Role::joining; // its reply to the day message is not to be taken for a req msg
+            s.nDays = 1;
         }
     }
+    if (s.role == NetSession::Role::trader) nTraders++;
+    
     if (verbose == true)
     {
-        DisplayString("Client connection established");
+        DisplayString(STR("Client connection established") + (s.binary == true ? " (binary)" : (s.framed == true ? " (framed)" : "")) +
+                      (s.delta == true ? " (delta)" : "") + (sub == true ? " (subscriber)" : "") + (shm == true ? " (shm)" : "") +
+                      (s.role == NetSession::Role::joining ? " (day " + day + ")" : "") + Tag(s));
         pBroker->SetVerbose(true);
     }
-    
-    return 0;
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Join(NetSession &s)
+{
+    int ret = 0;
+    while (s.nDays > 0 && 0 < (ret = s.NextMsg()))
+    {
+        s.Consume();
+        s.nDays--;
+    }
+    if (ret < 0)
+    {
+        Close(s, "[Fail] Invalid frame");
+        return;
+    }
+    if (s.nDays > 0) return;
+    s.role = NetSession::Role::trader;
+    nTraders++;
+    if (verbose == true) DisplayString("Client joined" + Tag(s));
 }
 
 template <class TOrder, class TItem>
 void NetServer<TOrder, TItem>::SendMsgOut()
 {
-    verify((sock_serv != sock_fail) && (sock_conn != sock_fail));
-    const auto &msg = pBroker->BuildMsgOut();
-    send(sock_conn, msg.c_str(), msg.size(), 0);
+    auto t0 = TickLatency::clock::now();
+    const StateMsg &state = pBroker->BuildState();
+    auto t1 = TickLatency::clock::now();
+    pBroker->latency.Add(TickPhase::buildMsg, t1 - t0);
+    
+    bool builtText = false, builtFrame = false, builtBin = false;
+    for (auto &ps : sessions)
+    {
+        auto &s = *ps;
+        if (s.role == NetSession::Role::pending || s.role == NetSession::Role::joining) continue;
+        if (s.role == NetSession::Role::subscriber && s.Pending() == true)
+        {
+            s.stateDelta.Reset(); // skip this tick rather than stall; full state next time
+            continue;
+        }
+        if (s.role == NetSession::Role::trader)
+        {
+            DropReplies(s);
+            s.awaiting = true;
+        }
+        
+        const StateMsg &st = s.stateDelta.Filter(state);
+        bool full = (&st == &state);
+        if (s.binary == true)
+        {
+            if (full == true && builtBin == false) { BinMsg::EncodeState(state, bufBin); builtBin = true; }
+            if (full == false) BinMsg::EncodeState(st, frameDelta);
+            const auto &frame = (full == true ? bufBin : frameDelta);
+            Send(s, frame.data(), frame.size());
+            continue;
+        }
+        
+        if (full == true && builtText == false) { text.Build(state, msgText); builtText = true; }
+        if (full == false) BuildStateText(st, msgDelta);
+        const auto &msg = (full == true ? msgText : msgDelta);
+        if (s.framed == true)
+        {
+            if (full == true && builtFrame == false) { BinMsg::EncodeText(msgText, frameText); builtFrame = true; }
+            if (full == false) BinMsg::EncodeText(msgDelta, frameDelta);
+            const auto &frame = (full == true ? frameText : frameDelta);
+            Send(s, frame.data(), frame.size());
+        }
+        else
+            Send(s, msg.c_str(), msg.size());
+    }
+    Sweep();
+    journal.PushState(state, (builtBin == true ? &bufBin : nullptr));
+    pBroker->latency.Add(TickPhase::send, TickLatency::clock::now() - t1);
+}
+
+// Day boundary message; client replies with an empty line before the first tick of the day
+// /*
+// day <name>
+// */
+// (binary: BinMsg::kMagicDay frame, replied with an empty kMagicReqs frame; framed text: both as kMagicText frames)
+// Sent to subscribers as well regardless of their backlog, and to clients connecting later on the same day
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::SendNewDay(CSTR &name)
+{
+    if (verbose) DisplayString("New day " + name);
+    SetDay(name);
+    dayCrossed = true;
+    journal.PushDay(name);
+    for (auto &ps : sessions)
+    {
+        auto &s = *ps;
+        if (s.role == NetSession::Role::pending) continue;
+        if (s.role == NetSession::Role::trader)
+        {
+            DropReplies(s);
+            s.awaiting = true;
+        }
+        if (s.role == NetSession::Role::joining) s.nDays++;
+        s.stateDelta.Reset();
+        SendDay(s);
+    }
+    Sweep();
+    RecvMsgIn();
 }
 
 template <class TOrder, class TItem>
-int NetServer<TOrder, TItem>::RecvMsgIn()
+void NetServer<TOrder, TItem>::SetDay(CSTR &name)
 {
-    verify((sock_serv != sock_fail) && (sock_conn != sock_fail));
-    bufMsg[0] = '\0';
+    day    = name;
+    msgDay = "/*\nday " + name + "\n*/\n";
+    BinMsg::EncodeText(msgDay, frameDayText);
+    BinMsg::EncodeDay (name,   frameDayBin );
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::SendDay(NetSession &s)
+{
+    if      (s.binary == true) Send(s, frameDayBin .data(), frameDayBin .size());
+    else if (s.framed == true) Send(s, frameDayText.data(), frameDayText.size());
+    else                       Send(s, msgDay.c_str(),      msgDay.size()      );
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::RecvMsgIn()
+{
+    auto t0 = std::chrono::steady_clock::now();
+    auto deadline = t0 + std::chrono::seconds(kTimeRates::secPerTick);
     while (true)
     {
-        memset(bufTCP, 0, kTCPBufSize);
-        if (recv(sock_conn, bufTCP, kTCPBufSize, 0) > 0)
+        bool waiting = false;
+        for (auto &ps : sessions)
         {
-            std::size_t lencat = strlen(bufMsg) + strlen(bufTCP); 
-            if (lencat >= kTCPBufSize) return DisplayString("[Warn] TCP input buffer overflow", true);
-            strcat(bufMsg, bufTCP);
-            if (bufMsg[lencat - 1] == '\n')
-                break;
+            auto &s = *ps;
+            if (s.role != NetSession::Role::trader || s.awaiting == false) continue;
+            int ret = s.NextMsg();
+            if      (ret < 0) Close(s, "[Fail] Invalid frame");
+            else if (ret > 0) s.awaiting = false;
+            else              waiting    = true;
         }
-        else
+        Sweep();
+        if (waiting == false) break;
+        
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (ms <= 0)
         {
-            #ifndef _WIN32
-            if (errno == EAGAIN || errno == EWOULDBLOCK) // timeout
-            #else
-            if (WSAGetLastError() == WSAETIMEDOUT)
-            #endif
+            for (auto &ps : sessions)
             {
-                if (verbose) DisplayString("Timeout during recv");
-                break;
+                if (ps->role != NetSession::Role::trader || ps->awaiting == false) continue;
+                if (verbose) DisplayString("Timeout during recv" + Tag(*ps));
+                ps->awaiting = false;
+            }
+            break;
+        }
+        Serve((int)ms);
+    }
+    pBroker->latency.Add(TickPhase::wait, std::chrono::steady_clock::now() - t0);
+    
+    // traders with a reply, in the order reqs are applied
+    order.clear();
+    for (auto &ps : sessions)
+        if (ps->role == NetSession::Role::trader && ps->ready == true) order.push_back(ps.get());
+    std::size_t nApply = order.size();
+    if (policy == ReqPolicy::first)
+    {
+        auto iFirst = std::find_if(std::begin(sessions), std::end(sessions), [](const std::unique_ptr<NetSession> &ps) { return ps->role == NetSession::Role::trader; });
+        nApply = (order.empty() == false && iFirst != std::end(sessions) && order.front() == iFirst->get() ? 1 : 0);
+    }
+    if (policy == ReqPolicy::rotate && order.empty() == false)
+        std::rotate(std::begin(order), std::begin(order) + (std::ptrdiff_t)((std::size_t)iTick % order.size()), std::end(order));
+    iTick++;
+    
+    for (std::size_t iO = 0; iO < order.size(); iO++)
+    {
+        auto &s = *order[iO];
+        std::size_t len;
+        uint32_t magic;
+        char *msg = s.Msg(len, magic);
+        if (iO < nApply)
+        {
+            if (s.binary == true)
+            {
+                reqs.clear();
+                auto tDecode = TickLatency::clock::now();
+                bool valid = (magic == BinMsg::kMagicReqs && 0 == BinMsg::DecodeReqs(msg, len, reqs));
+                pBroker->latency.Add(TickPhase::parseMsg, TickLatency::clock::now() - tDecode); // ResolveReqs is added by Broker
+                if (valid == false)
+                {
+                    DisplayString("[Warn] Invalid binary req msg" + Tag(s), true);
+                    reqs.clear();
+                }
+                pBroker->ApplyReqs(reqs);
             }
             else
             {
-                if (verbose) DisplayString("Client disconnected");
-                return -1;
+                if (s.framed == true && magic != BinMsg::kMagicText)
+                {
+                    DisplayString("[Warn] Invalid req msg" + Tag(s), true);
+                    msg[0] = '\0';
+                }
+                pBroker->ApplyMsgIn(msg);
             }
         }
+        s.Consume();
     }
-    pBroker->ApplyMsgIn(bufMsg);
-    return 0;
+    if (nApply == 0) pBroker->ApplyReqs(std::vector<ReqMsg>()); // orders are still cleaned up every tick
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::DropReplies(NetSession &s)
+{
+    int ret;
+    while (0 < (ret = s.NextMsg()))
+    {
+        if (verbose) DisplayString("Late reply dropped" + Tag(s));
+        s.Consume();
+    }
+    if (ret < 0) Close(s, "[Fail] Invalid frame");
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Send(NetSession &s, const char *buf, std::size_t len)
+{
+    if (s.sock == sock_fail) return;
+    if (0 != s.Write(buf, len)) Close(s, "Client disconnected");
+    else if (s.Pending() == true && s.shm.Active() == false) poller.Modify(s.sock, true);
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Close(NetSession &s, CSTR &reason)
+{
+    if (s.sock == sock_fail) return;
+    bool isError = (reason.empty() == false && reason[0] == '[');
+    if (reason.empty() == false && (verbose == true || isError == true)) DisplayString(reason + Tag(s), isError);
+    poller.Remove(s.sock);
+    if (s.shm.Active() == true)
+    {
+        if (s.role != NetSession::Role::pending) poller.Remove(s.shm.Bell()); // watched from Handshake
+        s.shm.Close();
+    }
+    close_socket(s.sock);
+    s.sock = sock_fail;
+    if (s.role == NetSession::Role::trader)
+    {
+        nTraders--;
+        lostTrader = true;
+    }
+}
+
+// Subscribers may lag behind the tick loop, with messages still queued or in transit;
+// closing with their replies unread would reset the connection and discard those messages
+// Each subscriber gets EOF after its queue is sent, and is closed when it disconnects in turn (or on timeout)
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Linger(int timeoutMs)
+{
+    auto timeEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true)
+    {
+        bool any = false;
+        for (auto &ps : sessions)
+        {
+            if (ps->role != NetSession::Role::subscriber) continue;
+            any = true;
+            #ifndef _WIN32
+            if (ps->Pending() == false) shutdown(ps->sock, SHUT_WR);
+            #else
+            if (ps->Pending() == false) shutdown(ps->sock, SD_SEND);
+            #endif /* !_WIN32 */
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(timeEnd - std::chrono::steady_clock::now()).count();
+        if (any == false || left <= 0) return;
+        Serve((int)left);
+    }
+}
+
+template <class TOrder, class TItem>
+void NetServer<TOrder, TItem>::Sweep()
+{
+    sessions.erase(std::remove_if(std::begin(sessions), std::end(sessions), [](const std::unique_ptr<NetSession> &ps) { return ps->sock == sock_fail; }),
+                   std::end(sessions));
 }
 
 template <class TOrder, class TItem>
@@ -258,4 +714,4 @@ int NetServer<TOrder, TItem>::DisplayString(CSTR &disp, bool isError, int errno_
 
 }
 
-#endif /* SIBYL_SERVER_NETSERVER_H_ */
\ No newline at end of file
+#endif /* SIBYL_SERVER_NETSERVER_H_ */
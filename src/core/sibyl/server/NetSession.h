@@ -0,0 +1,256 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_NETSESSION_H_
+#define SIBYL_SERVER_NETSESSION_H_
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/socket.h>
+#endif /* !_WIN32 */
+
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+#include "../NetAgent.h"
+#include "../BinMsg.h"
+#include "../TickMsg.h"
+
+namespace sibyl
+{
+
+// A client connection of NetServer: non-blocking socket with its own read & write buffers,
+// and the settings negotiated with the password (see BinMsg.h)
+// With shm active, bytes go through its rings instead and the socket only signals disconnection (see ShmLink.h)
+class NetSession
+{
+public:
+    // pending: password & negotiation tokens not complete yet (see NetServer::Negotiate)
+    // joining: trader connected after the first day boundary; sent the day name, not counted as a trader until it replies
+    // trader: waited for every tick; its reqs are applied (see NetServer::ReqPolicy)
+    // subscriber: read-only; skipped for a tick if it has not taken the previous message yet
+    enum class Role { pending, joining, trader, subscriber };
+
+    int  sock;
+    int  id;   // in the order of connection
+    Role role;
+    bool binary, framed, delta;
+    StateDelta stateDelta;
+    ShmLink    shm;    // attached with the password if the client sent its descriptors
+
+    bool awaiting; // trader: reply for the current message not extracted yet
+    bool ready;    // reply extracted and not consumed yet (see NextMsg)
+    int  nDays;    // joining: day messages not replied yet
+    std::chrono::steady_clock::time_point tConnect; // pending: for the handshake timeout
+
+    // Read all bytes available; returns -1 on disconnection or error
+    // Descriptors sent with the password are attached to shm (Linux only); the socket is read until Handshake
+    int Read();
+
+    // Extract the next complete message received (payload for a framed one) in place; returns 1 if extracted
+    // Sets ready (then Msg returns the message NUL-terminated) until Consume; returns -1 for an invalid frame
+    int   NextMsg();
+    char* Msg    (std::size_t &len, uint32_t &magic); // NUL-terminates in place; call after reading is done
+    void  Consume();
+    char* Input       () { bufIn[lenIn] = '\0'; return bufIn.data() + posIn; } // all input not consumed yet, NUL-terminated
+    std::size_t InputSize() const { return lenIn - posIn; }
+    void  DiscardInput() { posIn = lenIn = 0; ready = false; }
+
+    // Queue bytes to send, sending as much as possible right away; returns -1 on error
+    int  Write(const char *buf, std::size_t len);
+    int  Flush();                                          // send queued bytes; returns -1 on error
+    bool Pending() const { return posOut < bufOut.size(); } // bytes queued
+
+    static int SetNonBlocking(int sock); // returns non-0 to signal error
+
+    NetSession(int sock_, int id_) : sock(sock_), id(id_), role(Role::pending), binary(false), framed(false), delta(false),
+                                     awaiting(false), ready(false), nDays(0), tConnect(std::chrono::steady_clock::now()),
+                                     bufIn(1 << 12), posIn(0), lenIn(0),
+                                     msgBeg(0), msgLen(0), msgMagic(0), posOut(0) {}
+private:
+    std::vector<char> bufIn;  // [posIn, lenIn) not consumed yet
+    std::size_t posIn, lenIn;
+    std::size_t msgBeg, msgLen;
+    uint32_t    msgMagic;     // 0 for unframed text
+    char        saved;        // byte replaced by NUL in Msg
+
+    std::vector<char> bufOut; // [posOut, size) queued
+    std::size_t posOut;
+
+    long RecvSome(char *buf, std::size_t len);
+    long SendSome(const char *buf, std::size_t len);
+    static bool WouldBlock();
+    #ifndef _WIN32
+    constexpr static int kSendFlags = MSG_NOSIGNAL;
+    #else
+    constexpr static int kSendFlags = 0;
+    #endif /* !_WIN32 */
+};
+
+inline int NetSession::Read()
+{
+    if (shm.Active() == true && role != Role::pending) shm.Drain();
+    while (true)
+    {
+        if (posIn == lenIn) posIn = lenIn = 0; // everything consumed
+        if (lenIn + 1 >= bufIn.size() && posIn > 0 && ready == false)
+        {
+            memmove(bufIn.data(), bufIn.data() + posIn, lenIn - posIn);
+            lenIn -= posIn;
+            posIn  = 0;
+        }
+        if (lenIn + 1 >= bufIn.size()) bufIn.resize(bufIn.size() * 2);
+        auto ret = RecvSome(bufIn.data() + lenIn, bufIn.size() - lenIn - 1);
+        if (ret > 0)
+        {
+            lenIn += (std::size_t)ret;
+            continue;
+        }
+        if (ret < 0 && WouldBlock() == true) return 0;
+        return -1; // 0: orderly shutdown by client
+    }
+}
+
+inline int NetSession::NextMsg()
+{
+    if (ready == true) return 1;
+    std::size_t len = lenIn - posIn;
+    if (framed == true)
+    {
+        BinMsg::Header h;
+        if (len < sizeof(h)) return 0;
+        memcpy(&h, bufIn.data() + posIn, sizeof(h));
+        if (BinMsg::IsMagic(h.magic) == false) return -1;
+        if (len - sizeof(h) < h.size) return 0;
+        msgBeg   = posIn + sizeof(h);
+        msgLen   = h.size;
+        msgMagic = h.magic;
+    }
+    else
+    {
+        // unframed text: a message ends where the input ends with '\n' (a packet ending with '\n')
+        if (len == 0 || bufIn[lenIn - 1] != '\n') return 0;
+        msgBeg   = posIn;
+        msgLen   = len;
+        msgMagic = 0;
+    }
+    ready = true;
+    return 1;
+}
+
+inline char* NetSession::Msg(std::size_t &len, uint32_t &magic)
+{
+    verify(ready == true);
+    len   = msgLen;
+    magic = msgMagic;
+    saved = bufIn[msgBeg + msgLen]; // bufIn always has a byte past lenIn
+    bufIn[msgBeg + msgLen] = '\0';
+    return bufIn.data() + msgBeg;
+}
+
+inline void NetSession::Consume()
+{
+    verify(ready == true);
+    bufIn[msgBeg + msgLen] = saved;
+    posIn = msgBeg + msgLen;
+    ready = false;
+}
+
+inline int NetSession::Write(const char *buf, std::size_t len)
+{
+    if (Pending() == false)
+    {
+        bufOut.clear();
+        posOut = 0;
+        while (len > 0)
+        {
+            auto ret = SendSome(buf, len);
+            if (ret <= 0) break;
+            buf += ret;
+            len -= (std::size_t)ret;
+        }
+        if (len == 0) return 0;
+        if (WouldBlock() == false) return -1;
+    }
+    bufOut.insert(std::end(bufOut), buf, buf + len);
+    return 0;
+}
+
+inline int NetSession::Flush()
+{
+    while (Pending() == true)
+    {
+        auto ret = SendSome(bufOut.data() + posOut, bufOut.size() - posOut);
+        if (ret > 0)
+        {
+            posOut += (std::size_t)ret;
+            continue;
+        }
+        return (WouldBlock() == true ? 0 : -1);
+    }
+    return 0;
+}
+
+inline long NetSession::RecvSome(char *buf, std::size_t len)
+{
+    if (shm.Active() == true && role != Role::pending) return shm.Recv(buf, len, false, sock); // password & tokens through sock
+    #ifdef __linux__
+    if (role == Role::pending)
+    {
+        int fds[ShmLink::nFds], nFds;
+        auto ret = ShmLink::RecvFds(sock, buf, len, fds, nFds);
+        if (nFds > 0 && 0 != shm.Attach(fds))
+        {
+            errno = EPROTO;
+            return -1;
+        }
+        return ret;
+    }
+    #endif /* __linux__ */
+    return (long)recv(sock, buf, len, 0);
+}
+
+inline long NetSession::SendSome(const char *buf, std::size_t len)
+{
+    if (shm.Active() == true) return shm.Send(buf, len, false, sock);
+    return (long)send(sock, buf, len, kSendFlags);
+}
+
+inline int NetSession::SetNonBlocking(int sock)
+{
+    #ifndef _WIN32
+    int flags = fcntl(sock, F_GETFL, 0);
+    return (flags < 0 ? -1 : fcntl(sock, F_SETFL, flags | O_NONBLOCK));
+    #else
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode);
+    #endif /* !_WIN32 */
+}
+
+inline bool NetSession::WouldBlock()
+{
+    #ifndef _WIN32
+    return (errno == EAGAIN || errno == EWOULDBLOCK);
+    #else
+    return (WSAGetLastError() == WSAEWOULDBLOCK);
+    #endif /* !_WIN32 */
+}
+
+}
+
+#endif /* SIBYL_SERVER_NETSESSION_H_ */
@@ -22,9 +22,10 @@
 #include <cinttypes>
 #include <mutex>
 #include <iostream>
-#include <type_traits>
+#include <sstream>
 
 #include "../Catalog.h"
+#include "../TickMsg.h"
 #include "../util/DispPrefix.h"
 #include "OrderBook_data.h"
 #include "../ostream_format.h"
@@ -34,8 +35,6 @@
 namespace sibyl
 {
 
-class ItemSim;
-
 template <class TOrder, class TItem>
 class OrderBook : public Catalog<TItem> //  /**/ mutex'd  
 {
@@ -45,7 +44,14 @@ public:
     std::recursive_mutex items_mutex; // use when modifying items from an external class
 
 /**/CSTR& BuildMsgOut      (bool addMyOrd);
+/**/const StateMsg& BuildState(bool addMyOrd); // structured equivalent of BuildMsgOut
 /**/void  RemoveEmptyOrders(); // called every new tick
+    
+    // code lookup for requests (code need not be null-terminated); end of items if not found
+    it_itm_t<TItem> FindCode(const char *code, std::size_t len) {
+        ItemId id = this->items.Id(code, len);
+        return (id == kNoItem ? std::end(this->items) : std::begin(this->items) + id);
+    }
     const // correct/split a single UnnamedReq based on most up-to-date state
 /**/std::vector<NamedReq<TOrder, TItem>>& AllotReq(UnnamedReq<TItem> req);
     
@@ -54,82 +60,104 @@ public:
 /**/void             ApplyTrade (it_itm_t<TItem> iItems, it_ord_t<TOrder> iOrd, PQ  pq); // Simulation: insert->trade for instant orders
 /**/void             ApplyCancel(it_itm_t<TItem> iItems, it_ord_t<TOrder> iOrd, INT q );
     
+    // Changes made by ApplyTrade outside of the traded item (bal, sum, verbose output),
+    // kept aside so that trades on disjoint sets of items may be applied from different threads
+    struct TradeLedger {
+        INT64 bal; // delta
+        decltype(Catalog<TItem>::sum) sum; // deltas
+        std::ostringstream log;
+        std::vector<std::pair<std::size_t, INT64>> logBal; // (position in log, bal delta) to be printed as fmt_bal
+        void Clear() { bal = 0; sum = {0, 0, 0, {}}; log.str(STR()); logBal.clear(); }
+        TradeLedger() { Clear(); }
+    };
+    // Caller should hold items_mutex and no other thread may touch iItems
+    void ApplyTrade (it_itm_t<TItem> iItems, it_ord_t<TOrder> iOrd, PQ pq, TradeLedger &ledger);
+    // Merging ledgers in the order trades were made gives the same result as serial ApplyTrade calls
+/**/void MergeLedger(TradeLedger &ledger); // clears ledger
+    
     OrderBook() : verbose(false) {}
 private:
     bool verbose;
+    
+    void ApplyTrade(it_itm_t<TItem> iItems, it_ord_t<TOrder> iOrd, PQ pq, INT64 &bal, decltype(Catalog<TItem>::sum) &sum,
+                    std::ostream &os, std::vector<std::pair<std::size_t, INT64>> *pLogBal);
+
+    // shared by BuildMsgOut & BuildState
+    std::array<PQ, idx::szTb> MergeTbr(const TItem &i, bool addMyOrd) const; // tbr with own orders added if addMyOrd
+    void MergeOrd(const TItem &i, std::vector<PQ> &ordm) const; // orders merged per price (+ for buy, - for sell)
 
     std::vector<NamedReq<TOrder, TItem>> nreq;
     STR msg;
-
-    // Note: assume that the lock is already held before calling GetDep
-    // GetDep returns 0 in general (i.e., no depletion)
-    template <class T = TItem>
-    typename std::enable_if<!std::is_same<T, ItemSim>::value, INT>::type
-    GetDep(const T& i, OrdType ordType) {
-        return 0;
-    }
-
-    // specialization for Simulation (in particular, Simulation_dep)
-    template <class T = TItem>
-    typename std::enable_if< std::is_same<T, ItemSim>::value, INT>::type
-    GetDep(const T& i, OrdType ordType) {
-        switch (ordType) {
-            case OrdType::sell: return i.depS0;
-            case OrdType::buy : return i.depB0;
-            default           : return 0;
-        }
-    }
+    StateText text; // fragments of items unchanged since the last BuildMsgOut are reused
+    StateMsg state;
+    std::vector<PQ> ordm;
 };
 
 template <class TOrder, class TItem>
 CSTR& OrderBook<TOrder, TItem>::BuildMsgOut(bool addMyOrd)
 {
-    static char buf[1 << 12]; // sprintf line buf
-    
+    std::lock_guard<std::recursive_mutex> lock(items_mutex);
+    text.Build(BuildState(addMyOrd), msg);
+    return msg;
+}
+
+template <class TOrder, class TItem>
+const StateMsg& OrderBook<TOrder, TItem>::BuildState(bool addMyOrd)
+{
     std::lock_guard<std::recursive_mutex> lock(items_mutex);
     
-    msg.clear();
-    
-    // /*\n
-    // b time bal sum.buy sum.sell sum.feetax
-    sprintf(buf, "/*\nb %d %" PRId64 " %" PRId64 " %" PRId64 " %" PRId64 "\n", this->time.load(), this->bal, this->sum.buy, this->sum.sell, this->sum.feetax);
-    msg.append(buf);
-    
-    // s sum.tck_orig.{bal q ord}[0..<(idx::szTb + 2)] (interleaved ordering)
-    msg.append("s");
-    for (const auto &s : this->sum.tck_orig) {
-        sprintf(buf, " %" PRId64 " %" PRId64 " %" PRId64, s.bal, s.q, s.evt);
-        msg.append(buf);
-    }
-    msg.append("\n");
-    
-    // k kospi200
-    sprintf(buf, "k %.5e\n", ELW<TItem>::kospi200);
-    msg.append(buf);
-    // bool existELW = false;
-    // for (const auto &code_pItem : this->items)
-    //     if (code_pItem.second->Type() == SecType::ELW) { existELW = true; break; }
-    // if (existELW == true)
-    // {
-    //     if (ELW<TItem>::kospi200 <= 0.0f)
-    //         std::cerr << dispPrefix << "OrderBook::BuildMsgOut: Nonpositive KOSPI200 index " << ELW<TItem>::kospi200 << std::endl; 
-    //     sprintf(buf, "k %.5e\n", ELW<TItem>::kospi200);
-    //     msg.append(buf);
-    // }
+    state.time     = this->time;
+    state.bal      = this->bal;
+    state.sum      = this->sum;
+    state.kospi200 = ELW<TItem>::kospi200;
     
-    // Individual items (d, (e), (n), o)
+    state.items.resize(this->items.size());
+    auto iS = std::begin(state.items);
     for (const auto &code_pItem : this->items)
     {
         const auto &i = *code_pItem.second;
+        auto &s = *iS++;
+        
+        s.code = code_pItem.first;
+        s.type = i.Type();
+        s.pr   = i.pr;
+        s.qr   = i.qr;
+        s.tbr  = MergeTbr(i, addMyOrd);
+        s.tbrMask = ItemMsg::kTbrAll;
+        s.cnt  = i.cnt;
+        MergeOrd(i, s.ord);
+        
+        if (s.type == SecType::ELW)
+        {
+            const auto &i = *static_cast<ELW<TItem>*>(code_pItem.second.get()); // reference as ELW<TItem>
+            s.iCP    = (i.CallPut() == OptType::call) - (i.CallPut() == OptType::put);
+            s.expiry = i.Expiry();
+            std::copy(std::begin(i.thr), std::end(i.thr), std::begin(s.thr));
+        }
         
-        std::array<PQ, idx::szTb> tbm = i.tbr; // tb_merged
-        if (true == addMyOrd)
+        if (s.type == SecType::ETF)
         {
-            INT ps0 = i.Tck2P(-1, OrdType::sell); // unique in tb.p
-            INT pb0 = i.Tck2P(-1, OrdType::buy ); // unique in tb.p
-            for (auto iT = std::begin(tbm); iT != std::end(tbm); iT++)
+            const auto &i = *static_cast<ETF<TItem>*>(code_pItem.second.get()); // reference as ETF<TItem>
+            s.devNAV = i.devNAV;
+        }
+    }
+    
+    return state;
+}
+
+template <class TOrder, class TItem>
+std::array<PQ, idx::szTb> OrderBook<TOrder, TItem>::MergeTbr(const TItem &i, bool addMyOrd) const
+{
+    std::array<PQ, idx::szTb> tbm = i.tbr; // tb_merged
+    if (true == addMyOrd)
+    {
+        INT ps0 = i.Tck2P(-1, OrdType::sell); // unique in tb.p
+        INT pb0 = i.Tck2P(-1, OrdType::buy ); // unique in tb.p
+        for (auto iT = std::begin(tbm); iT != std::end(tbm); iT++)
+        {
+            std::ptrdiff_t idx = iT - std::begin(tbm);
+            if (i.ord.empty() == false) // most items hold no own orders
             {
-                std::ptrdiff_t idx = iT - std::begin(tbm);
                 const auto &first_last = i.ord.equal_range(iT->p);
                 for (auto iO = first_last.first; iO != first_last.second; iO++)
                 {
@@ -138,74 +166,35 @@ CSTR& OrderBook<TOrder, TItem>::BuildMsgOut(bool addMyOrd)
                          (idx >= idx::pb1 && o.type == OrdType::buy ) )
                         iT->q += o.q;
                 }
-                if (iT->p == ps0) iT->q = std::max(iT->q - GetDep(i, OrdType::sell), 0);
-                if (iT->p == pb0) iT->q = std::max(iT->q - GetDep(i, OrdType::buy ), 0);
             }
+            if (iT->p == ps0) iT->q = std::max(iT->q - i.Dep(OrdType::sell), 0);
+            if (iT->p == pb0) iT->q = std::max(iT->q - i.Dep(OrdType::buy ), 0);
         }
-        
-        // d code pr qr tbr.p[0..<idx::szTb] tbr.q[0..<idx::szTb]
-        sprintf(buf, "d %s %.5e %" PRId64 " %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d %d\n",
-                            code_pItem.first.c_str(), i.pr, i.qr,
-                            tbm[ 0].p, tbm[ 1].p, tbm[ 2].p, tbm[ 3].p, tbm[ 4].p,
-                            tbm[ 5].p, tbm[ 6].p, tbm[ 7].p, tbm[ 8].p, tbm[ 9].p, 
-                            tbm[10].p, tbm[11].p, tbm[12].p, tbm[13].p, tbm[14].p,
-                            tbm[15].p, tbm[16].p, tbm[17].p, tbm[18].p, tbm[19].p,
-                            tbm[ 0].q, tbm[ 1].q, tbm[ 2].q, tbm[ 3].q, tbm[ 4].q,
-                            tbm[ 5].q, tbm[ 6].q, tbm[ 7].q, tbm[ 8].q, tbm[ 9].q, 
-                            tbm[10].q, tbm[11].q, tbm[12].q, tbm[13].q, tbm[14].q,
-                            tbm[15].q, tbm[16].q, tbm[17].q, tbm[18].q, tbm[19].q );
-        msg.append(buf);
-        
-        if (i.Type() == SecType::ELW)
-        {
-            auto &i = *static_cast<ELW<TItem>*>(code_pItem.second.get()); // reference as ELW<TItem>
-            int CP = (i.CallPut() == OptType::call) - (i.CallPut() == OptType::put); 
-            sprintf(buf, "e %s %+d %d %.5e %.5e %.5e %.5e %.5e %.5e %.5e %.5e\n",
-                                code_pItem.first.c_str(), CP, i.Expiry(),
-                                i.thr[0], i.thr[1], i.thr[2], i.thr[3], i.thr[4], i.thr[5], i.thr[6], i.thr[7]);
-            msg.append(buf);
-        }
-        
-        if (i.Type() == SecType::ETF)
-        {
-            auto &i = *static_cast<ETF<TItem>*>(code_pItem.second.get()); // reference as ETF<TItem>
-            sprintf(buf, "n %s %.5e\n", code_pItem.first.c_str(), i.devNAV);
-            msg.append(buf);
-        }
-        
-        sprintf(buf, "o %s %d", code_pItem.first.c_str(), i.cnt);
-        msg.append(buf);
-        
-        // Merge orders of the same price and list (+ for buy, - for sell)
-        std::vector<PQ> ordm; // ord_merged
-        for (auto iO = std::begin(i.ord); iO != std::end(i.ord);)
-        {
-            const auto &first_last = i.ord.equal_range(iO->first);
-            auto MergeAndAdd = [&](OrdType type) {
-                PQ pq;
-                pq.p = iO->first;
-                for (auto iP = first_last.first; iP != first_last.second; iP++) {
-                    if (iP->second.type == type && iP->second.q > 0)
-                        pq.q += iP->second.q;
-                }
-                if (type == OrdType::sell) pq.q = -pq.q;
-                if (pq.q != 0) ordm.push_back(pq);
-            };
-            MergeAndAdd(OrdType::buy );
-            MergeAndAdd(OrdType::sell);
-            iO = first_last.second;
-        }
+    }
+    return tbm;
+}
 
-        for (const auto &pq : ordm)        
-        {
-            sprintf(buf, " %d %+d", pq.p, pq.q);
-            msg.append(buf);
-        }
-        msg.append("\n");
+template <class TOrder, class TItem>
+void OrderBook<TOrder, TItem>::MergeOrd(const TItem &i, std::vector<PQ> &ordm) const
+{
+    ordm.clear();
+    for (auto iO = std::begin(i.ord); iO != std::end(i.ord);)
+    {
+        const auto &first_last = i.ord.equal_range(iO->first);
+        auto MergeAndAdd = [&](OrdType type) {
+            PQ pq;
+            pq.p = iO->first;
+            for (auto iP = first_last.first; iP != first_last.second; iP++) {
+                if (iP->second.type == type && iP->second.q > 0)
+                    pq.q += iP->second.q;
+            }
+            if (type == OrdType::sell) pq.q = -pq.q;
+            if (pq.q != 0) ordm.push_back(pq);
+        };
+        MergeAndAdd(OrdType::buy );
+        MergeAndAdd(OrdType::sell);
+        iO = first_last.second;
     }
-    msg.append("*/\n");
-    
-    return msg;
 }
 
 template <class TOrder, class TItem>
@@ -331,8 +320,8 @@ const std::vector<NamedReq<TOrder, TItem>>& OrderBook<TOrder, TItem>::AllotReq(U
                 if (skip == false)
                 {
                     auto first_last = i.ord.equal_range(req.p);
-                    typename std::multimap<INT, TOrder>::reverse_iterator rBeg(first_last.second);
-                    typename std::multimap<INT, TOrder>::reverse_iterator rEnd(first_last.first );
+                    typename OrderLadder<TOrder>::reverse_iterator rBeg(first_last.second);
+                    typename OrderLadder<TOrder>::reverse_iterator rEnd(first_last.first );
                     for (auto riO = rBeg; riO != rEnd; riO++)
                     {
                         const auto &o = riO->second;
@@ -460,12 +449,64 @@ template <class TOrder, class TItem>
 void OrderBook<TOrder, TItem>::ApplyTrade (it_itm_t<TItem> iItems, it_ord_t<TOrder> iOrd, PQ pq)
 {
     std::lock_guard<std::recursive_mutex> lock(items_mutex);
+    ApplyTrade(iItems, iOrd, pq, this->bal, this->sum, std::cout, nullptr);
+}
+
+template <class TOrder, class TItem>
+void OrderBook<TOrder, TItem>::ApplyTrade (it_itm_t<TItem> iItems, it_ord_t<TOrder> iOrd, PQ pq, TradeLedger &ledger)
+{
+    ApplyTrade(iItems, iOrd, pq, ledger.bal, ledger.sum, ledger.log, &ledger.logBal);
+}
+
+template <class TOrder, class TItem>
+void OrderBook<TOrder, TItem>::MergeLedger(TradeLedger &ledger)
+{
+    std::lock_guard<std::recursive_mutex> lock(items_mutex);
+    
+    if (verbose == true)
+    {
+        const STR &log = ledger.log.str();
+        std::size_t pos = 0;
+        for (const auto &pos_bal : ledger.logBal)
+        {
+            std::cout.write(log.data() + pos, (std::streamsize)(pos_bal.first - pos));
+            std::cout << fmt_bal(this->bal + pos_bal.second);
+            pos = pos_bal.first;
+        }
+        std::cout.write(log.data() + pos, (std::streamsize)(log.size() - pos));
+        if (log.empty() == false) std::cout.flush();
+    }
+    
+    this->bal        += ledger.bal;
+    this->sum.buy    += ledger.sum.buy;
+    this->sum.sell   += ledger.sum.sell;
+    this->sum.feetax += ledger.sum.feetax;
+    for (std::size_t idx = 0; idx < this->sum.tck_orig.size(); idx++)
+    {
+        this->sum.tck_orig[idx].bal += ledger.sum.tck_orig[idx].bal;
+        this->sum.tck_orig[idx].q   += ledger.sum.tck_orig[idx].q;
+        this->sum.tck_orig[idx].evt += ledger.sum.tck_orig[idx].evt;
+    }
+    
+    ledger.Clear();
+}
+
+template <class TOrder, class TItem>
+void OrderBook<TOrder, TItem>::ApplyTrade (it_itm_t<TItem> iItems, it_ord_t<TOrder> iOrd, PQ pq, INT64 &bal, decltype(Catalog<TItem>::sum) &sum,
+                                           std::ostream &os, std::vector<std::pair<std::size_t, INT64>> *pLogBal)
+{
+    // bal is printed at merge time if kept in a ledger
+    auto PutBal = [&](std::ostream &os_) -> std::ostream& {
+        if (pLogBal == nullptr) return os_ << fmt_bal(bal);
+        pLogBal->push_back(std::make_pair((std::size_t)os_.tellp(), bal));
+        return os_;
+    };
     
     if (pq.q > 0)
     {
         auto &i = *iItems->second;
         auto &o = iOrd->second;
-        if (verbose == true) std::cout << dispPrefix << "<Trade>  " << o.type << " " << fmt_code(iItems->first) << " " << fmt_price(o.p) << " " << fmt_quant(o.q) << " [-] " << fmt_price(pq.p) << " " << fmt_quant(pq.q) << " = " << fmt_quant(o.q - pq.q) << std::endl; 
+        if (verbose == true) os << dispPrefix << "<Trade>  " << o.type << " " << fmt_code(iItems->first) << " " << fmt_price(o.p) << " " << fmt_quant(o.q) << " [-] " << fmt_price(pq.p) << " " << fmt_quant(pq.q) << " = " << fmt_quant(o.q - pq.q) << std::endl; 
         if (o.type == OrdType::buy)
         {
             if (o.p < pq.p)
@@ -475,25 +516,25 @@ void OrderBook<TOrder, TItem>::ApplyTrade (it_itm_t<TItem> iItems, it_ord_t<TOrd
             
             if (o.p > pq.p) // if traded price was lower than requested
             {
-                if (verbose == true) std::cout << dispPrefix << "    [bal]: " << fmt_bal(this->bal) << " [+] " << fmt_price(o.p - pq.p) << " * " << fmt_quant(pq.q) << " * (1 + f_b) = ";
+                if (verbose == true) PutBal(os << dispPrefix << "    [bal]: ") << " [+] " << fmt_price(o.p - pq.p) << " * " << fmt_quant(pq.q) << " * (1 + f_b) = ";
                 INT64 raw = (INT64)(o.p - pq.p) * pq.q;
-                this->bal += raw + i.BFee(raw);
-                if (verbose == true) std::cout << fmt_bal(this->bal) << std::endl;
+                bal += raw + i.BFee(raw);
+                if (verbose == true) PutBal(os) << std::endl;
             }
             
-            if (verbose == true) std::cout << dispPrefix << "    [cnt]: " << fmt_code(iItems->first) << " " << fmt_quant(i.cnt) << " [+] " << fmt_quant(pq.q) << " = ";
+            if (verbose == true) os << dispPrefix << "    [cnt]: " << fmt_code(iItems->first) << " " << fmt_quant(i.cnt) << " [+] " << fmt_quant(pq.q) << " = ";
             i.cnt += pq.q;
-            if (verbose == true) std::cout << fmt_quant(i.cnt) << std::endl;
+            if (verbose == true) os << fmt_quant(i.cnt) << std::endl;
             
             INT64 raw = (INT64)pq.p * pq.q;
-            this->sum.buy    += raw;
-            this->sum.feetax += i.BFee(raw);
+            sum.buy    += raw;
+            sum.feetax += i.BFee(raw);
             
             if ((o.tck_orig >= -1) && (o.tck_orig < idx::tckN)) {
                 int idx = (o.tck_orig != -1 ? idx::pb1 + o.tck_orig : this->idxTckOrigB0);
-                this->sum.tck_orig[(std::size_t)idx].bal += raw;// + i.BFee(raw);
-                this->sum.tck_orig[(std::size_t)idx].q   += pq.q;
-                this->sum.tck_orig[(std::size_t)idx].evt += 1;
+                sum.tck_orig[(std::size_t)idx].bal += raw;// + i.BFee(raw);
+                sum.tck_orig[(std::size_t)idx].q   += pq.q;
+                sum.tck_orig[(std::size_t)idx].evt += 1;
             }
         } else
         if (o.type == OrdType::sell)
@@ -503,19 +544,19 @@ void OrderBook<TOrder, TItem>::ApplyTrade (it_itm_t<TItem> iItems, it_ord_t<TOrd
                 std::cerr << dispPrefix << "OrderBook::ApplyTrade: " << fmt_code(iItems->first) << " o.p " << fmt_price(o.p) << " > delta.p " << fmt_price(pq.p) << " for sell order found" << std::endl;
             }
             
-            if (verbose == true) std::cout << dispPrefix << "    [bal]: " << fmt_bal(this->bal) << " [+] " << fmt_price(pq.p) << " * " << fmt_quant(pq.q) << " * (1 - f_s) = ";
+            if (verbose == true) PutBal(os << dispPrefix << "    [bal]: ") << " [+] " << fmt_price(pq.p) << " * " << fmt_quant(pq.q) << " * (1 - f_s) = ";
             INT64 raw = (INT64)pq.p * pq.q;
-            this->bal += raw - i.SFee(raw);
-            if (verbose == true) std::cout << fmt_bal(this->bal) << std::endl;
+            bal += raw - i.SFee(raw);
+            if (verbose == true) PutBal(os) << std::endl;
             
-            this->sum.sell   += raw;
-            this->sum.feetax += i.SFee(raw);
+            sum.sell   += raw;
+            sum.feetax += i.SFee(raw);
             
             if ((o.tck_orig >= -1) && (o.tck_orig < idx::tckN)) {
                 int idx = (o.tck_orig != -1 ? idx::ps1 - o.tck_orig : this->idxTckOrigS0);
-                this->sum.tck_orig[(std::size_t)idx].bal += raw;// - i.SFee(raw);
-                this->sum.tck_orig[(std::size_t)idx].q   += pq.q;
-                this->sum.tck_orig[(std::size_t)idx].evt += 1;
+                sum.tck_orig[(std::size_t)idx].bal += raw;// - i.SFee(raw);
+                sum.tck_orig[(std::size_t)idx].q   += pq.q;
+                sum.tck_orig[(std::size_t)idx].evt += 1;
             }
         }
         o.q -= pq.q;
@@ -17,9 +17,8 @@
 #ifndef SIBYL_SERVER_ORDERBOOK_DATA_H_
 #define SIBYL_SERVER_ORDERBOOK_DATA_H_
 
-#include <map>
-
 #include "../Security.h"
+#include "../ItemTable.h"
 #include "../ReqType.h"
 
 namespace sibyl
@@ -38,12 +37,16 @@ template <class TOrder>
 class Item : public Security<TOrder>
 {
 public:
+    // Quantity at ps0/pb0 already taken by own trades but still shown in tbr (see ItemSim)
+    // Hidden by derived classes as needed; called on the exact item type, hence non-virtual
+    INT Dep(OrdType type) const { return 0; }
+    
     virtual ~Item() {}
 };
 
-// shorthand for Catalog.items's iterator
+// shorthand for Catalog.items's iterator (it - begin of items is the ItemId)
 template <class TItem>
-using it_itm_t = typename std::map<STR, std::unique_ptr<TItem>>::iterator;
+using it_itm_t = typename ItemTable<TItem>::iterator;
 
 template <class TItem>
 class UnnamedReq
@@ -59,7 +62,7 @@ public:
 
 // shorthand for Security.ord's iterator
 template <class TOrder>
-using it_ord_t = typename std::multimap<INT, TOrder>::iterator;
+using it_ord_t = typename OrderLadder<TOrder>::iterator;
 
 template <class TOrder, class TItem>
 class NamedReq
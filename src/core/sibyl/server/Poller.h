@@ -0,0 +1,170 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_POLLER_H_
+#define SIBYL_SERVER_POLLER_H_
+
+#if defined __linux__
+    #include <sys/epoll.h>
+    #include <unistd.h>
+#elif !defined _WIN32
+    #include <poll.h>
+#else
+    #include <winsock2.h>
+#endif
+
+#include <vector>
+#include <algorithm>
+
+namespace sibyl
+{
+
+// Readiness notification on the sockets of NetServer (level-triggered)
+// epoll on Linux, poll (WSAPoll) elsewhere
+class Poller
+{
+public:
+    struct Event {
+        int  sock;
+        bool in;  // readable (or a pending connection on a listening socket)
+        bool out; // writable
+        bool err; // error or hang-up
+    };
+
+    int  Add   (int sock);           // watch for input; returns non-0 to signal error
+    void Modify(int sock, bool out); // watch for output as well if out
+    void Remove(int sock);
+
+    // Block up to timeoutMs (-1: indefinitely) until any socket is ready
+    const std::vector<Event>& Wait(int timeoutMs);
+
+    Poller();
+    ~Poller();
+    Poller           (const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+private:
+    std::vector<Event> events;
+#if defined __linux__
+    int fdEpoll;
+    std::vector<struct epoll_event> evEpoll;
+#else
+    #ifdef _WIN32
+    typedef WSAPOLLFD pollfd_t;
+    #else
+    typedef struct pollfd pollfd_t;
+    #endif
+    std::vector<pollfd_t> fds;
+#endif
+};
+
+#if defined __linux__
+
+inline Poller::Poller() : fdEpoll(epoll_create1(0)) {}
+
+inline Poller::~Poller() { if (fdEpoll >= 0) close(fdEpoll); }
+
+inline int Poller::Add(int sock)
+{
+    struct epoll_event ev = {};
+    ev.events  = EPOLLIN;
+    ev.data.fd = sock;
+    if (0 != epoll_ctl(fdEpoll, EPOLL_CTL_ADD, sock, &ev)) return -1;
+    evEpoll.resize(evEpoll.size() + 1); // room for an event per socket watched
+    return 0;
+}
+
+inline void Poller::Modify(int sock, bool out)
+{
+    struct epoll_event ev = {};
+    ev.events  = EPOLLIN | (out == true ? EPOLLOUT : 0);
+    ev.data.fd = sock;
+    epoll_ctl(fdEpoll, EPOLL_CTL_MOD, sock, &ev);
+}
+
+inline void Poller::Remove(int sock)
+{
+    struct epoll_event ev = {}; // non-null for old kernels
+    if (0 == epoll_ctl(fdEpoll, EPOLL_CTL_DEL, sock, &ev) && evEpoll.size() > 1) evEpoll.pop_back(); // epoll_wait needs room for one
+}
+
+inline const std::vector<Poller::Event>& Poller::Wait(int timeoutMs)
+{
+    events.clear();
+    int n = epoll_wait(fdEpoll, evEpoll.data(), (int)evEpoll.size(), timeoutMs);
+    for (int i = 0; i < n; i++)
+    {
+        const auto &ev = evEpoll[(std::size_t)i];
+        events.push_back({ ev.data.fd,
+                           (ev.events & EPOLLIN ) != 0,
+                           (ev.events & EPOLLOUT) != 0,
+                           (ev.events & (EPOLLERR | EPOLLHUP)) != 0 });
+    }
+    return events;
+}
+
+#else
+
+inline Poller::Poller() {}
+
+inline Poller::~Poller() {}
+
+inline int Poller::Add(int sock)
+{
+    pollfd_t fd = {};
+    fd.fd     = sock;
+    fd.events = POLLIN;
+    fds.push_back(fd);
+    return 0;
+}
+
+inline void Poller::Modify(int sock, bool out)
+{
+    for (auto &fd : fds)
+        if ((int)fd.fd == sock) fd.events = POLLIN | (out == true ? POLLOUT : 0);
+}
+
+inline void Poller::Remove(int sock)
+{
+    fds.erase(std::remove_if(std::begin(fds), std::end(fds), [sock](const pollfd_t &fd) { return (int)fd.fd == sock; }),
+              std::end(fds));
+}
+
+inline const std::vector<Poller::Event>& Poller::Wait(int timeoutMs)
+{
+    events.clear();
+    #ifdef _WIN32
+    int n = WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMs);
+    #else
+    int n = poll(fds.data(), (nfds_t)fds.size(), timeoutMs);
+    #endif
+    for (const auto &fd : fds)
+    {
+        if (n <= 0) break;
+        if (fd.revents == 0) continue;
+        events.push_back({ (int)fd.fd,
+                           (fd.revents & POLLIN ) != 0,
+                           (fd.revents & POLLOUT) != 0,
+                           (fd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0 });
+        n--;
+    }
+    return events;
+}
+
+#endif /* __linux__ */
+
+}
+
+#endif /* SIBYL_SERVER_POLLER_H_ */
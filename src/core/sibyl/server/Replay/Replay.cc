@@ -0,0 +1,106 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "Replay.h"
+
+namespace sibyl
+{
+
+int Replay::Open(CSTR &path, int timeFrom)
+{
+    if (0 != journal.Open(path)) return -1;
+    if (timeFrom > kTimeBounds::null && 0 != journal.Seek(timeFrom))
+    {
+        std::cerr << "Replay: no state at or after " << timeFrom << " in the index of " << path << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int Replay::AdvanceTick()
+{
+    uint32_t    magic;
+    const char *payload;
+    std::size_t size;
+    int ret = journal.Next(magic, payload, size);
+    if (ret < 0) std::cerr << "Replay: invalid journal; stopped after " << nTicks << " ticks" << std::endl;
+    if (ret <= 0) return -1;
+    
+    if (magic == BinMsg::kMagicDay)
+    {
+        if (0 != BinMsg::DecodeDay(payload, size, nameNext)) return -1;
+        dayNext = true;
+        return -1;
+    }
+    if (magic != BinMsg::kMagicState || 0 != BinMsg::DecodeState(payload, size, state))
+    {
+        std::cerr << "Replay: invalid frame; stopped after " << nTicks << " ticks" << std::endl;
+        return -1;
+    }
+    SyncItems();
+    nTicks++;
+    return 0;
+}
+
+CSTR& Replay::BuildMsgOut()
+{
+    text.Build(state, msg);
+    return msg;
+}
+
+const StateMsg& Replay::BuildState()
+{
+    return state;
+}
+
+int Replay::NextDay(STR &name)
+{
+    if (dayNext == false) return -1;
+    dayNext = false;
+    name    = nameNext;
+    
+    // codes of the next day are synced from its first state; none of this day's are served anymore
+    std::lock_guard<std::recursive_mutex> lock(orderbook.items_mutex);
+    orderbook.items.clear();
+    return 0;
+}
+
+void Replay::SyncItems()
+{
+    std::lock_guard<std::recursive_mutex> lock(orderbook.items_mutex);
+    orderbook.time = state.time;
+    orderbook.bal  = state.bal;
+    ELW<Item<Order>>::kospi200 = state.kospi200;
+    for (const auto &s : state.items)
+    {
+        auto &p = orderbook.items[s.code];
+        if (p == nullptr || p->Type() != s.type)
+        {
+            if      (s.type == SecType::ELW) p.reset(new ELW<Item<Order>>);
+            else if (s.type == SecType::ETF) p.reset(new ETF<Item<Order>>);
+            else                             p.reset(new KOSPI<Item<Order>>);
+        }
+        auto &i = *p;
+        i.pr  = s.pr;
+        i.qr  = s.qr;
+        i.tbr = s.tbr;
+        i.cnt = s.cnt;
+        if (s.type == SecType::ELW)
+            static_cast<ELW<Item<Order>>&>(i).SetInfo((s.iCP > 0 ? OptType::call : OptType::put), s.expiry);
+    }
+}
+
+}
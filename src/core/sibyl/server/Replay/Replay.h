@@ -0,0 +1,58 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_REPLAY_REPLAY_H_
+#define SIBYL_SERVER_REPLAY_REPLAY_H_
+
+#include "../Broker.h"
+#include "../Journal.h"
+
+namespace sibyl
+{
+
+// Broker serving the states of a journal (see Journal.h) in place of a market, as fast as clients reply
+// Reqs are parsed and allotted against the recorded state, but never executed (nothing to trade with);
+// balances, counts and orders are as recorded
+class Replay : public Broker<Order, Item<Order>>
+{
+public:
+    int Open(CSTR &path, int timeFrom = kTimeBounds::null); // returns non-0 to signal error
+    
+    int   AdvanceTick() override; // next state; non-0 at a day boundary or the end
+    CSTR& BuildMsgOut() override;
+    const StateMsg& BuildState() override;
+    int   NextDay(STR &name) override;
+    void  OnExit() override {}
+    
+    int Ticks() const { return nTicks; } // states served
+    
+    Replay() : dayNext(false), nTicks(0) {}
+private:
+    int ExecuteNamedReq(NamedReq<Order, Item<Order>> req) override { return 0; }
+    void SyncItems(); // orderbook to the state (codes, prices & table)
+    
+    JournalReader journal;
+    StateMsg state;
+    STR      msg;
+    StateText text;
+    STR      nameNext; // of the day frame read by AdvanceTick
+    bool     dayNext;
+    int      nTicks;
+};
+
+}
+
+#endif /* SIBYL_SERVER_REPLAY_REPLAY_H_ */
@@ -0,0 +1,151 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "BinData.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace sibyl
+{
+
+static const char kBinMagic[4] = { 'S', 'B', 'D', 'F' };
+
+bool BinData::open(CSTR &filename)
+{
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) return false; // silently fail; caller falls back to text
+
+    struct stat sFile;
+    if (-1 == fstat(fd, &sFile) || (std::size_t)sFile.st_size < sizeof(BinHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    szMap = (std::size_t)sFile.st_size;
+    pMap  = mmap(nullptr, szMap, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // mapping stays valid
+    if (pMap == MAP_FAILED)
+    {
+        pMap = nullptr;
+        return false;
+    }
+    madvise(pMap, szMap, MADV_SEQUENTIAL);
+
+    const auto &hdr = *static_cast<const BinHeader*>(pMap);
+    bool valid = (0 == memcmp(hdr.magic, kBinMagic, sizeof(kBinMagic))) && (hdr.version == kVersion);
+    if (valid == true)
+    {
+        kind  = static_cast<BinKind>(hdr.kind);
+        elem  = static_cast<BinElem>(hdr.elem);
+        nRows = (std::size_t)hdr.nRows;
+        nCols = (std::size_t)hdr.nCols;
+
+        const char *pc  = static_cast<const char*>(pMap);
+        std::size_t off = Align8(sizeof(BinHeader));
+        std::size_t szCol = Align8(ElemSize(elem) * nRows);
+        if ( ElemSize(elem) == 0 ||
+             off + Align8(sizeof(int32_t) * nRows) + nCols * szCol > szMap )
+            valid = false;
+        else
+        {
+            pTime = reinterpret_cast<const int32_t*>(pc + off);
+            off  += Align8(sizeof(int32_t) * nRows);
+            pCol.resize(nCols);
+            for (auto &p : pCol)
+            {
+                p    = pc + off;
+                off += szCol;
+            }
+        }
+    }
+
+    if (valid == false)
+    {
+        std::cerr << "BinData.open: " << filename << " invalid format or version" << std::endl;
+        close();
+    }
+    return valid;
+}
+
+void BinData::close()
+{
+    if (pMap != nullptr) munmap(pMap, szMap);
+    pMap  = nullptr;
+    szMap = 0;
+    kind  = BinKind::null;
+    elem  = BinElem::null;
+    nRows = nCols = 0;
+    pTime = nullptr;
+    pCol.clear();
+}
+
+bool BinData::Write(CSTR &filename, BinKind kind, BinElem elem,
+                    const std::vector<int32_t> &time, const std::vector<std::vector<double>> &cols)
+{
+    for (const auto &col : cols) verify(col.size() == time.size());
+
+    FILE *pf = fopen(filename.c_str(), "wb");
+    if (pf == nullptr) return false;
+
+    const char zeros[8] = {};
+    auto Pad = [&](std::size_t n) { return fwrite(zeros, 1, Align8(n) - n, pf) == Align8(n) - n; };
+
+    BinHeader hdr;
+    memcpy(hdr.magic, kBinMagic, sizeof(kBinMagic));
+    hdr.version  = kVersion;
+    hdr.kind     = static_cast<uint32_t>(kind);
+    hdr.elem     = static_cast<uint32_t>(elem);
+    hdr.nCols    = (uint32_t)cols.size();
+    hdr.reserved = 0;
+    hdr.nRows    = (uint64_t)time.size();
+
+    bool success = (1 == fwrite(&hdr, sizeof(hdr), 1, pf)) && Pad(sizeof(hdr));
+    success = success && (time.size() == fwrite(time.data(), sizeof(int32_t), time.size(), pf))
+                      && Pad(sizeof(int32_t) * time.size());
+
+    for (const auto &col : cols)
+    {
+        if (success == false) break;
+        if (elem == BinElem::i32) {
+            std::vector<int32_t> v(std::begin(col), std::end(col));
+            success = (v.size() == fwrite(v.data(), sizeof(int32_t), v.size(), pf));
+        } else
+        if (elem == BinElem::f32) {
+            std::vector<float>   v(std::begin(col), std::end(col));
+            success = (v.size() == fwrite(v.data(), sizeof(float)  , v.size(), pf));
+        } else
+        if (elem == BinElem::f64)
+            success = (col.size() == fwrite(col.data(), sizeof(double), col.size(), pf));
+        else
+            success = false;
+        success = success && Pad(ElemSize(elem) * col.size());
+    }
+
+    if (0 != fclose(pf)) success = false;
+    if (success == false) remove(filename.c_str());
+    return success;
+}
+
+}
@@ -0,0 +1,137 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_SIMULATION_BINDATA_H_
+#define SIBYL_SERVER_SIMULATION_BINDATA_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "../../sibyl_common.h"
+
+namespace sibyl
+{
+
+// Binary columnar counterpart of a single market data text file
+// (<code>.txt -> <code>.bin, <code>t.txt -> <code>t.bin, etc.)
+//
+// Layout (little endian, every section 8-byte aligned)
+//     BinHeader
+//     int32_t time[nRows]           seconds from 09:00:00 (Txt2Time applied, delay not applied)
+//     elem    col [nCols][nRows]    raw values as written in the text file (sign intact)
+//
+// Column convention for each kind
+//     tr  : q, p, ps1, pb1                 (i32)
+//     tb  : p[0..<idx::szTb], q[0..<idx::szTb] (i32; 3rd field of ELW tables dropped)
+//     vec : all tab separated fields       (f32 or f64)
+enum class BinKind : uint32_t
+{
+    null = 0,
+    tr   = 1,
+    tb   = 2,
+    vec  = 3
+};
+
+enum class BinElem : uint32_t
+{
+    null = 0,
+    i32  = 1,
+    f32  = 2,
+    f64  = 3
+};
+
+struct BinHeader
+{
+    char     magic[4]; // "SBDF"
+    uint32_t version;
+    uint32_t kind;     // BinKind
+    uint32_t elem;     // BinElem of data columns
+    uint32_t nCols;    // number of data columns (excluding time)
+    uint32_t reserved;
+    uint64_t nRows;
+};
+
+// Read-only memory mapped view of a .bin file
+class BinData
+{
+public:
+    constexpr static uint32_t kVersion = 1;
+
+    bool open (CSTR &filename); // returns false if inaccessible or of unknown format/version
+    void close();
+    bool is_open() const { return pMap != nullptr; }
+
+    BinKind     Kind() const { return kind;  }
+    BinElem     Elem() const { return elem;  }
+    std::size_t Rows() const { return nRows; }
+    std::size_t Cols() const { return nCols; }
+
+    const int32_t* Time() const { return pTime; }
+    const void*    Col (std::size_t c) const { verify(c < nCols); return pCol[c]; }
+    double         At  (std::size_t c, std::size_t row) const; // any elem type, converted
+
+    // Write a new file; each of cols should have time.size() elements
+    static bool Write(CSTR &filename, BinKind kind, BinElem elem,
+                      const std::vector<int32_t> &time, const std::vector<std::vector<double>> &cols);
+
+    static std::size_t ElemSize(BinElem e);
+
+    BinData() : pMap(nullptr), szMap(0), kind(BinKind::null), elem(BinElem::null),
+                nRows(0), nCols(0), pTime(nullptr) {}
+    BinData           (const BinData&) = delete;
+    BinData& operator=(const BinData&) = delete;
+    ~BinData() { close(); }
+private:
+    void       *pMap;
+    std::size_t szMap;
+
+    BinKind     kind;
+    BinElem     elem;
+    std::size_t nRows, nCols;
+
+    const int32_t           *pTime;
+    std::vector<const void*> pCol;
+
+    static std::size_t Align8(std::size_t n) { return (n + 7) & ~(std::size_t)7; }
+};
+
+inline std::size_t BinData::ElemSize(BinElem e)
+{
+    switch (e)
+    {
+        case BinElem::i32 : return sizeof(int32_t);
+        case BinElem::f32 : return sizeof(float);
+        case BinElem::f64 : return sizeof(double);
+        default           : return 0;
+    }
+}
+
+inline double BinData::At(std::size_t c, std::size_t row) const
+{
+    verify(c < nCols && row < nRows);
+    switch (elem)
+    {
+        case BinElem::i32 : return static_cast<const int32_t*>(pCol[c])[row];
+        case BinElem::f32 : return static_cast<const float*  >(pCol[c])[row];
+        case BinElem::f64 : return static_cast<const double* >(pCol[c])[row];
+        default           : return 0.0;
+    }
+}
+
+}
+
+#endif /* SIBYL_SERVER_SIMULATION_BINDATA_H_ */
@@ -0,0 +1,164 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_SIMULATION_ITEMSCHEDULER_H_
+#define SIBYL_SERVER_SIMULATION_ITEMSCHEDULER_H_
+
+#include <vector>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#include "Simulation_data.h"
+
+namespace sibyl
+{
+
+// Selects the items that need to be visited for each simulated second
+// An item is due if it has data events before timeTarget (min-heap of ItemSim::NextTime)
+// or has any order staged; other items keep their state unchanged, and are skipped
+// All items are due on the first second and when time crosses 09:00:00 (Requantize rule changes)
+// The data side (AdvanceData & Requeue) may run ahead on another thread than the order side (Due & Touch)
+// (see Simulation::ReadAhead); they share nothing but items, which are fixed by the first AdvanceData
+// Indices are ItemIds of the items
+class ItemScheduler
+{
+public:
+    // Data side: items with data events before timeTarget, as indices in the order of items
+    // Call once per second with increasing timeTarget; items should not change after first call
+    const std::vector<std::size_t>& AdvanceData(ItemTable<ItemSim> &items, int timeTarget);
+    void Requeue(); // call after reading data of all items of the last AdvanceData
+
+    // Order side: items of idxData (from AdvanceData for the same second) and items with orders staged
+    const std::vector<it_itm_t<ItemSim>>& Due(const std::vector<std::size_t> &idxData);
+    void Touch(it_itm_t<ItemSim> iItems); // an order was staged on this item
+    
+    it_itm_t<ItemSim> Item(std::size_t idx) const { return std::begin(*pItems) + (std::ptrdiff_t)idx; }
+
+    // Number of contiguous shards to split n due items into for a pool of nThreads
+    // Items of a shard are visited in order by a single thread
+    static std::size_t NumShards(std::size_t n, std::size_t nThreads);
+    static std::size_t ShardBegin(std::size_t n, std::size_t nShards, std::size_t iShard) { return n * iShard / nShards; }
+
+    ItemScheduler() : pItems(nullptr), timeLast(0) {}
+private:
+    constexpr static int keyNone = std::numeric_limits<int>::min(); // not in heap
+    constexpr static std::size_t szShardMin = 16; // smaller shards are not worth dispatching to another thread
+    typedef std::pair<int, std::size_t> key_idx; // (next event time, index)
+
+    ItemTable<ItemSim> *pItems; // nullptr before the first AdvanceData
+    int timeLast;
+    // data side
+    std::vector<int>  key;
+    std::vector<char> flag;
+    std::priority_queue<key_idx, std::vector<key_idx>, std::greater<key_idx>> heap;
+    std::vector<std::size_t> idxDue;
+
+    // order side
+    std::vector<std::size_t> live; // items with staged orders
+    std::vector<std::size_t> idxLive;
+    std::vector<it_itm_t<ItemSim>> due;
+
+    void Mark(std::size_t idx) { if (flag[idx] == 0) { flag[idx] = 1; idxDue.push_back(idx); } }
+};
+
+inline const std::vector<std::size_t>& ItemScheduler::AdvanceData(ItemTable<ItemSim> &items, int timeTarget)
+{
+    bool all = (pItems == nullptr) || (timeLast <= 0 && timeTarget > 0);
+    if (pItems == nullptr)
+    {
+        pItems = &items;
+        key .assign(items.size(), +keyNone);
+        flag.assign(items.size(), 0);
+    }
+    verify(pItems == &items && items.size() == key.size());
+    timeLast = timeTarget;
+
+    idxDue.clear();
+    if (all == true)
+    {
+        for (std::size_t idx = 0; idx < items.size(); idx++) idxDue.push_back(idx);
+        return idxDue;
+    }
+    while (heap.empty() == false && heap.top().first < timeTarget)
+    {
+        auto idx = heap.top().second;
+        if (key[idx] == heap.top().first) // skip stale entries
+        {
+            key[idx] = keyNone;
+            Mark(idx);
+        }
+        heap.pop();
+    }
+    for (auto idx : idxDue) flag[idx] = 0;
+    std::sort(std::begin(idxDue), std::end(idxDue)); // visit in the order of items
+    return idxDue;
+}
+
+inline const std::vector<it_itm_t<ItemSim>>& ItemScheduler::Due(const std::vector<std::size_t> &idxData)
+{
+    idxLive.clear();
+    std::size_t nLive = 0;
+    for (auto idx : live)
+    {
+        if (pItems->At((ItemId)idx).ord.empty() == true) continue;
+        live[nLive++] = idx;
+        if (std::binary_search(std::begin(idxData), std::end(idxData), idx) == false) idxLive.push_back(idx);
+    }
+    live.resize(nLive);
+    std::sort(std::begin(idxLive), std::end(idxLive));
+
+    // merge of the two, in the order of items
+    due.clear();
+    auto iD = std::begin(idxData);
+    auto iL = std::begin(idxLive);
+    while (iD != std::end(idxData) || iL != std::end(idxLive))
+    {
+        if (iL == std::end(idxLive) || (iD != std::end(idxData) && *iD < *iL)) due.push_back(Item(*iD++));
+        else                                                                   due.push_back(Item(*iL++));
+    }
+    return due;
+}
+
+inline void ItemScheduler::Requeue()
+{
+    for (auto idx : idxDue)
+    {
+        int t = pItems->At((ItemId)idx).NextTime();
+        if (t != key[idx] && t != std::numeric_limits<int>::max())
+        {
+            key[idx] = t;
+            heap.push(key_idx(t, idx));
+        }
+    }
+}
+
+inline std::size_t ItemScheduler::NumShards(std::size_t n, std::size_t nThreads)
+{
+    return std::max((std::size_t)1, std::min(nThreads, n / szShardMin));
+}
+
+inline void ItemScheduler::Touch(it_itm_t<ItemSim> iItems)
+{
+    if (pItems == nullptr) return; // not initialized yet; all items are due on the first second
+    std::size_t idx = pItems->Id(iItems);
+    if (std::find(std::begin(live), std::end(live), idx) == std::end(live)) live.push_back(idx);
+}
+
+}
+
+#endif /* SIBYL_SERVER_SIMULATION_ITEMSCHEDULER_H_ */
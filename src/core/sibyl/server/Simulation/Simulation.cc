@@ -14,19 +14,28 @@
    limitations under the License.
 */
 
-#include "Simulation_test.h"
+#include "Simulation.h"
 
 #include <sys/stat.h>
 #include <dirent.h>
 #include <fstream>
+#include <set>
 
 #include "../../ReqType.h"
+#include "../../util/ThreadPool.h"
+#include "../../util/FileLimit.h"
 
 namespace sibyl
 {
 
-int Simulation_test::LoadData(CSTR &cfgfile, CSTR &datapath)
+int SimulationBase::LoadData(CSTR &cfgfile, CSTR &datapath)
 {
+    auto tStart = LoadClock::now();
+    loadTime = LoadTime();
+    
+    this->cfgfile = cfgfile;
+    dayName = DayName(datapath);
+    
     bool usingKOSPI = true;
     bool usingELW   = true;
     bool usingETF   = true;
@@ -69,68 +78,136 @@ int Simulation_test::LoadData(CSTR &cfgfile, CSTR &datapath)
             listNotKOSPI = val;
         else if ((name == "DELAY_1H") && (val.empty() == false))
             listDelay1h = val; 
+        else if ( name == "CARRY_BAL")
+            carryBal = (val.empty() == false && val != "0");
     }
     
+    loadTime.config = LoadTime::Ms(tStart, LoadClock::now());
+    
     // length of code
     const int codeSize = 6;
     
+    // text data keeps the files of each item open (tr, tb & th)
+    RaiseFileLimit();
+    
     // auto add data
     STR path = datapath;
     if (path.empty() == false && path.back() != '/') path.append("/");
     STR pathETF = path + "ETF/";
     
-    // last argument should be a 'new' pointer 
-    auto OpenAndInsert = [&](CSTR &path, CSTR &code, ItemSim *p) {
-        bool success = p->open(path, code);
-        if (success == true)
+    // data path may also be a .zip archive (see ZipArchive.h); keep it open while loading
+    STR entryRoot;
+    auto pArchive = ZipArchive::Resolve(path, entryRoot);
+    if (ZipArchive::IsZipPath(path) == true && pArchive == nullptr) return DisplayLoadError("Data archive invalid");
+    
+    // items are opened in parallel and then inserted serially in the given order
+    // last element of each pair should be from NewItem; returns # of items inserted
+    auto OpenAndInsert = [&](CSTR &path, std::vector<std::pair<STR, ItemSim*>> &code_p) {
+        auto t0 = LoadClock::now();
+        std::vector<char> opened(code_p.size());
+        pool.ParallelFor(code_p.size(), [&](std::size_t i) {
+            opened[i] = code_p[i].second->open(path, code_p[i].first);
+        });
+        auto t1 = LoadClock::now();
+        int cnt = 0;
+        for (std::size_t i = 0; i < code_p.size(); i++)
         {
+            CSTR    &code = code_p[i].first;
+            ItemSim *p    = code_p[i].second;
+            if (opened[i] == false)
+            {
+                delete p;
+                continue;
+            }
             auto it_bool = orderbook.items.insert(std::make_pair(code, std::unique_ptr<ItemSim>(p)));
-            success = it_bool.second;
-            if (success == false) // new pointer is deleted automatically in destructor
+            if (it_bool.second == false) // new pointer is deleted automatically in destructor
             {
                 STR str = "Nonunique code {" + code + "} found";
                 DisplayLoadError(str);
-            }
+            } else
+                cnt++;
         }
-        return success;
+        loadTime.open   += LoadTime::Ms(t0, t1);
+        loadTime.insert += LoadTime::Ms(t1, LoadClock::now());
+        return cnt;
     };
     
     auto AutoAdd = [&](CSTR &path, SecType type) {
-        struct stat sDir;
-        if (-1 == stat(path.c_str(), &sDir)) return DisplayLoadError("Data path invalid");
-        if (S_ISDIR(sDir.st_mode) == false)  return DisplayLoadError("Data path not a directory");
-        
-        DIR *pDir = opendir(path.c_str());
-        if (pDir == nullptr)                 return DisplayLoadError("Data path inaccessible");
+        auto t0 = LoadClock::now();
+        std::vector<STR> names;
+        if (pArchive != nullptr) // list from central directory
+        {
+            STR dir;
+            ZipArchive::Resolve(path, dir);
+            names = pArchive->List(dir);
+        }
+        else
+        {
+            struct stat sDir;
+            if (-1 == stat(path.c_str(), &sDir)) return DisplayLoadError("Data path invalid");
+            if (S_ISDIR(sDir.st_mode) == false)  return DisplayLoadError("Data path not a directory");
+            
+            DIR *pDir = opendir(path.c_str());
+            if (pDir == nullptr)                 return DisplayLoadError("Data path inaccessible");
+            
+            struct dirent *pEnt;
+            while ((pEnt = readdir(pDir)) != nullptr) names.push_back(pEnt->d_name);
+            closedir(pDir);
+        }
         
-        struct dirent *pEnt;
-        while ((pEnt = readdir(pDir)) != nullptr)
+        // candidate codes in directory order
+        std::vector<STR> codes;
+        std::set<STR>    codesSeen;
+        for (CSTR &name : names)
         {
-            STR name = pEnt->d_name;
-            STR ext  = ".txt";
+            STR ext  = (name.size() > 4 ? name.substr(name.size() - 4) : STR());
             
             int nameSize = (int)name.size() - (int)ext.size(); 
-            if ( (nameSize == codeSize || nameSize == codeSize + 1)             &&
-                 (0 == name.compare(name.size() - ext.size(), ext.size(), ext)) )
+            if ( (nameSize == codeSize || nameSize == codeSize + 1) &&
+                 (ext == ".txt" || ext == ".bin")                   )
             {
                 STR code(name, 0, (std::size_t)codeSize);
-                auto typeCur = ResolveSecType(path, code);
-                if (typeCur == type) // this also filters invalid or already added items
-                {
-                    if (type == SecType::KOSPI) OpenAndInsert(path, code, new KOSPISim);
-                    if (type == SecType::ETF  ) OpenAndInsert(path, code, new ETFSim  );    
-                    if (type == SecType::ELW && (nELW == 0 || cntELW < nELW))
-                    {
-                        int type_expiry = ReadTypeExpiry(path, code);
-                        if (type_expiry == 0) continue; // non-KOSPI200-related ELW
-                        bool success = OpenAndInsert(path, code, new ELWSim((type_expiry > 0 ? OptType::call : OptType::put  ),
-                                                                            (type_expiry > 0 ? type_expiry   : -type_expiry)));
-                        if (success == true) cntELW++;
-                    }
-                }
+                if (codesSeen.insert(code).second == true) codes.push_back(code);
             }
         }
-        closedir(pDir);
+        auto t1 = LoadClock::now();
+        
+        // resolve types (orderbook.items is not modified during this)
+        std::vector<int> type_expiry(codes.size()); // 0: skip
+        pool.ParallelFor(codes.size(), [&](std::size_t i) {
+            if (ResolveSecType(path, codes[i]) == type) // this also filters invalid or already added items
+                type_expiry[i] = (type == SecType::ELW ? ReadTypeExpiry(path, codes[i]) : 1); // 0: non-KOSPI200-related ELW
+        });
+        auto t2 = LoadClock::now();
+        loadTime.discover += LoadTime::Ms(t0, t1);
+        loadTime.resolve  += LoadTime::Ms(t1, t2);
+        
+        std::vector<std::pair<STR, ItemSim*>> code_p;
+        std::size_t iCode = 0;
+        auto NextBatch = [&](std::size_t szBatch) {
+            code_p.clear();
+            for (; iCode < codes.size() && code_p.size() < szBatch; iCode++)
+            {
+                int te = type_expiry[iCode];
+                if (te == 0) continue;
+                code_p.push_back(std::make_pair(codes[iCode], NewItem(codes[iCode], type, te)));
+            }
+            return (code_p.empty() == false);
+        };
+        
+        if (type != SecType::ELW || nELW == 0)
+        {
+            if (NextBatch(codes.size()) == true)
+            {
+                int cnt = OpenAndInsert(path, code_p);
+                if (type == SecType::ELW) cntELW += cnt;
+            }
+        }
+        else // first nELW items that open successfully, as if opened one by one
+        {
+            while (cntELW < nELW && NextBatch((std::size_t)(nELW - cntELW)) == true)
+                cntELW += OpenAndInsert(path, code_p);
+        }
         return 0;
     };
     
@@ -146,19 +223,23 @@ int Simulation_test::LoadData(CSTR &cfgfile, CSTR &datapath)
     // manual add data (KOSPI)
     if (usingKOSPI == true && listKOSPI.size() > 0)
     {
+        std::vector<std::pair<STR, ItemSim*>> code_p;
         std::istringstream sKOSPI(listKOSPI);
         for (STR code; std::getline(sKOSPI, code, ';');)
             if (code.size() == codeSize)
-                OpenAndInsert(path, code, new KOSPISim);
+                code_p.push_back(std::make_pair(code, NewItem(code, SecType::KOSPI)));
+        OpenAndInsert(path, code_p);
     }
 
     // manual add data (ETF)
     if (usingETF == true && listETF.size() > 0)
     {
+        std::vector<std::pair<STR, ItemSim*>> code_p;
         std::istringstream sETF(listETF);
         for (STR code; std::getline(sETF, code, ';');)
             if (code.size() == codeSize)
-                OpenAndInsert(pathETF, code, new ETFSim);
+                code_p.push_back(std::make_pair(code, NewItem(code, SecType::ETF)));
+        OpenAndInsert(pathETF, code_p);
     }
 
     // remove NOTKOSPI
@@ -176,11 +257,15 @@ int Simulation_test::LoadData(CSTR &cfgfile, CSTR &datapath)
         }
     }
 
+    // KOSPI200.txt
+    if (useKOSPI200 == true) dataKOSPI200.open(path + "KOSPI200.txt");
+
     // if data date is in DELAY_1H, set delay of 1 hour
     if (listDelay1h.size() > 0)
     {
         const int dateSize = 8;
         if (path.back() == '/') path.pop_back(); // path has already been validated
+        if (ZipArchive::IsZipPath(path) == true) path.resize(path.size() - 4); // */YYYYMMDD.zip
         if ( (path.size() < dateSize + 1) || 
              (path[path.size() - (dateSize + 1)] != '/') ||
              (false == std::all_of(std::begin(path) + (std::ptrdiff_t)path.size() - dateSize,
@@ -195,6 +280,7 @@ int Simulation_test::LoadData(CSTR &cfgfile, CSTR &datapath)
             {
                 for (auto &code_pItem : orderbook.items)
                     code_pItem.second->SetDelay(3600);
+                dataKOSPI200.SetDelay(3600);
                 break;
             }
         }
@@ -225,47 +311,103 @@ int Simulation_test::LoadData(CSTR &cfgfile, CSTR &datapath)
         } 
     }
     
+    loadTime.total    = LoadTime::Ms(tStart, LoadClock::now());
+    loadTime.nThreads = pool.Size();
+    
     if (orderbook.items.size() == 0) return DisplayLoadError("0 items to simulate");
-    if (verbose == true) std::cout << "[Done] Load data for " << orderbook.items.size() << " items" << std::endl; 
+    if (verbose == true) {
+        std::cout << "[Done] Load data for " << orderbook.items.size() << " items" << std::endl;
+        loadTime.Print(std::cout);
+    }
     
     return 0;
 }
 
-int Simulation_test::AdvanceTick()
+void SimulationBase::SetNextDays(const std::vector<STR> &datapaths)
+{
+    nextDays.assign(std::begin(datapaths), std::end(datapaths));
+}
+
+int SimulationBase::NextDay(STR &name)
 {
-    int timeTarget = orderbook.time + kTimeRates::secPerTick;
+    std::lock_guard<std::recursive_mutex> lock(orderbook.items_mutex);
+    WaitReadAhead();
     
-    do
-    {
-        ReadData(++orderbook.time);
-        SimulateTrades();
-    } while (orderbook.time < timeTarget);
+    dayRates.push_back(std::make_pair(dayName, orderbook.GetProfitRate()));
+    if (nextDays.empty() == true) return -1;
     
-    orderbook.UpdateRefInitBal();
-    if (verbose == true) PrintState();
+    INT64 balCarry = orderbook.Evaluate().evalTot;
     
+    // back to the state before LoadData, keeping closed items to be reused
+    orderbook.ResetDay();
+    orderbook.time = kTimeStart;
+    for (auto &code_pItem : orderbook.items)
+    {
+        code_pItem.second->close();
+        spare[code_pItem.first] = std::move(code_pItem.second);
+    }
+    orderbook.items.clear();
+    ELWSim::CloseKOSPI200();
+    dataKOSPI200.close();
+    sched = ItemScheduler();
     nReqThisTick = 0;
     
-    return (orderbook.time < kTimeBounds::end ? 0 : -1);
+    STR datapath = nextDays.front();
+    nextDays.pop_front();
+    int ret = LoadData(cfgfile, datapath);
+    spare.clear(); // codes not present on this day
+    if (carryBal == true) orderbook.bal = balCarry;
+    
+    name = dayName;
+    return ret;
+}
+
+STR SimulationBase::DayName(CSTR &datapath)
+{
+    STR name = datapath;
+    while (name.empty() == false && name.back() == '/') name.pop_back();
+    if (ZipArchive::IsZipPath(name) == true) name.resize(name.size() - 4);
+    auto posSlash = name.find_last_of('/');
+    return (posSlash == std::string::npos ? name : name.substr(posSlash + 1));
+}
+
+STR SimulationBase::DayPath(CSTR &datapath, CSTR &day)
+{
+    STR path = datapath;
+    while (path.empty() == false && path.back() == '/') path.pop_back();
+    auto posSlash = path.find_last_of('/');
+    path = (posSlash == std::string::npos ? STR() : path.substr(0, posSlash + 1)) + day;
+    
+    struct stat sZip;
+    if (0 == stat((path + ".zip").c_str(), &sZip) && S_ISREG(sZip.st_mode) == true) path.append(".zip");
+    return path;
+}
+
+CSTR& SimulationBase::BuildMsgOut()
+{
+    CalcPrQr();
+    return orderbook.BuildMsgOut(true);
 }
 
-CSTR& Simulation_test::BuildMsgOut()
+const StateMsg& SimulationBase::BuildState()
+{
+    CalcPrQr();
+    return orderbook.BuildState(true);
+}
+
+void SimulationBase::CalcPrQr()
 {
-    // calc pr, qr
     for (const auto &code_pItem : orderbook.items)
     {
         auto &i = *code_pItem.second;
-        const auto &dataTr = i.TrData();
-        if (dataTr.SumQ() > 0)   i.pr = (FLOAT)dataTr.SumPQ() / dataTr.SumQ();
+        if (i.sumQ > 0)          i.pr = (FLOAT)i.sumPQ / i.sumQ;
         if (orderbook.time <= 0) i.pr = (FLOAT)i.Ps0(); // follow ps0 until 09:00:00
-        i.qr = dataTr.SumQ();
-        i.TrData().InitSum();
+        i.qr = i.sumQ;
+        i.InitSum();
     }
-
-    return orderbook.BuildMsgOut(true);
 }
 
-void Simulation_test::PrintState()
+void SimulationBase::PrintState()
 {
     std::cout << "[t=" << orderbook.time << "] ----------------------------------------------------------------\n";
     std::cout << "bal " << orderbook.bal << "\n";
@@ -331,162 +473,68 @@ void Simulation_test::PrintState()
     std::cout << std::endl;
 }
 
-void Simulation_test::ReadData(int timeTarget)
+ItemSim* SimulationBase::NewItem(CSTR &code, SecType type, int typeExpiry)
 {
-    for (const auto &code_pItem : orderbook.items)
-        code_pItem.second->AdvanceTime(timeTarget);
-}
-
-void Simulation_test::SimulateTrades()
-{
-    for (auto iItems = std::begin(orderbook.items); iItems != std::end(orderbook.items); iItems++)
+    OptType optType = (typeExpiry > 0 ? OptType::call : OptType::put);
+    INT     expiry  = (typeExpiry > 0 ? typeExpiry : -typeExpiry);
+    
+    auto it = spare.find(code);
+    if (it != std::end(spare) && it->second->Type() == type)
     {
-        auto &i = *iItems->second;
-        
-        // attach OrdType to PQ from TxtDataTr.VecTr()
-        const auto &vtr = i.TrData().VecTr();
-        std::vector<Order> vtro;
-        for (const auto &t : vtr)
-        {
-            Order o(t.p, t.q);
-            auto AddIfInTbr = [&](const OrdType &type) {
-                INT tck = i.P2Tck(t.p, type);
-                if (tck >= 0 && tck < idx::tckN) {
-                    o.type = type;
-                    vtro.push_back(o);
-                }
-            };
-            AddIfInTbr(OrdType::buy );
-            AddIfInTbr(OrdType::sell);
-        }
-        
-        // Process order queue
-        // Enforce OrdB <= tbqr for p1+ orders and OrdB = 0 for p0 orders
-        for (auto &price_OrderSim : i.ord)
-        {
-            auto &o = price_OrderSim.second;
-            INT tck = i.P2Tck(o.p, o.type);
-            if (tck >= 0 && tck < idx::tckN) o.B = std::min(o.B, (INT64) i.Tck2Q(tck, o.type));
-            else if (tck == -1)              o.B = 0;
-        }
-        
-        // Make p0+ orders with trade events, filling lowest tick first
-        for (const auto &t : vtro)
-        {
-            INT qleft = t.q;
-            int trTck = i.P2Tck(t.p, t.type); // (trTck >= 0 && trTck < idx::tckN) ensured above
-            for (int tck = -1; tck <= trTck; tck++)
-            {
-                INT deltaq(0);
-                const auto &first_last = i.ord.equal_range(i.Tck2P(tck, t.type));
-                for (auto iOrd = first_last.first; iOrd != first_last.second; iOrd++)
-                {
-                    const auto &o = iOrd->second;
-                    if (o.type == t.type && o.q > 0) deltaq = (INT) std::max(o.B + o.M + o.q, (INT64) deltaq);
-                }
-                deltaq = std::min(qleft, deltaq);
-                if (deltaq > 0)
-                {
-                    for (auto iOrd = first_last.first; iOrd != first_last.second; iOrd++)
-                    {
-                        const auto &o = iOrd->second;
-                        if (o.type == t.type && o.q > 0)
-                        {
-                            if (verbose == true && deltaq > o.B + o.M) std::cout << "<p_" << (tck + 1) << ">" << std::endl;
-                            PopBM(iItems, iOrd, deltaq);
-                        }
-                    }
-                    qleft -= deltaq;
-                    if (qleft <= 0) break;
-                }
-            }
-        }
-        
-        // Make <-1th orders
-        for (auto iOrd = std::begin(i.ord); iOrd != std::end(i.ord); iOrd++)
-        {
-            const auto &o = iOrd->second;
-            if (o.q > 0 && ((o.type == OrdType::buy  && o.p > i.Pb0()) || 
-                            (o.type == OrdType::sell && o.p < i.Ps0()) ))
-            {
-                if (verbose == true) std::cout << "<p_-1>" << std::endl;
-                orderbook.ApplyTrade(iItems, iOrd, PQ(o.p, o.q));
-            }
-        }
+        ItemSim *p = it->second.release();
+        spare.erase(it);
+        if (type == SecType::ELW) static_cast<ELWSim*>(p)->SetInfo(optType, expiry);
+        return p;
     }
+    
+    if (type == SecType::KOSPI) return new KOSPISim;
+    if (type == SecType::ETF  ) return new ETFSim;
+    if (type == SecType::ELW  ) return new ELWSim(optType, expiry);
+    return nullptr;
 }
 
-int Simulation_test::ExecuteNamedReq(NamedReq<OrderSim, ItemSim> req)
-{
-    if (req.q > 0 && nReqThisTick < kTimeRates::reqPerTick)
-    {
-        verify(req.type != ReqType::ca && req.type != ReqType::sa);
-        
-        if (req.type == ReqType::cb || req.type == ReqType::cs || req.type == ReqType::mb || req.type == ReqType::ms)
-        {
-            // q-asserts already in OrderBook's functions
-            TrimM                (req.iItems, req.iOrd, req.q);
-            orderbook.ApplyCancel(req.iItems, req.iOrd, req.q);
-        }
-        
-        if (req.type == ReqType::b  || req.type == ReqType::s  || req.type == ReqType::mb || req.type == ReqType::ms)
-        {
-            const auto &i = *req.iItems->second;
-            
-            OrderSim o;
-            o.type = ((req.type == ReqType::b || req.type == ReqType::mb) ? OrdType::buy : OrdType::sell);
-            o.p    = req.p;
-            o.q    = req.q;
-            o.B    = (o.p != i.Tck2P(-1, o.type) ? i.Tck2Q(i.P2Tck(o.p, o.type), o.type) : 0);
-            o.M    = GetM(req.iItems, o.type, o.p);
-            orderbook.ApplyInsert(req.iItems, o);  
-        }
-    }
-    return (++nReqThisTick < kTimeRates::reqPerTick ? 0 : -1);
-}
-
-int Simulation_test::DisplayLoadError(CSTR &str)
+int SimulationBase::DisplayLoadError(CSTR &str)
 {
     std::cerr << "Simulation::LoadData: " << str << std::endl;
     return -1;
 }
 
 
-SecType Simulation_test::ResolveSecType(CSTR &path, CSTR &code)
+SecType SimulationBase::ResolveSecType(CSTR &path, CSTR &code)
 {
     SecType type(SecType::null);
     
     if (std::end(orderbook.items) == orderbook.items.find(code))
     {
         // common
-        std::ifstream tr(path + code + STR(".txt" ));
-        std::ifstream tb(path + code + STR("t.txt"));
+        // (.bin counterparts of data files also count)
+        bool tr = TxtData::Exists(path + code + STR(".txt" ));
+        bool tb = TxtData::Exists(path + code + STR("t.txt"));
         
         // type-specific
-        std::ifstream th(path + code + STR("g.txt")); // ELW only
-        std::ifstream i (path + code + STR("i.txt")); // ELW only
-        std::ifstream n (path + code + STR("n.txt")); // ETF only
+        bool th = TxtData::Exists(path + code + STR("g.txt")); // ELW only
+        bool i  = ZipArchive::Exists(path + code + STR("i.txt")); // ELW only
+        bool n  = TxtData::Exists(path + code + STR("n.txt")); // ETF only
         
-        if (tr.is_open() == true && tb.is_open() == true)
+        if (tr == true && tb == true)
         {
-            if(th.is_open() == false && i.is_open() == false && n.is_open() == false) type = SecType::KOSPI;
-            if(th.is_open() == true  && i.is_open() == true  && n.is_open() == false) type = SecType::ELW;
-            if(th.is_open() == false && i.is_open() == false && n.is_open() == true ) type = SecType::ETF;
+            if(th == false && i == false && n == false) type = SecType::KOSPI;
+            if(th == true  && i == true  && n == false) type = SecType::ELW;
+            if(th == false && i == false && n == true ) type = SecType::ETF;
         }
-        
-        // files closed automatically in ~ifstream
     }  
     return type;
 }
 
-int Simulation_test::ReadTypeExpiry(CSTR &path, CSTR &code)
+int SimulationBase::ReadTypeExpiry(CSTR &path, CSTR &code)
 {    
     int type = 0;
     int expiry = 0;
     
-    std::ifstream sInfo(path + code + STR("i.txt"));
-    if (sInfo.is_open() == true)
+    STR info;
+    if (ZipArchive::ReadFile(path + code + STR("i.txt"), info) == true)
     {
+        std::istringstream sInfo(info);
         for (STR line; std::getline(sInfo, line);)
         {
             if (line.back() == '\r') line.pop_back();
@@ -513,54 +561,4 @@ int Simulation_test::ReadTypeExpiry(CSTR &path, CSTR &code)
     return type * expiry;
 }
 
-INT64 Simulation_test::GetM(it_itm_t<ItemSim> iItems, OrdType type, INT p) const
-{
-    INT64 M(0);
-    const auto &first_last = iItems->second->ord.equal_range(p);
-    for (auto iP = first_last.first; iP != first_last.second; iP++)
-    {
-        const auto &o = iP->second;
-        if (o.type == type) M += o.q; // o.q == 0 doesn't do anything
-    }
-    return M; 
 }
-
-void Simulation_test::PopBM(it_itm_t<ItemSim> iItems, it_ord_t<OrderSim> iOrd, INT q)
-{
-    auto &o = iOrd->second;
-    if (o.q > 0) // skip already emptied orders
-    {
-        INT delta = (INT)std::min((INT64)q, o.B); 
-        q   -= delta;
-        o.B -= delta;
-        if (q > 0)
-        {
-            delta = (INT)std::min((INT64)q, o.M);
-            q   -= delta;
-            o.M -= delta;
-            if (q > 0)
-            {
-                q = std::min(q, o.q);
-                orderbook.ApplyTrade(iItems, iOrd, PQ(o.p, q));
-            }
-        }
-    }
-}
-
-void Simulation_test::TrimM(it_itm_t<ItemSim> iItems, it_ord_t<OrderSim> iOrd, INT q)
-{
-    const auto &first_last = iItems->second->ord.equal_range(iOrd->first);
-    const auto type = iOrd->second.type;
-    verify(iOrd != first_last.second); // iOrd must be in ItemSim pointed by iItems
-    for (iOrd++; iOrd != first_last.second; iOrd++)
-    {
-        auto &o = iOrd->second;
-        if (o.type == type && o.q > 0) // skip already emptied orders
-        {
-            o.M -= q;
-            verify(o.M >= 0);
-        }
-    }
-}
-
-}
\ No newline at end of file
@@ -0,0 +1,347 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_SIMULATION_SIMULATION_H_
+#define SIBYL_SERVER_SIMULATION_SIMULATION_H_
+
+#include <cmath>
+#include <deque>
+#include <future>
+
+#include "Simulation_data.h"
+#include "SimulationPolicy.h"
+#include "ItemScheduler.h"
+#include "../Broker.h"
+#include "../../util/ThreadPool.h"
+
+namespace sibyl
+{
+
+// Loading data, reporting state and building messages; common to all Simulation<...>
+class SimulationBase : public Broker<OrderSim, ItemSim>
+{
+public:
+    int LoadData(CSTR &config, CSTR &datapath); // non-0 for any error
+    const LoadTime& GetLoadTime() const { return loadTime; }
+
+    // Multi-day simulation; data paths of the days after the one given to LoadData, in order (see DayPath)
+    // Each day is loaded in place by NextDay with the same config file, reusing items of codes that persist
+    // If CARRY_BAL is set in config, a day starts with the evaluated balance at the end of the previous day
+    void SetNextDays(const std::vector<STR> &datapaths);
+    const std::vector<std::pair<STR, double>>& GetDayRates() const { return dayRates; } // (day, profit rate) of days ended
+
+    // virtuals from Broker
+    CSTR&           BuildMsgOut() override;
+    const StateMsg& BuildState () override;
+    int             NextDay    (STR &name) override;
+    STR             Day        () const    override { return dayName; }
+
+    static STR DayName (CSTR &datapath); // last component of datapath without .zip (e.g., YYYYMMDD)
+    static STR DayPath (CSTR &datapath, CSTR &day); // sibling of datapath for day (<day>.zip if it exists)
+
+    void PrintState();
+
+    static int ReadTypeExpiry(CSTR &path, CSTR &code); // returns kOptType * expiry (0: non-KOSPI200; skip)
+protected:
+    explicit SimulationBase(bool useKOSPI200_) : dataKOSPI200(1), useKOSPI200(useKOSPI200_), kospi200Ahead(0.0f),
+                                                 nReqThisTick(0), carryBal(false) { orderbook.time = kTimeStart; }
+    ~SimulationBase() { WaitReadAhead(); }
+    constexpr static int kTimeStart = -3600 + 600; // starts at 08:10:10
+
+    TxtDataVec<FLOAT> dataKOSPI200;
+    bool useKOSPI200;
+    LoadTime loadTime;
+    ItemScheduler sched;
+
+    // due items are read & simulated in contiguous shards across the pool;
+    // changes to bal/sum are kept per shard and merged in the order of items (identical to serial)
+    typedef OrderBook<OrderSim, ItemSim>::TradeLedger TradeLedger;
+    ThreadPool pool;
+    std::vector<TradeLedger> ledgers; // per shard
+
+    // Market data of the next tick is read on a separate thread (readAhead) while the client decides on reqs,
+    // leaving only the order-dependent part (applying it in order & matching) to AdvanceTick
+    // The thread touches only TxtData readers, dataKOSPI200 and the data side of sched; the pool is not used meanwhile
+    struct SecondAhead {
+        std::vector<std::size_t> idx;   // items with data events (see ItemScheduler::AdvanceData)
+        std::vector<ItemSecond>  items; // data of idx[k] (reused; may be longer than idx)
+    };
+    std::vector<SecondAhead> ahead;     // kTimeRates::secPerTick seconds of the next tick
+    FLOAT kospi200Ahead;                // as of the last second of ahead
+    std::future<void> readAhead;
+    void WaitReadAhead() { if (readAhead.valid() == true) readAhead.wait(); }
+
+    int nReqThisTick;
+private:
+    // helper functions for LoadData; path should have trailing '/'
+    int      DisplayLoadError(CSTR &str);
+    SecType  ResolveSecType  (CSTR &path, CSTR &code); // returns kSecNull for failure / already existent
+    ItemSim* NewItem         (CSTR &code, SecType type, int typeExpiry = 0); // from spare if available (ELW: typeExpiry as in ReadTypeExpiry)
+
+    // multi-day
+    STR   cfgfile, dayName;
+    bool  carryBal;
+    std::deque<STR> nextDays;
+    std::vector<std::pair<STR, double>> dayRates;
+    std::map<STR, std::unique_ptr<ItemSim>> spare; // items of the previous day, closed (see ItemSim::close)
+
+    void CalcPrQr(); // pr, qr of this tick for BuildMsgOut & BuildState
+};
+
+// Simulation engine; fill rules and queue position bookkeeping are given as policies
+// (see SimulationPolicy.h), so that the per-second loop has no virtual calls or type checks
+template <class FillPolicy, class QueuePolicy>
+class Simulation : public SimulationBase
+{
+public:
+    // virtuals from Broker
+    int AdvanceTick() override;
+
+    Simulation() : SimulationBase(FillPolicy::kospi200Index) {}
+private:
+    void ReadAhead(int timeFrom); // fill ahead with event info of kTimeRates::secPerTick sec after timeFrom
+    void SimulateTrades(const std::vector<it_itm_t<ItemSim>> &due);
+    void SimulateTrades(it_itm_t<ItemSim> iItems, TradeLedger &ledger);
+
+    // virtuals from Broker
+    int  ExecuteNamedReq(NamedReq<OrderSim, ItemSim> req) override; // non-0 if req count overflow
+    void OnExit() override { WaitReadAhead(); }
+
+    // pop B & M of an order, and make the order if B + M becomes negative
+    void PopBM(it_itm_t<ItemSim> iItems, it_ord_t<OrderSim> iOrd, INT q, TradeLedger &ledger);
+};
+
+typedef Simulation<FillDep , QueueLevels> Simulation_dep;  // Simulation with depletion mechanism
+typedef Simulation<FillTest, QueueLevels> Simulation_test; // Simulation trying to emulate Kiwoom test server
+
+template <class FillPolicy, class QueuePolicy>
+int Simulation<FillPolicy, QueuePolicy>::AdvanceTick()
+{
+    if (readAhead.valid() == true) readAhead.get(); // launched at the end of the previous tick
+    else                           ReadAhead(orderbook.time);
+
+    for (auto &sec : ahead)
+    {
+        ++orderbook.time;
+        std::size_t nShards = ItemScheduler::NumShards(sec.idx.size(), pool.Size());
+        pool.ParallelFor(nShards, [&](std::size_t iShard) {
+            for (std::size_t k  = ItemScheduler::ShardBegin(sec.idx.size(), nShards, iShard    );
+                             k  < ItemScheduler::ShardBegin(sec.idx.size(), nShards, iShard + 1); k++)
+                FillPolicy::Advance(*sched.Item(sec.idx[k])->second, sec.items[k]);
+        });
+        SimulateTrades(sched.Due(sec.idx)); // items with neither events nor orders are unaffected
+    }
+    ELW<ItemSim>::kospi200 = kospi200Ahead;
+
+    orderbook.UpdateRefInitBal();
+    if (verbose == true) PrintState();
+
+    nReqThisTick = 0;
+
+    if (orderbook.time >= kTimeBounds::end) return -1;
+    int timeFrom = orderbook.time;
+    readAhead = std::async(std::launch::async, [this, timeFrom] { ReadAhead(timeFrom); });
+    return 0;
+}
+
+template <class FillPolicy, class QueuePolicy>
+void Simulation<FillPolicy, QueuePolicy>::ReadAhead(int timeFrom)
+{
+    ahead.resize(kTimeRates::secPerTick);
+    kospi200Ahead = ELW<ItemSim>::kospi200; // carried over unless read
+    for (auto &sec : ahead)
+    {
+        int timeTarget = ++timeFrom;
+        ELWSim::AdvanceKOSPI200(timeTarget, kospi200Ahead);
+
+        const auto &idx = sched.AdvanceData(orderbook.items, timeTarget);
+        sec.idx.assign(std::begin(idx), std::end(idx));
+        if (sec.items.size() < idx.size()) sec.items.resize(idx.size());
+        std::size_t nShards = ItemScheduler::NumShards(idx.size(), pool.Size());
+        pool.ParallelFor(nShards, [&](std::size_t iShard) {
+            for (std::size_t k  = ItemScheduler::ShardBegin(idx.size(), nShards, iShard    );
+                             k  < ItemScheduler::ShardBegin(idx.size(), nShards, iShard + 1); k++)
+                sched.Item(idx[k])->second->ReadSecond(timeTarget, sec.items[k]);
+        });
+        sched.Requeue();
+
+        if (dataKOSPI200.is_open() == true) {
+            dataKOSPI200.AdvanceTime(timeTarget);
+            kospi200Ahead = std::fabs(dataKOSPI200[0]);
+        }
+    }
+}
+
+template <class FillPolicy, class QueuePolicy>
+void Simulation<FillPolicy, QueuePolicy>::SimulateTrades(const std::vector<it_itm_t<ItemSim>> &due)
+{
+    std::lock_guard<std::recursive_mutex> lock(orderbook.items_mutex);
+
+    std::size_t nShards = ItemScheduler::NumShards(due.size(), pool.Size());
+    if (ledgers.size() < nShards) ledgers.resize(nShards);
+    pool.ParallelFor(nShards, [&](std::size_t iShard) {
+        for (std::size_t k  = ItemScheduler::ShardBegin(due.size(), nShards, iShard    );
+                         k  < ItemScheduler::ShardBegin(due.size(), nShards, iShard + 1); k++)
+            SimulateTrades(due[k], ledgers[iShard]);
+    });
+    for (std::size_t iShard = 0; iShard < nShards; iShard++)
+        orderbook.MergeLedger(ledgers[iShard]);
+}
+
+template <class FillPolicy, class QueuePolicy>
+void Simulation<FillPolicy, QueuePolicy>::SimulateTrades(it_itm_t<ItemSim> iItems, TradeLedger &ledger)
+{
+    auto &i = *iItems->second;
+    QueuePolicy::Settle(i); // M is up to date from here
+
+    // attach OrdType to PQ from trade events of this second
+    std::vector<Order> vtro;
+    for (const auto &t : i.vecTr)
+    {
+        Order o(t.p, t.q);
+        auto AddIfInTbr = [&](const OrdType &type) {
+            INT tck = i.P2Tck(t.p, type);
+            if (tck >= 0 && tck < idx::tckN) {
+                o.type = type;
+                vtro.push_back(o);
+            }
+        };
+        AddIfInTbr(OrdType::buy );
+        AddIfInTbr(OrdType::sell);
+    }
+    i.vecTr.clear(); // not to be matched again on a second without events (due by orders only)
+
+    // Process order queue
+    // Enforce OrdB <= tbqr for p1+ orders and OrdB = 0 for p0 orders
+    for (auto &price_OrderSim : i.ord)
+    {
+        auto &o = price_OrderSim.second;
+        INT tck = i.P2Tck(o.p, o.type);
+        if (tck >= 0 && tck < idx::tckN) o.B = std::min(o.B, (INT64) i.Tck2Q(tck, o.type));
+        else if (tck == -1)              o.B = 0;
+    }
+
+    // Make p0 orders without trade events (as the fill rules allow)
+    FillPolicy::FillP0(i, [&](it_ord_t<OrderSim> iOrd, INT q) {
+        const auto &o = iOrd->second;
+        if (verbose == true && q > o.B + o.M) ledger.log << "<q_0>" << std::endl;
+        PopBM(iItems, iOrd, q, ledger);
+    });
+
+    // Make p0+ orders with trade events, filling lowest tick first
+    for (const auto &t : vtro)
+    {
+        INT qleft = t.q;
+        int trTck = i.P2Tck(t.p, t.type); // (trTck >= 0 && trTck < idx::tckN) ensured above
+        for (int tck = -1; tck <= FillPolicy::LastTck(trTck); tck++)
+        {
+            INT deltaq(0);
+            const auto &first_last = i.ord.equal_range(i.Tck2P(tck, t.type));
+            for (auto iOrd = first_last.first; iOrd != first_last.second; iOrd++)
+            {
+                const auto &o = iOrd->second;
+                if (o.type == t.type && o.q > 0) deltaq = (INT) std::max(o.B + o.M + o.q, (INT64) deltaq);
+            }
+            deltaq = std::min(qleft, deltaq);
+            if (deltaq > 0)
+            {
+                for (auto iOrd = first_last.first; iOrd != first_last.second; iOrd++)
+                {
+                    const auto &o = iOrd->second;
+                    if (o.type == t.type && o.q > 0)
+                    {
+                        if (verbose == true && deltaq > o.B + o.M) ledger.log << "<p_" << (tck + 1) << ">" << std::endl;
+                        PopBM(iItems, iOrd, deltaq, ledger);
+                    }
+                }
+                qleft -= deltaq;
+                if (qleft <= 0) break;
+            }
+        }
+    }
+
+    // Make <-1th orders
+    for (auto iOrd = std::begin(i.ord); iOrd != std::end(i.ord); iOrd++)
+    {
+        const auto &o = iOrd->second;
+        if (o.q > 0 && ((o.type == OrdType::buy  && o.p > i.Pb0()) ||
+                        (o.type == OrdType::sell && o.p < i.Ps0()) ))
+        {
+            if (verbose == true) ledger.log << "<p_-1>" << std::endl;
+            QueuePolicy::Fill(i, o, o.q);
+            orderbook.ApplyTrade(iItems, iOrd, PQ(o.p, o.q), ledger);
+        }
+    }
+}
+
+template <class FillPolicy, class QueuePolicy>
+int Simulation<FillPolicy, QueuePolicy>::ExecuteNamedReq(NamedReq<OrderSim, ItemSim> req)
+{
+    if (req.q > 0 && nReqThisTick < kTimeRates::reqPerTick)
+    {
+        verify(req.type != ReqType::ca && req.type != ReqType::sa);
+
+        auto &i = *req.iItems->second;
+
+        if (req.type == ReqType::cb || req.type == ReqType::cs || req.type == ReqType::mb || req.type == ReqType::ms)
+        {
+            // q-asserts already in OrderBook's functions
+            QueuePolicy::Cancel  (i, req.iOrd, req.q);
+            orderbook.ApplyCancel(req.iItems, req.iOrd, req.q);
+        }
+
+        if (req.type == ReqType::b  || req.type == ReqType::s  || req.type == ReqType::mb || req.type == ReqType::ms)
+        {
+            sched.Touch(req.iItems); // visit every second while it has orders
+
+            OrderSim o;
+            o.type = ((req.type == ReqType::b || req.type == ReqType::mb) ? OrdType::buy : OrdType::sell);
+            o.p    = req.p;
+
+            // immediate order (no B & M involved)
+            o.q = FillPolicy::Immediate(i, o.type, o.p, req.q);
+            if (o.q > 0)
+            {
+                auto iOrdTemp = orderbook.ApplyInsert(req.iItems, o);
+                if (verbose == true) std::cout << "<q_0>" << std::endl;
+                orderbook.ApplyTrade(req.iItems, iOrdTemp, PQ(o.p, o.q));
+                req.q -= o.q;
+            }
+
+            // delayed order (set B & M)
+            if (req.q > 0)
+            {
+                o.q = req.q;
+                o.B = FillPolicy::B(i, o.type, o.p);
+                QueuePolicy::Insert(i, o);
+                orderbook.ApplyInsert(req.iItems, o);
+            }
+        }
+    }
+    return (++nReqThisTick < kTimeRates::reqPerTick ? 0 : -1);
+}
+
+template <class FillPolicy, class QueuePolicy>
+void Simulation<FillPolicy, QueuePolicy>::PopBM(it_itm_t<ItemSim> iItems, it_ord_t<OrderSim> iOrd, INT q, TradeLedger &ledger)
+{
+    auto &o = iOrd->second;
+    q = QueuePolicy::Pop(*iItems->second, o, q);
+    if (q > 0) orderbook.ApplyTrade(iItems, iOrd, PQ(o.p, q), ledger);
+}
+
+}
+
+#endif /* SIBYL_SERVER_SIMULATION_SIMULATION_H_ */
@@ -0,0 +1,186 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_SIMULATION_SIMULATIONPOLICY_H_
+#define SIBYL_SERVER_SIMULATION_SIMULATIONPOLICY_H_
+
+#include "Simulation_data.h"
+
+namespace sibyl
+{
+
+// Policies for Simulation<FillPolicy, QueuePolicy> (see Simulation.h)
+// All members are static and resolved at compile time
+
+    /* ========================================== */
+    /*                FillPolicy                  */
+    /* ========================================== */
+
+// FillPolicy decides how the market fills own orders
+//     kospi200Index                  : read KOSPI200.txt for the index (instead of estimating from 005930)
+//     Advance(i, s)                  : ApplySecond of an item (data read ahead; see Simulation::ReadAhead)
+//     FillP0 (i, Pop)                : fill orders at p0 before trade events; Pop(iOrd, q) pops B & M
+//     LastTck(trTck)                 : trade events at trTck fill orders from p0 up to this tick
+//     Immediate(i, type, p, q)       : q of a new order to be traded on arrival
+//     B      (i, type, p)            : B of a new order queued at p (after Immediate)
+
+// Own trades at p0 deplete the table quantity until ps0/pb0 shifts (ItemSim::depS0/depB0)
+struct FillDep
+{
+    constexpr static bool kospi200Index = true;
+
+    static void Advance(ItemSim &i, ItemSecond &s) {
+        INT lastPb0 = i.Tck2P(-1, OrdType::buy );
+        INT lastPs0 = i.Tck2P(-1, OrdType::sell);
+
+        i.ApplySecond(s);
+
+        if (i.Tck2P(-1, OrdType::buy ) != lastPb0) i.depB0 = 0; // reset depletion if ps0/pb0 shifted
+        if (i.Tck2P(-1, OrdType::sell) != lastPs0) i.depS0 = 0;
+    }
+
+    // Make p0 orders with non-depleted tbqr
+    template <class TPop>
+    static void FillP0(ItemSim &i, TPop Pop) {
+        auto MakeDeplete = [&](const OrdType &type) {
+            auto &dep = (type == OrdType::buy ? i.depB0 : i.depS0);
+            INT tb0q  = i.Tck2Q(-1, type);
+            INT qleft = tb0q - dep;
+            if (qleft > 0)
+            {
+                INT p = i.Tck2P(-1, type);
+                INT delta(0);
+                const auto &first_last = i.ord.equal_range(p);
+                for (auto iOrd = first_last.first; iOrd != first_last.second; iOrd++)
+                {
+                    const auto &o = iOrd->second;
+                    if (o.type == type && o.q > 0) delta = (INT) std::max(o.M + o.q, (INT64) delta);
+                }
+                delta = std::min(qleft, delta);
+                if (delta > 0)
+                {
+                    for (auto iOrd = first_last.first; iOrd != first_last.second; iOrd++)
+                    {
+                        const auto &o = iOrd->second;
+                        if (o.type == type && o.q > 0) Pop(iOrd, delta);
+                    }
+                    dep += delta;
+                }
+            }
+            else
+                dep = tb0q;
+        };
+        MakeDeplete(OrdType::buy );
+        MakeDeplete(OrdType::sell);
+    }
+
+    static int LastTck(int trTck) { return 0; } // limit to p1; appears to provide better accuracy
+
+    static INT Immediate(ItemSim &i, OrdType type, INT p, INT q) {
+        if (p != i.Tck2P(-1, type)) return 0;
+        auto &dep = (type == OrdType::buy ? i.depB0 : i.depS0);
+        q = std::min(q, i.Tck2Q(-1, type) - dep);
+        if (q <= 0) return 0;
+        dep += q;
+        return q;
+    }
+
+    static INT64 B(const ItemSim &i, OrdType type, INT p) {
+        OrdType typeAnti = (type == OrdType::buy ? OrdType::sell : OrdType::buy);
+        bool is0     = (p == i.Tck2P(-1, type    ));
+        bool is0Anti = (p == i.Tck2P(-1, typeAnti));
+        return i.Tck2Q(i.P2Tck(p, type), type) - (is0     == true ? i.Dep(type    ) : 0)
+                                               - (is0Anti == true ? i.Dep(typeAnti) : 0);
+    }
+};
+
+// Emulates Kiwoom test server: orders at p0 are queued first, and trade events fill up to the traded tick
+struct FillTest
+{
+    constexpr static bool kospi200Index = false;
+
+    static void Advance(ItemSim &i, ItemSecond &s) { i.ApplySecond(s); }
+
+    template <class TPop>
+    static void FillP0(ItemSim &i, TPop Pop) {}
+
+    static int LastTck(int trTck) { return trTck; }
+
+    static INT Immediate(ItemSim &i, OrdType type, INT p, INT q) { return 0; }
+
+    static INT64 B(const ItemSim &i, OrdType type, INT p) {
+        return (p != i.Tck2P(-1, type) ? i.Tck2Q(i.P2Tck(p, type), type) : 0);
+    }
+};
+
+
+    /* ========================================== */
+    /*                QueuePolicy                 */
+    /* ========================================== */
+
+// QueuePolicy keeps OrderSim::B & M (queue position) up to date
+//     Insert(i, o)       : sets M of a new order (before ApplyInsert)
+//     Pop   (i, o, q)    : pops q from B & M, returns q to be traded (before ApplyTrade)
+//     Fill  (i, o, q)    : o traded q without Pop (before ApplyTrade)
+//     Cancel(i, iOrd, q) : q of *iOrd is cancelled (before ApplyCancel)
+//     Settle(i)          : call before using M of orders of i
+
+// Incremental bookkeeping in ItemSim::queue
+struct QueueLevels
+{
+    static void Insert(ItemSim &i, OrderSim &o)                      { i.queue.Insert(o); }
+    static INT  Pop   (ItemSim &i, OrderSim &o, INT q)               { return i.queue.Pop(o, q); }
+    static void Fill  (ItemSim &i, const OrderSim &o, INT q)         { i.queue.Fill(o, q); }
+    static void Cancel(ItemSim &i, it_ord_t<OrderSim> iOrd, INT q)   { i.queue.Cancel(iOrd->second, q); }
+    static void Settle(ItemSim &i)                                   { i.queue.Settle(i.ord); }
+};
+
+// Walks all orders at the price on every insert/cancel; reference for QueueLevels
+struct QueueScan
+{
+    // add M of all previous orders at p
+    static void Insert(ItemSim &i, OrderSim &o) {
+        o.M = 0;
+        const auto &first_last = i.ord.equal_range(o.p);
+        for (auto iO = first_last.first; iO != first_last.second; iO++)
+            if (iO->second.type == o.type) o.M += iO->second.q; // o.q == 0 doesn't do anything
+    }
+
+    static INT  Pop (ItemSim &i, OrderSim &o, INT q)       { return QueueModel::PopBM(o, q); }
+    static void Fill(ItemSim &i, const OrderSim &o, INT q) {}
+
+    // subtract from M of all subsequent orders at the same price
+    static void Cancel(ItemSim &i, it_ord_t<OrderSim> iOrd, INT q) {
+        const auto &first_last = i.ord.equal_range(iOrd->first);
+        const auto type = iOrd->second.type;
+        verify(iOrd != first_last.second); // iOrd must be in i
+        for (iOrd++; iOrd != first_last.second; iOrd++)
+        {
+            auto &o = iOrd->second;
+            if (o.type == type && o.q > 0) // skip already emptied orders
+            {
+                o.M -= q;
+                verify(o.M >= 0);
+            }
+        }
+    }
+
+    static void Settle(ItemSim &i) {}
+};
+
+}
+
+#endif /* SIBYL_SERVER_SIMULATION_SIMULATIONPOLICY_H_ */
@@ -17,10 +17,159 @@
 #include "Simulation_data.h"
 
 #include <fstream>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
 
 namespace sibyl
 {
 
+    /* ========================================== */
+    /*                 QueueModel                 */
+    /* ========================================== */
+
+void QueueModel::Insert(OrderSim &o)
+{
+    auto iL = Find(o.p, o.type);
+    o.M = iL->q + iL->trim; // pending trims are all ahead of o, and will be subtracted again at Settle
+    o.T = 0;
+    iL->q += o.q;
+}
+
+INT QueueModel::Pop(OrderSim &o, INT q)
+{
+    q = PopBM(o, q);
+    if (q > 0) Fill(o, q);
+    return q;
+}
+
+INT QueueModel::PopBM(OrderSim &o, INT q)
+{
+    if (o.q <= 0) return 0; // skip already emptied orders
+    
+    INT delta = (INT)std::min((INT64)q, o.B); 
+    q   -= delta;
+    o.B -= delta;
+    if (q <= 0) return 0;
+    
+    delta = (INT)std::min((INT64)q, o.M);
+    q   -= delta;
+    o.M -= delta;
+    if (q <= 0) return 0;
+    
+    return std::min(q, o.q);
+}
+
+void QueueModel::Fill(const OrderSim &o, INT q)
+{
+    Reduce(Find(o.p, o.type), q);
+}
+
+void QueueModel::Cancel(OrderSim &o, INT q)
+{
+    auto iL = Find(o.p, o.type);
+    if (iL->trim == 0) nTrim++;
+    iL->trim += q;
+    o.T      += q;
+    Reduce(iL, q);
+}
+
+void QueueModel::Settle(OrderLadder<OrderSim> &ord)
+{
+    if (nTrim == 0) return;
+    for (auto iL = std::begin(levels); iL != std::end(levels);)
+    {
+        if (iL->trim > 0)
+        {
+            INT64 trim = 0; // cancelled ahead
+            const auto &first_last = ord.equal_range(iL->p);
+            for (auto iOrd = first_last.first; iOrd != first_last.second; iOrd++)
+            {
+                auto &o = iOrd->second;
+                if (o.type != iL->type) continue;
+                if (o.q > 0 && trim > 0) // skip already emptied orders
+                {
+                    o.M -= trim;
+                    verify(o.M >= 0);
+                }
+                trim += o.T;
+                o.T   = 0;
+            }
+            iL->trim = 0;
+        }
+        if (iL->q == 0 && iL->trim == 0) iL = levels.erase(iL);
+        else                             iL++;
+    }
+    nTrim = 0;
+}
+
+std::vector<QueueModel::Level>::iterator QueueModel::Find(INT p, OrdType type)
+{
+    auto iL = std::lower_bound(std::begin(levels), std::end(levels), std::make_pair(p, type), 
+                               [](const Level &l, const std::pair<INT, OrdType> &p_type) {
+                                   return l.p < p_type.first || (l.p == p_type.first && l.type < p_type.second);
+                               });
+    if (iL == std::end(levels) || iL->p != p || iL->type != type)
+    {
+        Level l;
+        l.p    = p;
+        l.type = type;
+        l.q    = 0;
+        l.trim = 0;
+        iL = levels.insert(iL, l);
+    }
+    return iL;
+}
+
+void QueueModel::Reduce(std::vector<Level>::iterator iL, INT64 q)
+{
+    iL->q -= q;
+    if (iL->q == 0 && iL->trim == 0) levels.erase(iL);
+}
+
+
+    /* ========================================== */
+    /*                  ItemSim                   */
+    /* ========================================== */
+
+void ItemSim::close()
+{
+    dataTr.close();
+    vecTr.clear();
+    InitSum();
+    pr  = 0.0f;
+    qr  = 0;
+    tbr = {};
+    cnt = 0;
+    ord.clear();
+    depS0 = depB0 = 0;
+    queue = QueueModel();
+}
+
+void ItemSim::ApplySecond(ItemSecond &s)
+{
+    tbr = s.tbr;
+    vecTr.swap(s.vecTr);
+    sumQ  += s.sumQ;
+    sumPQ += s.sumPQ;
+}
+
+void ItemSim::ReadTrTb(int timeTarget, TxtDataTb &dataTb, ItemSecond &s)
+{
+    dataTr.InitVecTr();
+    dataTr.InitSum();
+    dataTr.AdvanceTime(timeTarget);
+    s.vecTr = dataTr.VecTr();
+    s.sumQ  = dataTr.SumQ();
+    s.sumPQ = dataTr.SumPQ();
+    
+    dataTb.AdvanceTime(timeTarget);
+    s.tbr = dataTb.Tb();
+    if (timeTarget > 0) Requantize(s.tbr, dataTr.TrPs1(), dataTr.TrPb1()); // after 09:00:00
+    else                Requantize(s.tbr);
+}
+
+
     /* ========================================== */
     /*                  KOSPISim                  */
     /* ========================================== */
@@ -32,15 +181,14 @@ bool KOSPISim::open(CSTR &path, CSTR &code)
     return true;
 }
 
-void KOSPISim::AdvanceTime(int timeTarget)
+void KOSPISim::ReadSecond(int timeTarget, ItemSecond &s)
 {
-    dataTr.InitVecTr();
-    dataTr.AdvanceTime(timeTarget);
-    
-    dataTb.AdvanceTime(timeTarget);
-    tbr = dataTb.Tb();
-    if (timeTarget > 0) Requantize(dataTr.TrPs1(), dataTr.TrPb1()); // after 09:00:00
-    else                Requantize();
+    ReadTrTb(timeTarget, dataTb, s);
+}
+
+int KOSPISim::NextTime() const
+{
+    return std::min(dataTr.NextTime(), dataTb.NextTime());
 }
 
 void KOSPISim::SetDelay(int d)
@@ -49,6 +197,12 @@ void KOSPISim::SetDelay(int d)
     dataTb.SetDelay(d);
 }
 
+void KOSPISim::close()
+{
+    ItemSim::close();
+    dataTb.close();
+}
+
 
     /* ======================================== */
     /*                  ELWSim                  */
@@ -62,6 +216,8 @@ bool ELWSim::open(CSTR &path, CSTR &code)
     if (true != dataTr.open(path + code + STR(".txt" ))) return false;
     if (true != dataTb.open(path + code + STR("t.txt"))) return false;
     if (true != dataTh.open(path + code + STR("g.txt"))) return false;
+    static std::mutex mtxKOSPI200; // items may be opened in parallel
+    std::lock_guard<std::mutex> lock(mtxKOSPI200);
     if ((dataKOSPI200Tr.is_open() == false) &&
         (true != dataKOSPI200Tr.open(path + STR("005930.txt" )))) return false;
     if ((dataKOSPI200Tb.is_open() == false) &&
@@ -69,28 +225,39 @@ bool ELWSim::open(CSTR &path, CSTR &code)
     return true;
 }
 
-void ELWSim::AdvanceTime(int timeTarget)
+void ELWSim::ReadSecond(int timeTarget, ItemSecond &s)
 {
-    dataTr.InitVecTr();
-    dataTr.AdvanceTime(timeTarget);
-    
-    dataTb.AdvanceTime(timeTarget);
-    tbr = dataTb.Tb();
-    if (timeTarget > 0) Requantize(dataTr.TrPs1(), dataTr.TrPb1()); // after 09:00:00
-    else                Requantize();
+    ReadTrTb(timeTarget, dataTb, s);
     
     dataTh.AdvanceTime(timeTarget);
-    for (std::size_t idx = 0; idx < szTh; idx++) thr[idx] = dataTh[idx + 1];
+    for (std::size_t idx = 0; idx < szTh; idx++) s.ext[idx] = dataTh[idx + 1];
+}
+
+void ELWSim::ApplySecond(ItemSecond &s)
+{
+    ItemSim::ApplySecond(s);
+    for (std::size_t idx = 0; idx < szTh; idx++) thr[idx] = s.ext[idx];
+}
+
+void ELWSim::AdvanceKOSPI200(int timeTarget, FLOAT &index)
+{
+    if (dataKOSPI200Tr.is_open() == false) return; // no ELW opened
     
     dataKOSPI200Tr.InitVecTr();
     dataKOSPI200Tr.AdvanceTime(timeTarget);
     
     dataKOSPI200Tb.AdvanceTime(timeTarget);
     auto temp = dataKOSPI200Tb.Tb();
-    if (timeTarget > 0) Requantize(temp, dataKOSPI200Tr.TrPs1(), dataKOSPI200Tr.TrPb1());
-    else                Requantize(temp);
+    // ELW tick rules (as when this was done in AdvanceTime of each ELW)
+    if (timeTarget > 0) RequantizeBy<Rules>(temp, dataKOSPI200Tr.TrPs1(), dataKOSPI200Tr.TrPb1());
+    else                RequantizeBy<Rules>(temp, temp[idx::ps1].p      , temp[idx::pb1].p      );
     
-    kospi200 = TckLo(temp[idx::ps1].p) / 5000.0f;
+    index = Rules::TckLo(temp[idx::ps1].p) / 5000.0f;
+}
+
+int ELWSim::NextTime() const
+{
+    return std::min(std::min(dataTr.NextTime(), dataTb.NextTime()), dataTh.NextTime());
 }
 
 void ELWSim::SetDelay(int d)
@@ -102,6 +269,21 @@ void ELWSim::SetDelay(int d)
     dataKOSPI200Tb.SetDelay(d);
 }
 
+void ELWSim::close()
+{
+    ItemSim::close();
+    dataTb.close();
+    dataTh.close();
+    thr = {};
+}
+
+void ELWSim::CloseKOSPI200()
+{
+    dataKOSPI200Tr.close();
+    dataKOSPI200Tb.close();
+    kospi200 = (FLOAT) std::nan("");
+}
+
 
     /* ========================================== */
     /*                   ETFSim                   */
@@ -115,18 +297,23 @@ bool ETFSim::open(CSTR &path, CSTR &code)
     return true;
 }
 
-void ETFSim::AdvanceTime(int timeTarget)
+void ETFSim::ReadSecond(int timeTarget, ItemSecond &s)
 {
-    dataTr.InitVecTr();
-    dataTr.AdvanceTime(timeTarget);
-    
-    dataTb.AdvanceTime(timeTarget);
-    tbr = dataTb.Tb();
-    if (timeTarget > 0) Requantize(dataTr.TrPs1(), dataTr.TrPb1()); // after 09:00:00
-    else                Requantize();
+    ReadTrTb(timeTarget, dataTb, s);
     
     dataNAV.AdvanceTime(timeTarget);
-    devNAV = (FLOAT) ((std::abs(dataNAV[1] / dataNAV[0]) - 1.0) * 100.0);
+    s.ext[0] = (FLOAT) ((std::abs(dataNAV[1] / dataNAV[0]) - 1.0) * 100.0);
+}
+
+void ETFSim::ApplySecond(ItemSecond &s)
+{
+    ItemSim::ApplySecond(s);
+    devNAV = s.ext[0];
+}
+
+int ETFSim::NextTime() const
+{
+    return std::min(std::min(dataTr.NextTime(), dataTb.NextTime()), dataNAV.NextTime());
 }
 
 void ETFSim::SetDelay(int d)
@@ -136,5 +323,13 @@ void ETFSim::SetDelay(int d)
     dataNAV.SetDelay(d);
 }
 
+void ETFSim::close()
+{
+    ItemSim::close();
+    dataTb .close();
+    dataNAV.close();
+    devNAV = 0.0f;
+}
+
 
 }
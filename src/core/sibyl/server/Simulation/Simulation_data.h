@@ -22,6 +22,9 @@
 #include "TxtData.h"
 #include "../NetServer.h"
 
+#include <chrono>
+#include <ostream>
+
 namespace sibyl
 {
 
@@ -30,27 +33,105 @@ class OrderSim : public Order
 public:
     INT64 B; // # of orders queued by others before this order
     INT64 M; // # of orders queued by   me   before this order
-    OrderSim() : B(0), M(0) {}
+    INT64 T; // cancelled from this order, yet to be subtracted from M of orders behind (see QueueModel)
+    OrderSim() : B(0), M(0), T(0) {}
 };
 
-class ItemSim : public Item<OrderSim>
+// Bookkeeping of B & M for all orders of an item
+// My total quantity is kept per price level so that M of a new order is O(1),
+// and cancels only mark the cancelled order; Settle carries them over to the orders
+// behind in a single in-order pass over the level (done once per second anyway)
+class QueueModel
 {
 public:
-    virtual bool open       (CSTR &path, CSTR &code) = 0;
-    virtual void AdvanceTime(int timeTarget)         = 0;
-    virtual void SetDelay   (int d)                  = 0;
-    TxtDataTr&   TrData     () { return dataTr; }   // use this to InitSum() or const access vecTr
+    void Insert(OrderSim &o);               // sets o.M of a new order to be staged (call before ApplyInsert)
+    INT  Pop   (OrderSim &o, INT q);        // pops q from B & M; returns q to be traded (call before ApplyTrade)
+    void Fill  (const OrderSim &o, INT q);  // o traded q without going through B & M (call before ApplyTrade)
+    void Cancel(OrderSim &o, INT q);        // M of all subsequent orders at o.p is to be reduced by q (call before ApplyCancel)
+    void Settle(OrderLadder<OrderSim> &ord); // applies pending cancels; call before using M
+    
+    static INT PopBM(OrderSim &o, INT q); // Pop without bookkeeping of level totals
+    
+    QueueModel() : nTrim(0) {}
+private:
+    struct Level {
+        INT     p;
+        OrdType type;
+        INT64   q;    // sum of o.q at this level
+        INT64   trim; // sum of pending o.T at this level
+    };
+    std::vector<Level> levels; // sorted by (p, type)
+    std::size_t nTrim;         // # of levels with pending trims
+    
+    std::vector<Level>::iterator Find(INT p, OrdType type); // inserts if nonexistent
+    void Reduce(std::vector<Level>::iterator iL, INT64 q);  // drops the level when emptied
+};
 
-    // "depletion"; only used by Simulation_dep
+// Market data of an item for a second, read ahead of matching (see Simulation::ReadAhead)
+// Market data does not depend on own orders, so it can be read while the client decides on reqs
+struct ItemSecond
+{
+    std::array<PQ, idx::szTb> tbr; // requantized
+    std::vector<PQ> vecTr;         // trade events
+    INT64 sumQ, sumPQ;             // of vecTr, including events not matched (see TxtDataTr::Cur2Last)
+    std::array<FLOAT, ELW<Security<PQ>>::szTh> ext; // ELW: thr, ETF: devNAV in [0]
+    ItemSecond() : tbr{}, sumQ(0), sumPQ(0), ext{} {}
+};
+
+class ItemSim : public Item<OrderSim>
+{
+public:
+    virtual bool open       (CSTR &path, CSTR &code)         = 0;
+    virtual void ReadSecond (int timeTarget, ItemSecond &s)  = 0; // advance own data only; item state unchanged
+    virtual void ApplySecond(ItemSecond &s);                      // state of the second read (s is left for reuse)
+    virtual void SetDelay   (int d)                          = 0;
+    virtual int  NextTime   () const                         = 0; // earliest TxtData::NextTime of own data
+    virtual void close      ();                                   // closes own data & clears state (reusable for another day)
+
+    // Trade events of the second applied, cleared once matched (see Simulation::SimulateTrades),
+    // and their sums since the last InitSum (every kTimeRates::secPerTick sec)
+    std::vector<PQ> vecTr;
+    INT64 sumQ, sumPQ;
+    void InitSum() { sumQ = sumPQ = 0; }
+
+    // "depletion"; only used by FillDep
     INT depS0, depB0; 
-    ItemSim() : depS0(0), depB0(0) {}
+    INT Dep(OrdType type) const { return (type == OrdType::sell ? depS0 : (type == OrdType::buy ? depB0 : 0)); }
+    
+    QueueModel queue;
+    ItemSim() : sumQ(0), sumPQ(0), depS0(0), depB0(0) {}
 
 protected:
     TxtDataTr dataTr;
+    void ReadTrTb(int timeTarget, TxtDataTb &dataTb, ItemSecond &s); // common part of ReadSecond
 };
 
 typedef NetServer<OrderSim, ItemSim> SimulationServer;
 
+typedef std::chrono::steady_clock LoadClock;
+
+// Wall time spent in each phase of LoadData (ms)
+struct LoadTime
+{
+    double config, discover, resolve, open, insert, total;
+    std::size_t nThreads;
+    
+    void Print(std::ostream &os) const {
+        os << "[Load] config "   << config
+           << " ms, discover "   << discover
+           << " ms, resolve "    << resolve
+           << " ms, open "       << open
+           << " ms, insert "     << insert
+           << " ms, other "      << total - (config + discover + resolve + open + insert)
+           << " ms, total "      << total
+           << " ms (" << nThreads << " threads)" << std::endl;
+    }
+    static double Ms(LoadClock::time_point t0, LoadClock::time_point t1) {
+        return std::chrono::duration<double, std::milli>(t1 - t0).count();
+    }
+    LoadTime() : config(0.0), discover(0.0), resolve(0.0), open(0.0), insert(0.0), total(0.0), nThreads(0) {}
+};
+
 
     /* ========================================== */
     /*                  KOSPISim                  */
@@ -60,8 +141,10 @@ class KOSPISim : public KOSPI<ItemSim>
 {
 public:
     bool open       (CSTR &path, CSTR &code);
-    void AdvanceTime(int timeTarget);
+    void ReadSecond (int timeTarget, ItemSecond &s);
     void SetDelay   (int d);
+    int  NextTime   () const;
+    void close      () override;
 
     KOSPISim() : dataTb(SecType::KOSPI) {}
 private:
@@ -77,8 +160,16 @@ class ELWSim : public ELW<ItemSim>
 {
 public:
     bool open       (CSTR &path, CSTR &code);
-    void AdvanceTime(int timeTarget);
+    void ReadSecond (int timeTarget, ItemSecond &s);
     void SetDelay   (int d);
+    int  NextTime   () const;
+    void ApplySecond(ItemSecond &s) override;
+    void close      () override;
+
+    // Shared by all ELWs; call once per second along with ReadSecond of items
+    // index is set to KOSPI200 estimated from 005930 (unchanged if no ELW opened)
+    static void AdvanceKOSPI200(int timeTarget, FLOAT &index);
+    static void CloseKOSPI200  ();
 
     ELWSim()                 :            dataTb(SecType::ELW), dataTh(1 + szTh) {}
     ELWSim(OptType t, INT e) : ELW(t, e), dataTb(SecType::ELW), dataTh(1 + szTh) {}
@@ -98,8 +189,11 @@ class ETFSim : public ETF<ItemSim>
 {
 public:
     bool open       (CSTR &path, CSTR &code);
-    void AdvanceTime(int timeTarget);
+    void ReadSecond (int timeTarget, ItemSecond &s);
     void SetDelay   (int d);
+    int  NextTime   () const;
+    void ApplySecond(ItemSecond &s) override;
+    void close      () override;
 
     ETFSim() : dataTb(SecType::ETF), dataNAV(2) {}
 private:
@@ -17,12 +17,61 @@
 #include "TxtData.h"
 
 #include <iostream>
+#include <unistd.h>
 
 namespace sibyl
 {
 
+static STR BinName(CSTR &filename)
+{
+    constexpr static char ext[] = ".txt";
+    constexpr static std::size_t szExt = sizeof(ext) - 1;
+    if (filename.size() > szExt && filename.compare(filename.size() - szExt, szExt, ext) == 0)
+        return filename.substr(0, filename.size() - szExt) + ".bin";
+    return STR();
+}
+
+bool TxtData::Exists(CSTR &filename_)
+{
+    if (ZipArchive::IsZipPath(filename_) == true) return ZipArchive::Exists(filename_);
+    STR filenameBin = BinName(filename_);
+    return (0 == access(filename_.c_str(), R_OK)) ||
+           (filenameBin.empty() == false && 0 == access(filenameBin.c_str(), R_OK));
+}
+
 bool TxtData::open(CSTR &filename_)
 {
+    if (ZipArchive::IsZipPath(filename_) == true)
+    {
+        if (zin.open(filename_) == true)
+        {
+            filename = filename_;
+            AdvanceLine();
+            if (open_bool == true) Cur2Last(false);
+        }
+        else
+            std::cerr << "TxtData.open: " << filename_ << " inaccessible" << std::endl;
+        return open_bool;
+    }
+    
+    STR filenameBin = BinName(filename_);
+    if (filenameBin.empty() == false)
+    {
+        if (bin.open(filenameBin) == true)
+        {
+            if (bin.Kind() == DataKind())
+            {
+                filename = filenameBin;
+                row = 0;
+                AdvanceLine();
+                if (open_bool == true) Cur2Last(false);
+                return open_bool;
+            }
+            std::cerr << "TxtData.open: " << filenameBin << " kind mismatch, reading text" << std::endl;
+            bin.close();
+        }
+    }
+    
     pf = fopen(filename_.c_str(), "r");
     if (pf != nullptr)
     {
@@ -40,6 +89,22 @@ bool TxtData::is_open() const
     return open_bool;
 }
 
+void TxtData::close()
+{
+    if (pf != nullptr)
+    {
+        fclose(pf);
+        pf = nullptr;
+    }
+    zin.close();
+    bin.close();
+    time  = kTimeBounds::null;
+    delay = 0;
+    row   = 0;
+    filename.clear();
+    open_bool = false;
+}
+
 void TxtData::AdvanceTime(int timeTarget)
 {
     while (open_bool == true && time < timeTarget) {
@@ -50,10 +115,23 @@ void TxtData::AdvanceTime(int timeTarget)
 
 void TxtData::AdvanceLine()
 {
+    if (bin.is_open() == true)
+    {
+        open_bool = false;
+        if (row < bin.Rows())
+        {
+            time = bin.Time()[row] - delay;
+            if (0 == ReadRow(bin, row)) open_bool = true;
+            else std::cerr << "TxtData.AdvanceLine: invalid format in " << filename << " row " << row << std::endl;
+            row++;
+        }
+        return;
+    }
+    
     constexpr static std::size_t szBuf = (1 << 12);
-    static char bufLine[szBuf];
+    char bufLine[szBuf]; // not static; items may be read in parallel
     
-    char *pcLine = fgets(bufLine, szBuf, pf);
+    char *pcLine = (pf != nullptr ? fgets(bufLine, szBuf, pf) : zin.Gets(bufLine, (int)szBuf));
     bool success = true;
     bool invalid = false;
     if (pcLine == NULL) success = false; // end of file
@@ -122,6 +200,21 @@ int TxtDataTr::ReadLine(const char *pcLine)
     return (invalid == false ? 0 : -1);
 }
 
+int TxtDataTr::ReadRow(const BinData &bin, std::size_t row)
+{
+    if (bin.Elem() != BinElem::i32 || bin.Cols() < 4) return -1;
+    if (time >= 0)
+    {
+        cur.q   = std::abs(static_cast<const int32_t*>(bin.Col(0))[row]);
+        cur.p   = std::abs(static_cast<const int32_t*>(bin.Col(1))[row]);
+        cur.ps1 = std::abs(static_cast<const int32_t*>(bin.Col(2))[row]);
+        cur.pb1 = std::abs(static_cast<const int32_t*>(bin.Col(3))[row]);
+    }
+    else // ignore trade data before 09:00:00 as their ps1/pb1 values are invalid
+        cur.q = cur.p = cur.ps1 = cur.pb1 = 0;
+    return 0;
+}
+
 void TxtDataTr::Cur2Last(bool sum)
 {
     last = cur;
@@ -205,6 +298,17 @@ int TxtDataTb::ReadLine(const char *pcLine)
     return (invalid == false ? 0 : -1);
 }
 
+int TxtDataTb::ReadRow(const BinData &bin, std::size_t row)
+{
+    if (bin.Elem() != BinElem::i32 || bin.Cols() < 2 * idx::szTb) return -1;
+    for (std::size_t i = 0; i < idx::szTb; i++)
+    {
+        cur[i].p = std::abs(static_cast<const int32_t*>(bin.Col(i            ))[row]);
+        cur[i].q = std::abs(static_cast<const int32_t*>(bin.Col(i + idx::szTb))[row]);
+    }
+    return 0;
+}
+
 void TxtDataTb::Cur2Last(bool sum)
 {
     last = cur;
@@ -20,35 +20,54 @@
 #include <vector>
 #include <sstream>
 #include <cstring>
+#include <limits>
 
 #include "../../time_common.h"
 #include "../../Security.h"
+#include "BinData.h"
+#include "ZipArchive.h"
 
 namespace sibyl
 {
 
+// Reads <name>.bin (see BinData.h) in place of <name>.txt if the former exists
+// <name>.txt may also be inside an archive (<archive>.zip/<name>.txt; see ZipArchive.h)
 class TxtData
 {
 public:
     bool open(CSTR &filename_);
     bool is_open() const;
+    virtual void close(); // back to the state before open (reusable)
     void AdvanceTime(int timeTarget); // TxtDataTr requires InitSum | InitVecTr prior to this
     void SetDelay(int d);
+    int  NextTime() const; // time of the next unread event (max int if none); AdvanceTime(t) reads it if < t
     
-    TxtData() : time(kTimeBounds::null), delay(0), pf(nullptr), open_bool(false) {}
-    ~TxtData() { if (pf != nullptr) fclose(pf); }
+    static int  Txt2Time(int txt);
+    static bool Exists  (CSTR &filename_); // filename_ (.txt) or its .bin counterpart is readable
+    
+    TxtData() : time(kTimeBounds::null), delay(0), pf(nullptr), row(0), open_bool(false) {}
+    virtual ~TxtData() { if (pf != nullptr) fclose(pf); }
 protected:
-    virtual int  ReadLine(const char *pcLine) = 0; // returns non-0 to signal invalid format
-    virtual void Cur2Last(bool sum)           = 0; // backup 'cur' to 'last' & and sum last (if applicable)
+    virtual int     ReadLine(const char *pcLine)                  = 0; // returns non-0 to signal invalid format
+    virtual int     ReadRow (const BinData &bin, std::size_t row) = 0; // binary counterpart of ReadLine
+    virtual BinKind DataKind() const                              = 0;
+    virtual void    Cur2Last(bool sum)                            = 0; // backup 'cur' to 'last' & and sum last (if applicable)
     int time, delay; // note: read only for derived classes
 private:
     void AdvanceLine(); // read new line to 'cur', read time, check eof & formatting error
-    static int Txt2Time(int txt);
     FILE *pf;
+    ZipStream zin;
+    BinData bin;
+    std::size_t row; // next row of bin
     STR filename;
     bool open_bool;
 };
 
+inline int TxtData::NextTime() const
+{
+    return (open_bool == true ? time : std::numeric_limits<int>::max());
+}
+
 
     /* =========================================== */
     /*                  TxtDataTr                  */
@@ -59,6 +78,7 @@ class TxtDataTr : public TxtData
 public:
     void InitSum  () { sumQ = sumPQ = 0; } // every kTimeRates::secPerTick sec
     void InitVecTr() { vecTr.clear();    } // every           1            sec
+    void close() override { TxtData::close(); InitSum(); InitVecTr(); cur = last = {}; }
     const std::vector<PQ>& VecTr() const { return vecTr; }
     const INT64&           SumQ () const { return sumQ; }
     const INT64&           SumPQ() const { return sumPQ; }
@@ -68,8 +88,10 @@ public:
     TxtDataTr() : sumQ(0), sumPQ(0), cur{}, last{} {}
 private:
     // virtuals from TxtData
-    int  ReadLine(const char *pcLine);
-    void Cur2Last(bool sum);
+    int     ReadLine(const char *pcLine);
+    int     ReadRow (const BinData &bin, std::size_t row);
+    BinKind DataKind() const { return BinKind::tr; }
+    void    Cur2Last(bool sum);
     
     // sums    
     INT64 sumQ, sumPQ;
@@ -87,11 +109,14 @@ class TxtDataTb : public TxtData
 {
 public:
     const std::array<PQ, idx::szTb>& Tb() { return last; }
+    void close() override { TxtData::close(); cur = last = {}; }
     TxtDataTb(SecType type_) : type(type_) {}
 private:
     // virtuals from TxtData
-    int  ReadLine(const char *pcLine);
-    void Cur2Last(bool sum);
+    int     ReadLine(const char *pcLine);
+    int     ReadRow (const BinData &bin, std::size_t row);
+    BinKind DataKind() const { return BinKind::tb; }
+    void    Cur2Last(bool sum);
 
     SecType type;
 
@@ -108,11 +133,14 @@ class TxtDataVec : public TxtData
 {
 public:
     const T& operator[](std::size_t pos) { return last.at(pos); }
+    void close() override { TxtData::close(); cur.assign(cur.size(), T()); last.assign(last.size(), T()); }
     TxtDataVec(int nFields_);
 private:
     // virtuals from TxtData
-    int  ReadLine(const char *pcLine);
-    void Cur2Last(bool sum);
+    int     ReadLine(const char *pcLine);
+    int     ReadRow (const BinData &bin, std::size_t row);
+    BinKind DataKind() const { return BinKind::vec; }
+    void    Cur2Last(bool sum);
     
     int nFields;
     std::vector<T> cur, last;
@@ -151,6 +179,15 @@ int TxtDataVec<T>::ReadLine(const char *pcLine)
     return (invalid == false ? 0 : -1);
 }
 
+template <class T>
+int TxtDataVec<T>::ReadRow(const BinData &bin, std::size_t row)
+{
+    if (bin.Cols() < (std::size_t)nFields) return -1;
+    for (std::size_t iField = 0; iField < (std::size_t)nFields; iField++)
+        cur[iField] = (T)bin.At(iField, row);
+    return 0;
+}
+
 template <class T>
 void TxtDataVec<T>::Cur2Last(bool sum)
 {
@@ -0,0 +1,298 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "ZipArchive.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <mutex>
+
+namespace sibyl
+{
+
+static uint16_t Rd16(const char *p) { uint16_t v; memcpy(&v, p, sizeof(v)); return v; } // zip is little endian
+static uint32_t Rd32(const char *p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+constexpr static uint32_t sigEOCD  = 0x06054b50;
+constexpr static uint32_t sigCDir  = 0x02014b50;
+constexpr static uint32_t sigLocal = 0x04034b50;
+
+constexpr static std::size_t szEOCD  = 22;
+constexpr static std::size_t szCDir  = 46;
+constexpr static std::size_t szLocal = 30;
+
+std::shared_ptr<ZipArchive> ZipArchive::Resolve(CSTR &filename, STR &entry)
+{
+    static std::mutex mtx;
+    static std::map<STR, std::weak_ptr<ZipArchive>> cache;
+
+    if (IsZipPath(filename) == false) return nullptr;
+    auto pos = filename.find(".zip/");
+    STR name = (pos != std::string::npos ? filename.substr(0, pos + 4) : filename);
+    entry    = (pos != std::string::npos ? filename.substr(pos + 5)    : STR());
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto &wp = cache[name];
+    auto sp = wp.lock();
+    if (sp == nullptr)
+    {
+        sp = std::make_shared<ZipArchive>();
+        if (0 != sp->open(name)) sp.reset();
+        wp = sp;
+    }
+    return sp;
+}
+
+bool ZipArchive::IsZipPath(CSTR &filename)
+{
+    return (filename.find(".zip/") != std::string::npos) ||
+           (filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".zip") == 0);
+}
+
+bool ZipArchive::Exists(CSTR &filename)
+{
+    if (IsZipPath(filename) == false) return (0 == access(filename.c_str(), R_OK));
+    STR entry;
+    auto pArchive = Resolve(filename, entry);
+    return (pArchive != nullptr && pArchive->Find(entry) != nullptr);
+}
+
+bool ZipArchive::ReadFile(CSTR &filename, STR &contents)
+{
+    contents.clear();
+    if (IsZipPath(filename) == false)
+    {
+        std::ifstream sFile(filename);
+        if (sFile.is_open() == false) return false;
+        std::ostringstream ss;
+        ss << sFile.rdbuf();
+        contents = ss.str();
+        return true;
+    }
+    ZipStream zs;
+    if (zs.open(filename) == false) return false;
+    constexpr static std::size_t szBuf = (1 << 12);
+    char buf[szBuf];
+    while (zs.Gets(buf, (int)szBuf) != NULL) contents.append(buf);
+    return true;
+}
+
+int ZipArchive::open(CSTR &filename_)
+{
+    filename = filename_;
+    auto Error = [&](CSTR &str) {
+        std::cerr << "ZipArchive.open: " << filename << " " << str << std::endl;
+        return -1;
+    };
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) return Error("inaccessible");
+    struct stat sFile;
+    if (-1 == fstat(fd, &sFile) || (std::size_t)sFile.st_size < szEOCD)
+    {
+        ::close(fd);
+        return Error("invalid");
+    }
+    szMap = (std::size_t)sFile.st_size;
+    pMap  = mmap(nullptr, szMap, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (pMap == MAP_FAILED)
+    {
+        pMap = nullptr;
+        return Error("mmap failed");
+    }
+
+    // end of central directory record, followed by a comment of up to 64 KiB
+    const char *pc   = static_cast<const char*>(pMap);
+    const char *pEnd = pc + szMap;
+    const char *pEOCD = nullptr;
+    for (const char *p = pEnd - szEOCD; p >= pc && pEnd - p <= (std::ptrdiff_t)(szEOCD + 0xFFFF); p--)
+    {
+        if (Rd32(p) == sigEOCD)
+        {
+            pEOCD = p;
+            break;
+        }
+    }
+    if (pEOCD == nullptr) return Error("end of central directory not found");
+
+    std::size_t nEntries = Rd16(pEOCD + 10);
+    std::size_t offCDir  = Rd32(pEOCD + 16);
+    if (nEntries == 0xFFFF || offCDir == 0xFFFFFFFF) return Error("zip64 not supported");
+
+    const char *p = pc + offCDir;
+    for (std::size_t i = 0; i < nEntries; i++)
+    {
+        if (p + szCDir > pEnd || Rd32(p) != sigCDir) return Error("corrupt central directory");
+        std::size_t szName    = Rd16(p + 28);
+        std::size_t szExtra   = Rd16(p + 30);
+        std::size_t szComment = Rd16(p + 32);
+        if (p + szCDir + szName > pEnd) return Error("corrupt central directory");
+
+        Entry e;
+        e.method   = Rd16(p + 10);
+        e.szComp   = Rd32(p + 20);
+        e.szOrig   = Rd32(p + 24);
+        e.offLocal = Rd32(p + 42);
+        STR name(p + szCDir, szName);
+        if (name.empty() == false && name.back() != '/') // skip directories
+            entries[name] = e;
+
+        p += szCDir + szName + szExtra + szComment;
+    }
+    return 0;
+}
+
+ZipArchive::~ZipArchive()
+{
+    if (pMap != nullptr) munmap(pMap, szMap);
+}
+
+const ZipArchive::Entry* ZipArchive::Find(CSTR &entry) const
+{
+    auto it = entries.find(entry);
+    return (it != std::end(entries) ? &it->second : nullptr);
+}
+
+std::vector<STR> ZipArchive::List(CSTR &dir) const
+{
+    std::vector<STR> names;
+    for (auto it = entries.lower_bound(dir); it != std::end(entries); it++)
+    {
+        const auto &name = it->first;
+        if (name.compare(0, dir.size(), dir) != 0) break; // entries are sorted
+        if (name.find('/', dir.size()) == std::string::npos)
+            names.push_back(name.substr(dir.size()));
+    }
+    return names;
+}
+
+const char* ZipArchive::Data(const Entry &e) const
+{
+    const char *pc  = static_cast<const char*>(pMap);
+    if (e.offLocal + szLocal > szMap || Rd32(pc + e.offLocal) != sigLocal) return nullptr;
+    std::size_t off = e.offLocal + szLocal + Rd16(pc + e.offLocal + 26) + Rd16(pc + e.offLocal + 28);
+    if (off + e.szComp > szMap) return nullptr;
+    return pc + off;
+}
+
+
+    /* =========================================== */
+    /*                  ZipStream                  */
+    /* =========================================== */
+
+bool ZipStream::open(CSTR &filename)
+{
+    close();
+
+    STR entry;
+    auto pArchive_ = ZipArchive::Resolve(filename, entry);
+    if (pArchive_ == nullptr) return false;
+    pEntry = pArchive_->Find(entry);
+    if (pEntry == nullptr) return false;
+    pIn = pArchive_->Data(*pEntry);
+    if (pIn == nullptr || (pEntry->method != 0 && pEntry->method != 8))
+    {
+        std::cerr << "ZipStream.open: " << filename << " corrupt or unsupported compression" << std::endl;
+        return false;
+    }
+
+    if (pEntry->method == 8)
+    {
+        memset(&zs, 0, sizeof(zs));
+        zs.next_in  = reinterpret_cast<Bytef*>(const_cast<char*>(pIn));
+        zs.avail_in = (uInt)pEntry->szComp;
+        if (Z_OK != inflateInit2(&zs, -MAX_WBITS)) return false; // raw deflate
+        zinit = true;
+        out.resize(szOut);
+    }
+    pArchive  = pArchive_;
+    posOut    = endOut = posStored = 0;
+    eof       = false;
+    return true;
+}
+
+void ZipStream::close()
+{
+    if (zinit == true) inflateEnd(&zs);
+    zinit = false;
+    pArchive.reset();
+    pEntry = nullptr;
+    pIn    = nullptr;
+    eof    = true;
+}
+
+bool ZipStream::Refill()
+{
+    if (eof == true) return false;
+    if (pEntry->method == 0) // stored; read directly from the mapped archive
+    {
+        eof = (posStored >= pEntry->szComp);
+        posOut = posStored;
+        endOut = pEntry->szComp;
+        posStored = endOut;
+        return (eof == false);
+    }
+
+    zs.next_out  = reinterpret_cast<Bytef*>(out.data());
+    zs.avail_out = (uInt)szOut;
+    int ret = inflate(&zs, Z_NO_FLUSH);
+    if (ret != Z_OK && ret != Z_STREAM_END)
+    {
+        std::cerr << "ZipStream.Refill: inflate error " << ret << std::endl;
+        eof = true;
+        return false;
+    }
+    posOut = 0;
+    endOut = szOut - zs.avail_out;
+    if (ret == Z_STREAM_END && endOut == 0) eof = true;
+    return (endOut > 0);
+}
+
+char* ZipStream::Gets(char *str, int num)
+{
+    if (is_open() == false || num <= 1) return NULL;
+    const char *src = (pEntry->method == 0 ? pIn : out.data());
+
+    int n = 0;
+    while (n < num - 1)
+    {
+        if (posOut == endOut)
+        {
+            if (Refill() == false) break;
+            src = (pEntry->method == 0 ? pIn : out.data());
+        }
+        std::size_t len = std::min(endOut - posOut, (std::size_t)(num - 1 - n));
+        const char *pNL = static_cast<const char*>(memchr(src + posOut, '\n', len));
+        if (pNL != nullptr) len = (std::size_t)(pNL - (src + posOut)) + 1;
+        memcpy(str + n, src + posOut, len);
+        n      += (int)len;
+        posOut += len;
+        if (pNL != nullptr) break;
+    }
+    if (n == 0) return NULL;
+    str[n] = '\0';
+    return str;
+}
+
+}
@@ -0,0 +1,103 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_SERVER_SIMULATION_ZIPARCHIVE_H_
+#define SIBYL_SERVER_SIMULATION_ZIPARCHIVE_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <map>
+
+#include <zlib.h>
+
+#include "../../sibyl_common.h"
+
+namespace sibyl
+{
+
+// Read-only view of a .zip archive (stored or deflated entries, no zip64)
+// Files inside are addressed as <archive>.zip/<entry>, e.g., /data/20170101.zip/ETF/069500.txt,
+// so that data paths may point into an archive instead of an extracted directory
+class ZipArchive
+{
+public:
+    struct Entry
+    {
+        std::size_t offLocal; // offset of local file header
+        std::size_t szComp;
+        std::size_t szOrig;
+        uint16_t    method;   // 0: stored, 8: deflated
+    };
+
+    // Splits filename into archive & entry and returns the (cached) archive;
+    // nullptr if filename does not point into a .zip archive or the archive is invalid
+    // Note: archives stay cached only while a returned pointer is alive
+    static std::shared_ptr<ZipArchive> Resolve(CSTR &filename, STR &entry);
+    static bool IsZipPath(CSTR &filename); // <archive>.zip[/<entry>]
+
+    // Helpers for files that may or may not be inside an archive
+    static bool Exists  (CSTR &filename);
+    static bool ReadFile(CSTR &filename, STR &contents);
+
+    const Entry*     Find(CSTR &entry) const; // nullptr if nonexistent
+    std::vector<STR> List(CSTR &dir)   const; // names of files directly under dir ("" for root, else with trailing '/')
+    const char*      Data(const Entry &e) const; // compressed data of e; nullptr if corrupt
+
+    ZipArchive() : pMap(nullptr), szMap(0) {}
+    ZipArchive           (const ZipArchive&) = delete;
+    ZipArchive& operator=(const ZipArchive&) = delete;
+    ~ZipArchive();
+private:
+    int open(CSTR &filename); // non-0 for any error
+
+    void       *pMap;
+    std::size_t szMap;
+    STR         filename;
+    std::map<STR, Entry> entries;
+};
+
+// Sequential reader of a single archive entry, inflating on the fly
+class ZipStream
+{
+public:
+    bool  open (CSTR &filename); // <archive>.zip/<entry>
+    void  close();
+    bool  is_open() const { return pArchive != nullptr; }
+    char* Gets (char *str, int num); // same semantics as fgets
+
+    ZipStream() : pEntry(nullptr), pIn(nullptr), posOut(0), endOut(0), posStored(0), eof(false), zinit(false) {}
+    ZipStream           (const ZipStream&) = delete;
+    ZipStream& operator=(const ZipStream&) = delete;
+    ~ZipStream() { close(); }
+private:
+    bool Refill(); // false if no more data
+
+    constexpr static std::size_t szOut = (1 << 16);
+
+    std::shared_ptr<ZipArchive> pArchive;
+    const ZipArchive::Entry    *pEntry;
+    const char                 *pIn;
+    std::vector<char>           out;
+    std::size_t                 posOut, endOut, posStored;
+    bool eof, zinit;
+    z_stream zs;
+};
+
+}
+
+#endif /* SIBYL_SERVER_SIMULATION_ZIPARCHIVE_H_ */
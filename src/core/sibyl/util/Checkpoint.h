@@ -0,0 +1,147 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_UTIL_CHECKPOINT_H_
+#define SIBYL_UTIL_CHECKPOINT_H_
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <type_traits>
+
+#include "../sibyl_common.h"
+
+namespace sibyl
+{
+
+// Binary buffer of values put one after another, saved to & loaded from a file as a whole
+// (see Trader::SetCheckpoint); values are in host byte order, as the file is read back on the same host
+// Save writes <path>.tmp and renames it over path, so a crash while saving leaves the previous file intact
+class Checkpoint
+{
+public:
+    // writing
+    void Clear() { buf.clear(); pos = 0; fail = false; }
+    template <class T> void Put(const T &v);
+    template <class T> void Put(const std::vector<T> &vec);
+    void Put(CSTR &s);
+    int  Save(CSTR &path) const; // returns non-0 to signal error
+
+    // reading, in the order written; Good turns false at the first read past the end
+    int  Load(CSTR &path);       // returns non-0 if inaccessible
+    template <class T> void Get(T &v);
+    template <class T> void Get(std::vector<T> &vec);
+    void Get(STR &s);
+    bool Good() const { return fail == false; }
+
+    Checkpoint() : pos(0), fail(false) {}
+private:
+    std::vector<char> buf;
+    std::size_t pos;
+    bool fail;
+
+    bool Take(void *dst, std::size_t len) {
+        if (fail == true || buf.size() - pos < len) { fail = true; return false; }
+        memcpy(dst, buf.data() + pos, len);
+        pos += len;
+        return true;
+    }
+};
+
+template <class T>
+void Checkpoint::Put(const T &v)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Checkpoint::Put of a non-trivial type");
+    const char *pc = reinterpret_cast<const char*>(&v);
+    buf.insert(std::end(buf), pc, pc + sizeof(T));
+}
+
+template <class T>
+void Checkpoint::Put(const std::vector<T> &vec)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Checkpoint::Put of a non-trivial type");
+    Put((uint64_t)vec.size());
+    const char *pc = reinterpret_cast<const char*>(vec.data());
+    buf.insert(std::end(buf), pc, pc + sizeof(T) * vec.size());
+}
+
+inline void Checkpoint::Put(CSTR &s)
+{
+    Put((uint64_t)s.size());
+    buf.insert(std::end(buf), std::begin(s), std::end(s));
+}
+
+inline int Checkpoint::Save(CSTR &path) const
+{
+    STR pathTmp = path + ".tmp";
+    FILE *pf = fopen(pathTmp.c_str(), "wb");
+    if (pf == nullptr) return -1;
+    bool ok = (buf.size() == fwrite(buf.data(), 1, buf.size(), pf));
+    ok = (0 == fclose(pf)) && ok;
+    #ifdef _WIN32
+    if (ok == true) remove(path.c_str()); // rename does not replace on Windows
+    #endif /* _WIN32 */
+    if (ok == false || 0 != rename(pathTmp.c_str(), path.c_str()))
+    {
+        remove(pathTmp.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+inline int Checkpoint::Load(CSTR &path)
+{
+    Clear();
+    FILE *pf = fopen(path.c_str(), "rb");
+    if (pf == nullptr) { fail = true; return -1; }
+    char bufRead[1 << 12];
+    for (std::size_t n; (n = fread(bufRead, 1, sizeof(bufRead), pf)) > 0;)
+        buf.insert(std::end(buf), bufRead, bufRead + n);
+    fclose(pf);
+    return 0;
+}
+
+template <class T>
+void Checkpoint::Get(T &v)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Checkpoint::Get of a non-trivial type");
+    Take(&v, sizeof(T));
+}
+
+template <class T>
+void Checkpoint::Get(std::vector<T> &vec)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Checkpoint::Get of a non-trivial type");
+    uint64_t n = 0;
+    Get(n);
+    if (fail == true || (buf.size() - pos) / sizeof(T) < n) { fail = true; return; }
+    vec.resize((std::size_t)n);
+    Take(vec.data(), sizeof(T) * vec.size());
+}
+
+inline void Checkpoint::Get(STR &s)
+{
+    uint64_t n = 0;
+    Get(n);
+    if (fail == true || buf.size() - pos < n) { fail = true; return; }
+    s.assign(buf.data() + pos, (std::size_t)n);
+    pos += (std::size_t)n;
+}
+
+}
+
+#endif /* SIBYL_UTIL_CHECKPOINT_H_ */
@@ -0,0 +1,50 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_UTIL_FILELIMIT_H_
+#define SIBYL_UTIL_FILELIMIT_H_
+
+#ifndef _WIN32
+    #include <sys/resource.h>
+#else
+    #include <cstdio>
+#endif /* !_WIN32 */
+
+#include <algorithm>
+
+namespace sibyl
+{
+
+// Raise the limit of open files (soft limit up to the hard limit, at most nMax)
+// Files of each item are kept open for the day (TxtData on the server, .ref files on the client),
+// so a few thousand items need more than the usual default of 1024
+inline void RaiseFileLimit(int nMax = (1 << 16))
+{
+    #ifndef _WIN32
+    struct rlimit rl;
+    if (0 != getrlimit(RLIMIT_NOFILE, &rl)) return;
+    rlim_t lim = std::min<rlim_t>(rl.rlim_max, (rlim_t)nMax);
+    if (rl.rlim_cur >= lim) return;
+    rl.rlim_cur = lim;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    #else
+    _setmaxstdio(std::min(nMax, 8192)); // maximum of the CRT
+    #endif /* !_WIN32 */
+}
+
+}
+
+#endif /* SIBYL_UTIL_FILELIMIT_H_ */
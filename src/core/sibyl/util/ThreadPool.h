@@ -0,0 +1,114 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_UTIL_THREADPOOL_H_
+#define SIBYL_UTIL_THREADPOOL_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+#include "../sibyl_common.h"
+
+namespace sibyl
+{
+
+// Fixed-size pool of worker threads for data parallel loops
+// ParallelFor blocks until done; the calling thread also takes part,
+// so a pool of size 1 runs everything serially on the caller
+class ThreadPool
+{
+public:
+    void ParallelFor(std::size_t n, const std::function<void(std::size_t)> &f) {
+        if (n == 0) return;
+        if (workers.empty() == true || n == 1) {
+            for (std::size_t i = 0; i < n; i++) f(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            job   = &f;
+            nJob  = n;
+            iNext = 0;
+            nBusy = workers.size();
+            gen++;
+        }
+        cvStart.notify_all();
+        Work(f, n);
+        std::unique_lock<std::mutex> lock(mtx);
+        cvDone.wait(lock, [&] { return nBusy == 0; });
+        job = nullptr;
+    }
+
+    std::size_t Size() const { return workers.size() + 1; }
+
+    explicit ThreadPool(std::size_t nThreads = 0) : job(nullptr), nJob(0), iNext(0), nBusy(0), gen(0), quit(false) {
+        if (nThreads == 0) nThreads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 1; i < nThreads; i++)
+            workers.emplace_back([this] { Loop(); });
+    }
+    ThreadPool           (const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            quit = true;
+        }
+        cvStart.notify_all();
+        for (auto &t : workers) t.join();
+    }
+private:
+    void Work(const std::function<void(std::size_t)> &f, std::size_t n) {
+        for (std::size_t i = iNext++; i < n; i = iNext++) f(i);
+    }
+    void Loop() {
+        std::size_t genSeen = 0;
+        while (true) {
+            const std::function<void(std::size_t)> *f;
+            std::size_t n;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cvStart.wait(lock, [&] { return quit == true || gen != genSeen; });
+                if (quit == true) return;
+                genSeen = gen;
+                f = job;
+                n = nJob;
+            }
+            Work(*f, n);
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--nBusy == 0) cvDone.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex               mtx;
+    std::condition_variable  cvStart, cvDone;
+
+    const std::function<void(std::size_t)> *job;
+    std::size_t              nJob;
+    std::atomic<std::size_t> iNext;
+    std::size_t              nBusy;
+    std::size_t              gen;
+    bool                     quit;
+};
+
+}
+
+#endif /* SIBYL_UTIL_THREADPOOL_H_ */
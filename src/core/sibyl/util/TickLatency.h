@@ -0,0 +1,225 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef SIBYL_UTIL_TICKLATENCY_H_
+#define SIBYL_UTIL_TICKLATENCY_H_
+
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+
+#include "../sibyl_common.h"
+
+namespace sibyl
+{
+
+// Histogram of durations (ns) in log-linear buckets (4 per octave; within 25% of the value)
+// Counters are relaxed atomics: Add never blocks, and any thread may read while another adds
+class LatencyHist
+{
+public:
+    void Add(uint64_t ns) {
+        bucket[Index(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1 , std::memory_order_relaxed);
+        sum  .fetch_add(ns, std::memory_order_relaxed);
+        uint64_t m = max.load(std::memory_order_relaxed);
+        while (ns > m && max.compare_exchange_weak(m, ns, std::memory_order_relaxed) == false) {}
+    }
+    uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+    uint64_t Max  () const { return max  .load(std::memory_order_relaxed); }
+    uint64_t Mean () const { auto n = Count(); return (n > 0 ? sum.load(std::memory_order_relaxed) / n : 0); }
+    uint64_t Percentile(double p) const; // upper bound of the bucket holding the p-th (0 ~ 1) value (ns)
+
+    LatencyHist() : bucket{}, count(0), sum(0), max(0) {}
+private:
+    constexpr static std::size_t kBuckets = 252; // up to 2^64 ns
+    std::array<std::atomic<uint64_t>, kBuckets> bucket;
+    std::atomic<uint64_t> count, sum, max;
+
+    static std::size_t Index(uint64_t ns);   // [4 * (msb - 1) + next 2 bits]; ns itself below 4
+    static uint64_t    Lower(std::size_t idx);
+};
+
+// Phases of the tick cycle (10 s), timed on each side of the connection
+enum class TickPhase : std::size_t
+{
+    // server (NetServer or DirectLink, and Broker)
+    advance,     // Broker::AdvanceTick (Kiwoom: includes sleeping until data time)
+    buildMsg,    // Broker::BuildState (or BuildMsgOut)
+    send,        // encoding & sending the state to all clients
+    wait,        // from sending until the replies of all traders arrived (round trip through clients)
+    parseMsg,    // Broker::ParseMsgIn (or decoding & ResolveReqs)
+    executeReqs, // Broker::ExecuteUnnamedReqs
+    // client (NetClient or DirectLink, and Trader)
+    recvTick,    // NetClient::RecvNextTick up to the state message received
+    applyMsg,    // Trader::ApplyMsgIn (or ApplyState)
+    buildState,  // Portfolio::GetStateVec
+    inference,   // model run on the state (rnnclnt), reference data lookup (refclnt)
+    buildReqs,   // RewardModel::BuildMsgOut (or BuildReqs)
+    count
+};
+
+// A LatencyHist per TickPhase, fed once per cycle with the total of each phase in the cycle
+// Tick skips (Broker::IsSkipping) are attributed to the phase that took the longest in the cycle before;
+// a run of consecutive skips goes to the phase that overran before the run
+// Add & EndCycle are called from the thread running the cycle; Hist, Skips & Print from any thread
+class TickLatency
+{
+public:
+    typedef std::chrono::steady_clock clock;
+    constexpr static std::size_t nPhases = (std::size_t)TickPhase::count;
+
+    void Add(TickPhase phase, clock::duration d) {
+        auto &c = cycle[(std::size_t)phase];
+        c.ns += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        c.used = true;
+    }
+    void EndCycle(bool skipped); // call once per cycle, at the same point of it
+
+    const LatencyHist& Hist (TickPhase phase) const { return hist[(std::size_t)phase]; }
+    uint64_t           Skips(TickPhase phase) const { return skips[(std::size_t)phase].load(std::memory_order_relaxed); }
+    uint64_t           Skips()                const;
+
+    // One line per phase timed (us): count, mean, p50, p90, p99, max, skips attributed
+    void Print(std::ostream &os, CSTR &title) const;
+    static const char* Name(TickPhase phase);
+
+    // Times a phase from construction to destruction
+    class Scope
+    {
+    public:
+        Scope(TickLatency &latency_, TickPhase phase_) : latency(latency_), phase(phase_), t0(clock::now()) {}
+        ~Scope() { latency.Add(phase, clock::now() - t0); }
+        Scope           (const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        TickLatency &latency;
+        TickPhase phase;
+        clock::time_point t0;
+    };
+
+    TickLatency() : cycle{}, skips{}, culprit(TickPhase::count), skippedLast(false) {}
+    TickLatency           (const TickLatency&) = delete;
+    TickLatency& operator=(const TickLatency&) = delete;
+private:
+    struct Phase {
+        uint64_t ns;
+        bool used;
+    };
+    std::array<Phase, nPhases> cycle; // of the cycle in progress
+    std::array<LatencyHist, nPhases> hist;
+    std::array<std::atomic<uint64_t>, nPhases> skips;
+    TickPhase culprit;
+    bool skippedLast;
+};
+
+inline std::size_t LatencyHist::Index(uint64_t ns)
+{
+    if (ns < 4) return (std::size_t)ns;
+    std::size_t msb = 0;
+    for (std::size_t shift = 32; shift > 0; shift /= 2)
+        if ((ns >> (msb + shift)) != 0) msb += shift;
+    return 4 * (msb - 1) + (std::size_t)((ns >> (msb - 2)) & 3);
+}
+
+inline uint64_t LatencyHist::Lower(std::size_t idx)
+{
+    if (idx < 4) return idx;
+    return (uint64_t)(4 + idx % 4) << (idx / 4 - 1);
+}
+
+inline uint64_t LatencyHist::Percentile(double p) const
+{
+    auto n = Count();
+    if (n == 0) return 0;
+    auto rank = (uint64_t)(p * (double)(n - 1)) + 1;
+    uint64_t seen = 0;
+    for (std::size_t idx = 0; idx < kBuckets; idx++)
+    {
+        seen += bucket[idx].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(Max(), (idx + 1 < kBuckets ? Lower(idx + 1) - 1 : Max()));
+    }
+    return Max();
+}
+
+inline void TickLatency::EndCycle(bool skipped)
+{
+    if (skipped == true)
+    {
+        if (skippedLast == false)
+        {
+            culprit = TickPhase::count;
+            uint64_t nsMax = 0;
+            for (std::size_t iP = 0; iP < nPhases; iP++)
+            {
+                if (cycle[iP].used == false || (culprit != TickPhase::count && cycle[iP].ns <= nsMax)) continue;
+                culprit = (TickPhase)iP;
+                nsMax   = cycle[iP].ns;
+            }
+            if (culprit == TickPhase::count) culprit = TickPhase::advance; // nothing timed (e.g., first tick)
+        }
+        skips[(std::size_t)culprit].fetch_add(1, std::memory_order_relaxed);
+    }
+    skippedLast = skipped;
+
+    for (std::size_t iP = 0; iP < nPhases; iP++)
+    {
+        if (cycle[iP].used == true) hist[iP].Add(cycle[iP].ns);
+        cycle[iP] = Phase{0, false};
+    }
+}
+
+inline uint64_t TickLatency::Skips() const
+{
+    uint64_t n = 0;
+    for (const auto &s : skips) n += s.load(std::memory_order_relaxed);
+    return n;
+}
+
+inline const char* TickLatency::Name(TickPhase phase)
+{
+    static const char *names[nPhases] = { "advance", "buildMsg", "send", "wait", "parseMsg", "executeReqs",
+                                          "recvTick", "applyMsg", "buildState", "inference", "buildReqs" };
+    return ((std::size_t)phase < nPhases ? names[(std::size_t)phase] : "");
+}
+
+inline void TickLatency::Print(std::ostream &os, CSTR &title) const
+{
+    char buf[1 << 8];
+    snprintf(buf, sizeof(buf), "[Latency] %-13s %8s %10s %10s %10s %10s %10s %6s (us)",
+             title.c_str(), "count", "mean", "p50", "p90", "p99", "max", "skips");
+    os << buf << "\n";
+    for (std::size_t iP = 0; iP < nPhases; iP++)
+    {
+        const auto &h = hist[iP];
+        auto nSkip = skips[iP].load(std::memory_order_relaxed);
+        if (h.Count() == 0 && nSkip == 0) continue;
+        snprintf(buf, sizeof(buf), "[Latency]   %-11s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f %6llu",
+                 Name((TickPhase)iP), (unsigned long long)h.Count(), h.Mean() / 1e3,
+                 h.Percentile(0.5) / 1e3, h.Percentile(0.9) / 1e3, h.Percentile(0.99) / 1e3, h.Max() / 1e3,
+                 (unsigned long long)nSkip);
+        os << buf << "\n";
+    }
+    os.flush();
+}
+
+}
+
+#endif /* SIBYL_UTIL_TICKLATENCY_H_ */
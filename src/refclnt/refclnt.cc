@@ -21,10 +21,23 @@
 #include <sibyl/client/NetClient.h>
 
 int main (int argc, char *argv[]) {
-    if ( (argc != 5 && argc != 6)                   ||
-         (argc == 6 && std::string(argv[5]) != "-v") )
+    bool verbose = false;
+    bool text    = false;
+    bool full    = false;
+    bool sub     = false;
+    bool resume  = false;
+    for (int iArg = 5; iArg < argc; iArg++)
     {
-        std::cerr << "USAGE: refclnt <config file> <ref path> <ip address> <port> [-v]\n   -v\tVerbose output" << std::endl;
+        if      (std::string(argv[iArg]) == "-v") verbose = true;
+        else if (std::string(argv[iArg]) == "-t") text    = true;
+        else if (std::string(argv[iArg]) == "-f") full    = true;
+        else if (std::string(argv[iArg]) == "-s") sub     = true;
+        else if (std::string(argv[iArg]) == "-r") resume  = true;
+        else argc = 0;
+    }
+    if (argc < 5)
+    {
+        std::cerr << "USAGE: refclnt <config file> <ref path> <ip address> <port> [-v] [-t] [-f] [-s] [-r]\n   port\tunix:<path> or shm:<path> in place of either connects on the same host (see simserv)\n   -v\tVerbose output\n   -t\tText messages only (no binary)\n   -f\tFull state every tick (no delta)\n   -s\tSubscribe only (requests not applied by server)\n   -r\tResume from the checkpoint in state path (restart during a day)" << std::endl;
         exit(1);
     }
 
@@ -37,17 +50,30 @@ int main (int argc, char *argv[]) {
     trader.model.ReadConfig(argv[1]);
     trader.model.SetRefPath(argv[2]);
     trader.SetStateLogPaths(path + "/state", "");
+    trader.SetCheckpoint(Trader::kCkptPeriod, resume);
 
     NetClient netclient(&trader);
-    netclient.SetVerbose(argc == 6 && std::string(argv[5]) == "-v");
+    netclient.SetVerbose(verbose);
+    netclient.SetBinary(text == false);
+    netclient.SetDelta (full == false);
+    netclient.SetSubscriber(sub);
 
     if (0 != netclient.Connect(argv[3], argv[4]))
         exit(1);
         
     while (true)
     {
-        if (0 != netclient.RecvNextTick()) break;
-        trader.model.GetRefData();
+        int ret = netclient.RecvNextTick();
+        if (ret < 0) break;
+        if (ret > 0) // new day (multi-day simulation)
+        {
+            trader.model.SetRefDay(trader.Day());
+            continue;
+        }
+        {
+            TickLatency::Scope scope(trader.latency, TickPhase::inference);
+            trader.model.GetRefData();
+        }
         netclient.SendResponse();
     }
     
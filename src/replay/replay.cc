@@ -0,0 +1,83 @@
+/*
+   Copyright 2017 Hosang Yoon
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <sibyl/server/Replay/Replay.h>
+#include <sibyl/server/NetServer.h>
+#include <sibyl/util/OstreamRedirector.h>
+
+int main(int argc, char *argv[])
+{
+    using namespace sibyl;
+    
+    // options may come anywhere after <port>
+    typedef NetServer<Order, Item<Order>> ReplayServer;
+    ReplayServer::ReqPolicy policy = ReplayServer::ReqPolicy::all;
+    int minTraders = 1;
+    int timeFrom   = kTimeBounds::null;
+    for (int iArg = 3; iArg < argc; iArg++)
+    {
+        std::string arg(argv[iArg]);
+        if (arg == "-n" && iArg + 1 < argc)
+            minTraders = std::atoi(argv[++iArg]);
+        else if (arg == "-t" && iArg + 1 < argc)
+        {
+            int hhmmss = std::atoi(argv[++iArg]);
+            timeFrom = (hhmmss / 10000) * 3600 + ((hhmmss / 100) % 100) * 60 + (hhmmss % 100) + kTimeBounds::null;
+        }
+        else if (arg == "-p" && iArg + 1 < argc)
+        {
+            std::string p(argv[++iArg]);
+            if      (p == "all"   ) policy = ReplayServer::ReqPolicy::all;
+            else if (p == "first" ) policy = ReplayServer::ReqPolicy::first;
+            else if (p == "rotate") policy = ReplayServer::ReqPolicy::rotate;
+            else argc = 0;
+        }
+        else
+            argc = 0;
+    }
+    if (argc < 3 || minTraders < 0)
+    {
+        std::cerr << "USAGE: replay <journal> <port> [-t <hhmmss>] [-n <traders>] [-p all|first|rotate]\n"
+                     "   journal\trecorded by simserv -j (index at <journal>.idx)\n"
+                     "   port\tTCP port, or unix:<path> (unix socket) / shm:<path> (shared memory) for clients on the same host\n"
+                     "   -t\tStart from the first state at or after hhmmss (of the first day in the journal)\n"
+                     "   -n\tTrader clients to wait for before starting (default 1; subscribers may join any time)\n"
+                     "   -p\tReqs parsed every tick, as in simserv (never executed)" << std::endl;
+        exit(1);
+    }
+    
+    std::string path(argv[0]);
+    path.resize(path.find_last_of('/'));
+    
+    verify(system(std::string("mkdir -p " + path + "/log").c_str()) == 0);
+    
+    Replay replay;
+    if (0 != replay.Open(argv[1], timeFrom))
+        exit(1);
+    
+    ReplayServer server(&replay);
+    server.SetVerbose(true);
+    server.SetReqPolicy(policy);
+    server.SetMinTraders(minTraders);
+    {
+        OstreamRedirector redir(std::cout, path + "/log/replay.log");
+        server.Launch(argv[2], true, false);
+    }
+    
+    std::cout << replay.Ticks() << " ticks replayed" << std::endl;
+    
+    return 0;
+}
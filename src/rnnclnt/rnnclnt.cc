@@ -19,11 +19,13 @@
 #include <fstream>
 #include <memory>
 #include <cassert>
+#include <algorithm>
 
 #include <fractal/fractal.h>
 
 #include <sibyl/client/Trader.h>
 #include <sibyl/client/NetClient.h>
+#include <sibyl/client/StateLog.h>
 
 #include <rnn/regress/Reshaper_v0.h>
 #include <rnn/regress/VanillaNet.h>
@@ -31,10 +33,19 @@ using Net = fractal::VanillaNet<sibyl::Reshaper_v0>;
 
 int main(int argc, char *argv[])
 {
-    if ( (argc != 6 && argc != 7)                   ||
-         (argc == 7 && std::string(argv[6]) != "-v") )
+    bool verbose = false;
+    bool resume  = false;
+    for (int iArg = 6; iArg < argc; iArg++)
     {
-        std::cerr << "USAGE: rnnclnt <model cfg> <reshaper cfg> <workspace list> <ip address> <port> [ -v ]" << std::endl;
+        if      (std::string(argv[iArg]) == "-v") verbose = true;
+        else if (std::string(argv[iArg]) == "-r") resume  = true;
+        else argc = 0;
+    }
+    if (argc < 6)
+    {
+        std::cerr << "USAGE: rnnclnt <model cfg> <reshaper cfg> <workspace list> <ip address> <port> [-v] [-r]\n"
+                     "   -v\tVerbose output\n"
+                     "   -r\tResume from the checkpoint & state log in state path (restart during a day)" << std::endl;
         exit(1);
     }
 
@@ -54,9 +65,14 @@ int main(int argc, char *argv[])
     Trader trader;
     trader.model.ReadConfig(argv[1]);    
     trader.SetStateLogPaths(path + "/state", path + "/log");
+    trader.SetCheckpoint(Trader::kCkptPeriod, resume);
+    
+    // states given to the RNNs today; run through again after a restart to rebuild their memory
+    StateLog stateLog;
+    const std::string pathStateLog = path + "/state/state.log";
 
     NetClient netClient(&trader);
-    netClient.SetVerbose((argc == 7) && (std::string(argv[6]) == "-v"));
+    netClient.SetVerbose(verbose);
     
     
     /* =============================================== */
@@ -92,6 +108,28 @@ int main(int argc, char *argv[])
     unsigned long nStream = 0; // will be set below
     
     bool is_init = true;
+    
+    // Reshaper input -> RNN -> Reshaper output for a frame, rewards of all RNNs added to vecReward (if given)
+    auto RunNets = [&](const std::vector<ItemState> &vecState, std::vector<Reward> *pvecReward) {
+        for (auto &pNet : vecNet)
+        {
+            FLOAT *vecIn = pNet->GetInputVec();
+            for (std::size_t codeIdx = 0; codeIdx < nStream; codeIdx++)
+                pNet->Reshaper().State2VecIn(vecIn + codeIdx * inputDim, vecState[codeIdx]);
+        }
+        for (auto &pNet : vecNet)
+            pNet->RunOneFrame();
+        for (auto &pNet : vecNet)
+        {
+            FLOAT *vecOut = pNet->GetOutputVec();
+            for (std::size_t codeIdx = 0; codeIdx < nStream; codeIdx++)
+            {
+                Reward temp;
+                pNet->Reshaper().VecOut2Reward(temp, vecOut + codeIdx * outputDim, vecState[codeIdx].code);
+                if (pvecReward != nullptr) (*pvecReward)[codeIdx] += temp;
+            }
+        }
+    };
 
     
     /* ===================================== */
@@ -105,7 +143,13 @@ int main(int argc, char *argv[])
     while (true)
     {
         /* Receive data and fill Portfolio entries */
-        if (0 != netClient.RecvNextTick()) break;
+        int ret = netClient.RecvNextTick();
+        if (ret < 0) break;
+        if (ret > 0) // new day (multi-day simulation); streams initialized again at its first tick
+        {
+            is_init = true;
+            continue;
+        }
         
         /* Initialize nUnroll & nStream */
         if(is_init == true)
@@ -113,6 +157,22 @@ int main(int argc, char *argv[])
             nStream = trader.portfolio.items.size();
             for (auto &pNet : vecNet)
                 pNet->InitUnrollStream(nUnroll, nStream);
+            
+            /* Resumed after a restart: run the states logged before to rebuild reshaper memory & RNN activations */
+            if (trader.Resumed() == true)
+            {
+                const auto &vecStateNow = trader.portfolio.GetStateVec();
+                long nRun = 0;
+                long nRead = StateLog::Read(pathStateLog, [&](const std::vector<ItemState> &vecState) {
+                    if (vecState.size() != nStream) return;
+                    for (std::size_t codeIdx = 0; codeIdx < nStream; codeIdx++)
+                        if (vecState[codeIdx].code != vecStateNow[codeIdx].code) return;
+                    RunNets(vecState, nullptr);
+                    nRun++;
+                });
+                std::cout << "rnnclnt: " << nRun << " of " << std::max(nRead, 0L) << " logged states run again" << std::endl;
+            }
+            stateLog.Open(pathStateLog, trader.Resumed());
             is_init = false;
         }
         
@@ -121,38 +181,23 @@ int main(int argc, char *argv[])
              (trader.portfolio.time <  kTimeBounds::stop) ) 
         {
             /* Retrieve state vector for current frame */
+            auto t0 = TickLatency::clock::now();
             const auto &vecState = trader.portfolio.GetStateVec();
-
-            /* Generate the input matrix */
-            for (auto &pNet : vecNet)
-            {
-                FLOAT *vecIn = pNet->GetInputVec();
-                for (std::size_t codeIdx = 0; codeIdx < nStream; codeIdx++)
-                    pNet->Reshaper().State2VecIn(vecIn + codeIdx * inputDim, vecState[codeIdx]);
-            }
-
-            /* Run RNN */
-            for (auto &pNet : vecNet)
-                pNet->RunOneFrame();
+            auto t1 = TickLatency::clock::now();
+            trader.latency.Add(TickPhase::buildState, t1 - t0);
 
             /* Allocate 0-filled rewards vector */
             auto &vecReward = trader.model.GetRewardVec(); 
 
-            /* Get gain values from the output matrix */
-            for (auto &pNet : vecNet)
-            {
-                FLOAT *vecOut = pNet->GetOutputVec();
-                for (std::size_t codeIdx = 0; codeIdx < nStream; codeIdx++)
-                {
-                    Reward temp;
-                    pNet->Reshaper().VecOut2Reward(temp, vecOut + codeIdx * outputDim, vecState[codeIdx].code);
-                    vecReward[codeIdx] += temp;
-                }
-            }
+            /* Generate the input matrix, run RNN & get gain values from the output matrix */
+            RunNets(vecState, &vecReward);
             for (auto &reward : vecReward) reward *= (FLOAT) 1 / nNet;
             
             /* Send rewards vector back to model */
             trader.model.SetRewardVec(vecReward); 
+            trader.latency.Add(TickPhase::inference, TickLatency::clock::now() - t1);
+            
+            stateLog.Write(vecState);
         }
         
         /* Calculate based on vecState/vecReward and send requests */
@@ -16,15 +16,52 @@
 
 #include <iomanip>
 
-#include <sibyl/server/Simulation/Simulation_dep.h>
+#include <sibyl/server/Simulation/Simulation.h>
 #include <sibyl/server/NetServer.h>
 #include <sibyl/util/OstreamRedirector.h>
 
 int main(int argc, char *argv[])
 {
-    if (argc != 4)
+    using namespace sibyl;
+    
+    // options may come anywhere after <port>
+    std::vector<std::string> days;
+    SimulationServer::ReqPolicy policy = SimulationServer::ReqPolicy::all;
+    int minTraders = 1;
+    std::string journal;
+    bool reconnectable = false;
+    for (int iArg = 4; iArg < argc; iArg++)
     {
-        std::cerr << "USAGE: simserv <config file> <data path> <port>" << std::endl;
+        std::string arg(argv[iArg]);
+        if (arg == "-n" && iArg + 1 < argc)
+            minTraders = std::atoi(argv[++iArg]);
+        else if (arg == "-j" && iArg + 1 < argc)
+            journal = argv[++iArg];
+        else if (arg == "-r")
+            reconnectable = true;
+        else if (arg == "-p" && iArg + 1 < argc)
+        {
+            std::string p(argv[++iArg]);
+            if      (p == "all"   ) policy = SimulationServer::ReqPolicy::all;
+            else if (p == "first" ) policy = SimulationServer::ReqPolicy::first;
+            else if (p == "rotate") policy = SimulationServer::ReqPolicy::rotate;
+            else argc = 0;
+        }
+        else if (arg.empty() == false && arg[0] == '-')
+            argc = 0;
+        else
+            days.push_back(arg);
+    }
+    if (argc < 4 || minTraders < 0)
+    {
+        std::cerr << "USAGE: simserv <config file> <data path> <port> [<next day> ...] [-n <traders>] [-p all|first|rotate] [-j <journal>] [-r]\n"
+                     "   port\tTCP port, or unix:<path> (unix socket) / shm:<path> (shared memory) for clients on the same host\n"
+                     "   next day\tsimulate days in a row (data at <data path>/../<next day>[.zip])\n"
+                     "   -n\tTrader clients to wait for before starting (default 1; subscribers may join any time)\n"
+                     "   -p\tReqs applied every tick: all traders' in the order of connection (default),\n"
+                     "     \tthe first trader's only, or all with the starting trader rotated every tick\n"
+                     "   -j\tRecord the state of every tick to a binary journal (and its index at <journal>.idx; see replay)\n"
+                     "   -r\tWait for a trader to (re)connect when the last one disconnects, rather than exit" << std::endl;
         exit(1);
     }
     
@@ -34,21 +71,35 @@ int main(int argc, char *argv[])
     verify(system(std::string("mkdir -p " + path + "/log").c_str()) == 0);
     verify(system(std::string("mkdir -p " + path + "/state").c_str()) == 0);
 
-    using namespace sibyl;
-    
-    Simulation simulation;
+    Simulation_dep simulation;
     if (0 != simulation.LoadData(argv[1], argv[2]))
         exit(1);
+    
+    std::vector<std::string> nextDays;
+    for (const auto &day : days)
+        nextDays.push_back(Simulation_dep::DayPath(argv[2], day));
+    simulation.SetNextDays(nextDays);
 
     SimulationServer server(&simulation);
     server.SetVerbose(true);
+    server.SetReqPolicy(policy);
+    server.SetMinTraders(minTraders);
+    if (journal.empty() == false && 0 != server.SetJournal(journal))
+        exit(1);
     {
         OstreamRedirector redir(std::cout, path + "/log/sim.log");
-        server.Launch(argv[3], true, false);
+        simulation.GetLoadTime().Print(std::cout);
+        server.Launch(argv[3], true, reconnectable);
     }
     
-    std::cout << std::setprecision(6) << std::fixed
-              << simulation.orderbook.GetProfitRate() << std::endl;
+    std::cout << std::setprecision(6) << std::fixed;
+    if (nextDays.empty() == true)
+        std::cout << simulation.orderbook.GetProfitRate() << std::endl;
+    else
+    {
+        for (const auto &day_rate : simulation.GetDayRates())
+            std::cout << day_rate.first << '\t' << day_rate.second << std::endl;
+    }
     
     return 0;
 }
\ No newline at end of file